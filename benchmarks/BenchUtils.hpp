@@ -0,0 +1,42 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "core/ImageBuffer.hpp"
+
+namespace bench
+{
+// Reports "Mpx" per second (JSON counter "Mpx"): pixels handled by one iteration, turned into
+// a rate by the library.
+inline void setMegapixelRate(benchmark::State& state, std::int64_t pixelsPerIteration)
+{
+    state.counters["Mpx"] =
+        benchmark::Counter(static_cast<double>(pixelsPerIteration) * 1e-6,
+                           benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// Deterministic noise (LCG), alpha forced to `alpha` unless it is < 0.
+inline std::shared_ptr<ImageBuffer> makeNoise(int w, int h, std::uint32_t seed, int alpha = -1)
+{
+    auto img = std::make_shared<ImageBuffer>(w, h);
+    for (int y = 0; y < h; ++y)
+    {
+        auto row = img->row(y);
+        for (auto& px : row)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            std::uint32_t rgba = seed;
+            if (alpha >= 0)
+                rgba = (rgba & 0xFFFFFF00u) | static_cast<std::uint32_t>(alpha);
+            px = ImageBuffer::toPixel(rgba);
+        }
+    }
+    return img;
+}
+}  // namespace bench
@@ -0,0 +1,108 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include <random>
+#include <string>
+
+#include "BenchUtils.hpp"
+#include "core/AlphaMask.hpp"
+#include "core/BucketFill.hpp"
+#include "core/ImageBuffer.hpp"
+
+// Scenarios of the former DISABLED_ gtest benchmark: a solid image (one region covering
+// everything), a checkerboard (one-pixel regions) and random noise (many small regions).
+namespace
+{
+constexpr std::uint32_t kTarget = 0x000000FFu;
+constexpr std::uint32_t kOther = 0xFF0000FFu;
+constexpr std::uint32_t kNew = 0x00FF00FFu;
+
+enum Pattern : int
+{
+    kSolid = 0,
+    kChecker = 1,
+    kRandom = 2,
+};
+
+ImageBuffer makePattern(int size, Pattern pattern)
+{
+    ImageBuffer buf{size, size};
+    buf.fill(kTarget);
+    if (pattern == kSolid)
+        return buf;
+
+    std::mt19937 rng(static_cast<std::uint32_t>(size));
+    std::uniform_int_distribution<int> dist(0, 1);
+    for (int y = 0; y < size; ++y)
+        for (int x = 0; x < size; ++x)
+        {
+            const bool target = pattern == kChecker ? ((x + y) & 1) == 0 : dist(rng) != 0;
+            if (!target)
+                buf.setPixel(x, y, kOther);
+        }
+    return buf;
+}
+
+void fillArgs(benchmark::internal::Benchmark* b)
+{
+    b->ArgNames({"size", "pattern"});
+    for (const int size : {256, 512, 2048})
+        for (const int pattern : {kSolid, kChecker, kRandom})
+            b->Args({size, pattern});
+    b->Unit(benchmark::kMicrosecond);
+}
+
+// Pixels of the region filled from the seed point (the rate is about those, not the image).
+std::int64_t regionSize(const ImageBuffer& base, int x, int y)
+{
+    return static_cast<std::int64_t>(core::floodFillCollect(base, x, y, core::Color{kNew}).count);
+}
+}  // namespace
+
+static void BM_FloodFill(benchmark::State& state)
+{
+    const int size = static_cast<int>(state.range(0));
+    const ImageBuffer base = makePattern(size, static_cast<Pattern>(state.range(1)));
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        ImageBuffer tmp = base;
+        state.ResumeTiming();
+        core::floodFill(tmp, size / 3, size / 3, core::Color{kNew});
+        benchmark::DoNotOptimize(tmp.data());
+    }
+    bench::setMegapixelRate(state, regionSize(base, size / 3, size / 3));
+}
+BENCHMARK(BM_FloodFill)->Apply(fillArgs);
+
+static void BM_FloodFillCollect(benchmark::State& state)
+{
+    const int size = static_cast<int>(state.range(0));
+    const ImageBuffer base = makePattern(size, static_cast<Pattern>(state.range(1)));
+    for (auto _ : state)
+    {
+        auto region = core::floodFillCollect(base, size / 3, size / 3, core::Color{kNew});
+        benchmark::DoNotOptimize(region.bits.data());
+    }
+    bench::setMegapixelRate(state, regionSize(base, size / 3, size / 3));
+}
+BENCHMARK(BM_FloodFillCollect)->Apply(fillArgs);
+
+static void BM_FloodFillWithinMask(benchmark::State& state)
+{
+    const int size = static_cast<int>(state.range(0));
+    const ImageBuffer base = makePattern(size, static_cast<Pattern>(state.range(1)));
+    AlphaMask mask{size, size};
+    mask.fill(0xFF);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        ImageBuffer tmp = base;
+        state.ResumeTiming();
+        core::floodFillWithinMask(tmp, mask, size / 3, size / 3, core::Color{kNew});
+        benchmark::DoNotOptimize(tmp.data());
+    }
+    bench::setMegapixelRate(state, regionSize(base, size / 3, size / 3));
+}
+BENCHMARK(BM_FloodFillWithinMask)->Apply(fillArgs);
@@ -0,0 +1,83 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include <memory>
+
+#include "BenchUtils.hpp"
+#include "core/Compositor.hpp"
+#include "core/Document.hpp"
+#include "core/ImageBuffer.hpp"
+#include "core/Layer.hpp"
+
+namespace
+{
+enum OpacityMix : int
+{
+    kOpaque = 0,       // every layer alpha 255, opacity 1
+    kTranslucent = 1,  // random alpha, opacity 0.6
+    kMixed = 2,        // alternating both
+};
+
+// args: canvas size (square), layer count, opacity mix
+Document makeDocument(const benchmark::State& state)
+{
+    const int size = static_cast<int>(state.range(0));
+    const auto layers = static_cast<int>(state.range(1));
+    const auto mix = static_cast<OpacityMix>(state.range(2));
+
+    Document doc(size, size);
+    for (int i = 0; i < layers; ++i)
+    {
+        const bool opaque = mix == kOpaque || (mix == kMixed && i % 2 == 0);
+        auto layer = std::make_shared<Layer>(
+            static_cast<std::uint64_t>(i), "L",
+            bench::makeNoise(size, size, 1234u + static_cast<std::uint32_t>(i), opaque ? 255 : -1));
+        if (!opaque)
+            layer->setOpacity(0.6f);
+        doc.addLayer(layer);
+    }
+    return doc;
+}
+
+void composeArgs(benchmark::internal::Benchmark* b)
+{
+    b->ArgNames({"size", "layers", "mix"});
+    for (const int size : {512, 2048})
+        for (const int layers : {1, 8, 32})
+            for (const int mix : {kOpaque, kTranslucent, kMixed})
+                b->Args({size, layers, mix});
+    b->Unit(benchmark::kMillisecond);
+}
+}  // namespace
+
+static void BM_Compositor_Compose(benchmark::State& state)
+{
+    const Document doc = makeDocument(state);
+    ImageBuffer out(doc.width(), doc.height());
+    for (auto _ : state)
+    {
+        Compositor::compose(doc, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    bench::setMegapixelRate(state, static_cast<std::int64_t>(doc.width()) * doc.height() *
+                                       static_cast<std::int64_t>(doc.layerCount()));
+}
+BENCHMARK(BM_Compositor_Compose)->Apply(composeArgs);
+
+// 256x256 dirty area, as after a brush stroke
+static void BM_Compositor_ComposeROI(benchmark::State& state)
+{
+    const Document doc = makeDocument(state);
+    constexpr int kRoi = 256;
+    ImageBuffer out(kRoi, kRoi);
+    const int x = (doc.width() - kRoi) / 2;
+    for (auto _ : state)
+    {
+        Compositor::composeROI(doc, x, x, kRoi, kRoi, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    bench::setMegapixelRate(state, static_cast<std::int64_t>(kRoi) * kRoi *
+                                       static_cast<std::int64_t>(doc.layerCount()));
+}
+BENCHMARK(BM_Compositor_ComposeROI)->Apply(composeArgs);
@@ -0,0 +1,36 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include <memory>
+
+#include "BenchUtils.hpp"
+#include "core/Document.hpp"
+#include "core/ImageBuffer.hpp"
+#include "core/Layer.hpp"
+
+// args: canvas size (square), opacity of the merged layer in percent
+static void BM_Document_MergeDown(benchmark::State& state)
+{
+    const int size = static_cast<int>(state.range(0));
+    const float opacity = static_cast<float>(state.range(1)) / 100.0f;
+    const auto bottom = bench::makeNoise(size, size, 11u, 255);
+    const auto top = bench::makeNoise(size, size, 22u);
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        Document doc(size, size);
+        doc.addLayer(std::make_shared<Layer>(0, "bottom", std::make_shared<ImageBuffer>(*bottom)));
+        doc.addLayer(std::make_shared<Layer>(1, "top", top, true, false, opacity));
+        state.ResumeTiming();
+
+        doc.mergeDown(1);
+        benchmark::DoNotOptimize(doc.layerAt(0)->image()->data());
+    }
+    bench::setMegapixelRate(state, static_cast<std::int64_t>(size) * size);
+}
+BENCHMARK(BM_Document_MergeDown)
+    ->ArgNames({"size", "opacity"})
+    ->ArgsProduct({{512, 2048}, {100, 50}})
+    ->Unit(benchmark::kMillisecond);
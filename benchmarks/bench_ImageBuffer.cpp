@@ -0,0 +1,44 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include "BenchUtils.hpp"
+#include "core/ImageBuffer.hpp"
+
+static void BM_ImageBuffer_Fill(benchmark::State& state)
+{
+    const int size = static_cast<int>(state.range(0));
+    const auto storage = static_cast<ImageBuffer::Storage>(state.range(1));
+    ImageBuffer img(size, size, storage);
+    std::uint32_t color = 0x336699FFu;
+    for (auto _ : state)
+    {
+        img.fill(color);
+        color ^= 0x01010100u;
+        benchmark::ClobberMemory();
+    }
+    bench::setMegapixelRate(state, static_cast<std::int64_t>(size) * size);
+}
+BENCHMARK(BM_ImageBuffer_Fill)
+    ->ArgNames({"size", "tiled"})
+    ->ArgsProduct({{512, 2048, 4096}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_ImageBuffer_SetPixel(benchmark::State& state)
+{
+    const int size = static_cast<int>(state.range(0));
+    const auto storage = static_cast<ImageBuffer::Storage>(state.range(1));
+    ImageBuffer img(size, size, storage);
+    for (auto _ : state)
+    {
+        for (int y = 0; y < size; ++y)
+            for (int x = 0; x < size; ++x)
+                img.setPixel(x, y, 0x11223344u);
+        benchmark::ClobberMemory();
+    }
+    bench::setMegapixelRate(state, static_cast<std::int64_t>(size) * size);
+}
+BENCHMARK(BM_ImageBuffer_SetPixel)
+    ->ArgNames({"size", "tiled"})
+    ->ArgsProduct({{512, 2048}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,56 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include <memory>
+#include <string>
+
+#include "BenchUtils.hpp"
+#include "app/AppService.hpp"
+#include "core/Document.hpp"
+#include "io/IStorage.hpp"
+
+namespace
+{
+// The resize goes through AppService (nearest-neighbour scaling + undoable command), which
+// needs a storage it never uses here.
+class NullStorage final : public IStorage
+{
+   public:
+    io::epg::OpenResult open(const std::string&) override
+    {
+        return {};
+    }
+    void save(const Document&, const std::string&) override {}
+    void exportImage(const Document&, const std::string&) override {}
+};
+}  // namespace
+
+// args: layer size (square) before the resize, scale factor in percent
+static void BM_AppService_ResizeLayer(benchmark::State& state)
+{
+    const int size = static_cast<int>(state.range(0));
+    const int target = size * static_cast<int>(state.range(1)) / 100;
+
+    app::AppService app(std::make_unique<NullStorage>());
+    app.newDocument(app::Size{size, size}, 72.f, 0xFFFFFFFFu);
+    app.addImageLayer(*bench::makeNoise(size, size, 5u), "noise");
+    const std::size_t idx = app.document().layerCount() - 1;
+
+    bool grown = false;
+    for (auto _ : state)
+    {
+        // alternate so every iteration scales the same amount of pixels
+        const int w = grown ? size : target;
+        app.resizeLayer(idx, w, w);
+        grown = !grown;
+    }
+    // output pixels, averaged over both directions
+    bench::setMegapixelRate(state, (static_cast<std::int64_t>(target) * target +
+                                    static_cast<std::int64_t>(size) * size) /
+                                       2);
+}
+BENCHMARK(BM_AppService_ResizeLayer)
+    ->ArgNames({"size", "scale"})
+    ->ArgsProduct({{512, 2048}, {50, 200}})
+    ->Unit(benchmark::kMillisecond);
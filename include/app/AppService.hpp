@@ -4,13 +4,18 @@
 
 #pragma once
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <vector>
 
 #include "app/History.hpp"
 #include "app/Signal.h"
+#include "app/StrokeSmoother.hpp"
 #include "app/ToolParams.hpp"
 #include "commands/StrokeCommand.hpp"
 #include "common/Geometry.hpp"
+#include "core/BucketFill.hpp"
 #include "io/IStorage.hpp"
 
 class Document;
@@ -88,8 +93,13 @@ class AppService
     void resizeLayer(std::size_t idx, int newW, int newH);  // smooth true = bilinear, nearest
     void duplicateLayer(std::size_t idx);
 
+    // The stroke is painted into the active layer as it goes: begin/moveStroke only invalidate
+    // the repainted area (see takeInvalidatedRect) and endStroke pushes the undo record.
+    // Pointer samples go through the StrokeSmoother of params.smoothing first; pass them in
+    // batches (one per display frame) so each frame paints once.
     void beginStroke(const ToolParams&, common::Point pStart);
     void moveStroke(common::Point p);
+    void moveStroke(std::span<const common::Point> samples);
     void endStroke();
     uint32_t pickColorAt(common::Point p) const;
 
@@ -97,7 +107,11 @@ class AppService
     void setSelectionRect(common::Rect r);
     void clearSelectionRect();
 
-    void bucketFill(common::Point p, std::uint32_t rgba);
+    // Fills the region around p on the active layer; `criteria` sets how close to the clicked
+    // pixel the filled pixels must be (exact match by default). With sampleMerged the region is
+    // found on the visible composite instead of the layer's own pixels.
+    void bucketFill(common::Point p, std::uint32_t rgba, const core::FillCriteria& criteria = {},
+                    bool sampleMerged = false);
 
     void undo();
     void redo();
@@ -106,6 +120,11 @@ class AppService
 
     Signal documentChanged;
 
+    // Document-space area whose composite changed since the previous call (nullopt = the whole
+    // document: new/opened document, or a change that cannot be localised). An empty rect means
+    // only non-visual state changed (selection, names, locks).
+    std::optional<common::Rect> takeInvalidatedRect();
+
    private:
     std::unique_ptr<IStorage> storage_;
     History history_ = History(20);
@@ -113,7 +132,11 @@ class AppService
     std::size_t activeLayer_ = 0;
     std::uint64_t nextLayerId_ = 1;
     std::unique_ptr<commands::StrokeCommand> currentStroke_;
+    std::optional<StrokeSmoother> strokeSmoother_;
+    std::vector<common::Point> strokePoints_;  // scratch for the smoothed batch
     void apply(std::unique_ptr<Command> cmd);
+    void invalidate(std::optional<common::Rect> rect);
     bool dirty_ = false;
+    std::optional<common::Rect> invalidated_;  // starts as "everything"
 };
 };  // namespace app
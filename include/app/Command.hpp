@@ -10,8 +10,11 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <vector>
 
+#include "common/Geometry.hpp"
+
 namespace app
 {
 
@@ -32,6 +35,13 @@ class Command
     virtual ~Command() = default;
     virtual void undo() = 0;
     virtual void redo() = 0;
+
+    // Document-space area whose composite changed during the last undo()/redo().
+    // nullopt = unknown, recomposite everything; an empty rect = nothing visible changed.
+    [[nodiscard]] virtual std::optional<common::Rect> invalidatedRect() const
+    {
+        return std::nullopt;
+    }
 };
 
 // Simple concrete command that applies pixel changes using an ApplyFn
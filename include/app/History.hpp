@@ -26,8 +26,9 @@ class History
 
     void push(CommandPtr cmd);
 
-    void undo();
-    void redo();
+    // Return the command that was undone / redone (nullptr if none).
+    Command* undo();
+    Command* redo();
     void clear();
 
     bool canUndo() const noexcept;
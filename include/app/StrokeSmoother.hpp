@@ -0,0 +1,53 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#pragma once
+
+#include <array>
+#include <span>
+#include <vector>
+
+#include "app/ToolParams.hpp"
+#include "common/Geometry.hpp"
+
+namespace app
+{
+// Turns the pointer samples of a stroke into the points it is drawn through. Samples come in
+// batches (one per display frame); the output may lag behind them and finish() flushes it.
+// None passes the samples through, CatmullRom draws the curve through them (a segment is only
+// known once the sample after it arrives), Stabilizer drags the pen behind the pointer on a
+// string of stabilizerRadius pixels.
+class StrokeSmoother
+{
+   public:
+    static constexpr double kDefaultStabilizerRadius = 8.0;
+
+    StrokeSmoother(StrokeSmoothing mode, common::Point start,
+                   double stabilizerRadius = kDefaultStabilizerRadius);
+
+    // Appends to out the points to draw after the samples; consecutive duplicates are dropped.
+    void push(std::span<const common::Point> samples, std::vector<common::Point>& out);
+    // Appends the points left up to the last sample.
+    void finish(std::vector<common::Point>& out);
+
+   private:
+    struct Vec
+    {
+        double x;
+        double y;
+    };
+
+    void emit(Vec p, std::vector<common::Point>& out);
+    // Points of the Catmull-Rom segment controls_[1] -> controls_[2], next control p3.
+    void emitCurve(Vec p3, std::vector<common::Point>& out);
+
+    StrokeSmoothing mode_;
+    double stabilizerRadius_;
+    common::Point last_;  // last point emitted (or the start)
+
+    std::array<Vec, 3> controls_;  // CatmullRom: the three last control points
+    int samples_{0};               // CatmullRom: samples pushed so far
+    Vec pen_;                      // Stabilizer: pen position
+    Vec pointer_;                  // Stabilizer: last sample
+};
+}  // namespace app
@@ -16,12 +16,23 @@ enum class ToolKind : std::uint8_t
     Eraser,
 };
 
+// How pointer samples become stroke points (see StrokeSmoother).
+enum class StrokeSmoothing : std::uint8_t
+{
+    None,
+    CatmullRom,  // curve through the samples
+    Stabilizer,  // follows the pointer on a string, filtering out jitter
+};
+
 struct ToolParams
 {
     ToolKind tool = ToolKind::Pencil;
     std::uint32_t color = common::colors::Black;
     int size = 1;
     float opacity = 1.0;
+    float hardness = 1.0;  // 1 = hard aliased edge, lower = softer anti-aliased falloff
+    int spacing = 0;       // distance between dabs in percent of size, 0 = continuous sweep
+    StrokeSmoothing smoothing = StrokeSmoothing::None;
 };
 
 }  // namespace app
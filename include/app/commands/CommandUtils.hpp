@@ -7,10 +7,18 @@
 #include <cstdint>
 #include <optional>
 
+#include "common/Geometry.hpp"
+
 class Document;
+class Layer;
 
 namespace app::commands
 {
 std::optional<std::size_t> findLayerIndexById(const Document& doc, std::uint64_t id);
 void clampActiveLayer(std::size_t* activeLayer, std::size_t layerCount);
+
+// Document-space area covered by the layer image (empty when it has none).
+common::Rect layerBounds(const Layer& layer);
+// Document-space area of layer-local `local` for layer `id` (empty if the layer is gone).
+common::Rect toDocumentRect(const Document& doc, std::uint64_t id, const common::Rect& local);
 }  // namespace app::commands
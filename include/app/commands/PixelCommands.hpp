@@ -10,10 +10,13 @@
 
 #include "app/Command.hpp"
 #include "app/commands/StrokeCommand.hpp"
+#include "core/BucketFill.hpp"
 class Document;
 
 namespace app::commands
 {
-std::unique_ptr<Command> makePixelChangesCommand(Document* doc, std::uint64_t layerId,
-                                                 std::vector<PixelChange> changes);
+// Fills `region` (layer-local) of the layer with its color; undo restores the covered tiles.
+// The layer must still hold its pre-fill pixels when the command is created.
+std::unique_ptr<Command> makeBucketFillCommand(Document* doc, std::uint64_t layerId,
+                                               core::FillRegion region);
 }
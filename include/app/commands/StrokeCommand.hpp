@@ -4,37 +4,92 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
 #include <vector>
 
 #include "app/Command.hpp"
 #include "app/ToolParams.hpp"
 #include "common/Geometry.hpp"
+#include "core/BrushTip.hpp"
+#include "core/ImageBuffer.hpp"
+#include "core/Selection.hpp"
 
 class Document;
 
 namespace app::commands
 {
+// Paints into the layer while the stroke is being drawn: each point rasterizes only the segment
+// from the previous one, either as dabs of the cached brush tip every `spacing` along the path
+// or, unspaced, as the swept tip (each pixel of the segment's capsule visited once, at the
+// coverage of its distance to the segment). A stroke keeps, per pixel, the
+// highest coverage its dabs gave it and blends the pre-stroke pixel with it, so overlapping dabs
+// do not build up. Touched pixels are kept per layer tile, allocated on first touch: their
+// coverage, a coverage word per row and the pixels as they were before the stroke, so undo and
+// redo walk the rows of the touched tiles. The first redo() only drops the live state.
 class StrokeCommand final : public Command
 {
    public:
-    StrokeCommand(Document* doc, std::uint64_t layerId, ToolParams params, ApplyFn apply);
+    StrokeCommand(Document* doc, std::uint64_t layerId, ToolParams params);
 
-    void addPoint(common::Point p);
+    // Returns the document-space area repainted by the new segment.
+    common::Rect addPoint(common::Point p);
+    // Same for a batch of points (one input frame); returns the union of their areas.
+    common::Rect addPoints(std::span<const common::Point> points);
 
     void redo() override;
     void undo() override;
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override;
 
    private:
-    void buildChanges();
+    static constexpr int kTile = ImageBuffer::kTileSize;
+
+    struct Tile
+    {
+        int x0;  // layer-local origin
+        int y0;
+        std::array<std::uint64_t, kTile> covered{};  // bit i of row r: pixel (x0 + i, y0 + r)
+        std::array<std::uint8_t, kTile * kTile> coverage{};
+        std::array<ImageBuffer::Pixel, kTile * kTile> before;
+    };
+
+    [[nodiscard]] std::shared_ptr<ImageBuffer> image() const;
+    [[nodiscard]] std::uint32_t paint(std::uint32_t before, std::uint8_t coverage) const;
+    Tile& tileAt(int x, int y);
+    void stampDab(int cx, int cy);
+    // Dabs every spacing pixels along a -> b, carrying the leftover distance to the next point.
+    void placeDabs(common::Point a, common::Point b);
+    void sweepSegment(common::Point a, common::Point b);
+    // Paints layer row y in [x0, x1) (clipped to the layer) at coverage[x - x0], through the
+    // selection.
+    void paintRow(int x0, int x1, int y, const std::uint8_t* coverage);
+    // Raises the coverage of layer row y in [x0, x1) (within one tile) to dab[0..] and
+    // reblends the pixels it raised.
+    void paintRun(ImageBuffer& img, int x0, int x1, int y, const std::uint8_t* dab);
+    // Writes the covered pixels of every tile back: their before value, or the blend of it.
+    void writeTiles(ImageBuffer& img, bool useBefore) const;
 
     Document* doc_{nullptr};
     std::uint64_t layerId_{0};
     ToolParams params_{};
-    ApplyFn apply_;
 
-    std::vector<common::Point> points_;
-    std::vector<PixelChange> changes_;
-    bool built_{false};
+    // live stroke state, valid until the first redo()
+    std::shared_ptr<ImageBuffer> img_;
+    std::shared_ptr<const core::BrushTip> tip_;
+    common::Point layerOffset_{};
+    std::optional<SelectionView> selection_;
+    std::vector<Tile*> tileDirectory_;  // tile columns x rows, nullptr = untouched
+    std::optional<common::Point> last_;
+    double untilNextDab_{0.0};          // spaced: path length left before the next dab
+    std::vector<std::uint8_t> sweepRow_;  // unspaced: coverage of the row being swept
+    common::Rect segmentArea_;  // layer-local bounds of the pixels of the current segment
+
+    std::vector<std::unique_ptr<Tile>> tiles_;  // in first-touch order
+    common::Rect changedArea_;                  // layer-local bounds of the covered pixels
+    common::Rect invalidated_;
+    bool applied_{true};  // the stroke is in the layer
 };
 }  // namespace app::commands
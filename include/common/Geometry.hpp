@@ -3,6 +3,7 @@
 //
 
 #pragma once
+#include <algorithm>
 #include <cstdint>
 
 namespace common
@@ -20,4 +21,35 @@ struct Rect
     mutable int w{};
     mutable int h{};
 };
+
+inline bool isEmpty(const Rect& r) noexcept
+{
+    return r.w <= 0 || r.h <= 0;
+}
+
+// Smallest rect containing both; an empty rect does not contribute.
+inline Rect unite(const Rect& a, const Rect& b) noexcept
+{
+    if (isEmpty(a))
+        return b;
+    if (isEmpty(b))
+        return a;
+    const int x0 = std::min(a.x, b.x);
+    const int y0 = std::min(a.y, b.y);
+    const int x1 = std::max(a.x + a.w, b.x + b.w);
+    const int y1 = std::max(a.y + a.h, b.y + b.h);
+    return Rect{x0, y0, x1 - x0, y1 - y0};
+}
+
+// Overlap of a and b (empty rect when they do not overlap).
+inline Rect intersect(const Rect& a, const Rect& b) noexcept
+{
+    const int x0 = std::max(a.x, b.x);
+    const int y0 = std::max(a.y, b.y);
+    const int x1 = std::min(a.x + a.w, b.x + b.w);
+    const int y1 = std::min(a.y + a.h, b.y + b.h);
+    if (x0 >= x1 || y0 >= y1)
+        return Rect{};
+    return Rect{x0, y0, x1 - x0, y1 - y0};
+}
 }  // namespace common
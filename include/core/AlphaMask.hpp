@@ -0,0 +1,98 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "common/Geometry.hpp"
+
+// Single-channel coverage for selections and fill masks: 0 = outside, 255 = fully inside.
+// A8: one byte per pixel, with row/span access.
+// Bits: hard-edged masks packed to one bit per pixel (rows padded to whole 64-bit words); any
+// non-zero value is stored as 255.
+class AlphaMask
+{
+   public:
+    enum class Storage : std::uint8_t
+    {
+        A8,
+        Bits,
+    };
+
+    AlphaMask(int width, int height, Storage storage = Storage::A8);
+
+    [[nodiscard]] int width() const noexcept
+    {
+        return width_;
+    }
+    [[nodiscard]] int height() const noexcept
+    {
+        return height_;
+    }
+    [[nodiscard]] Storage storage() const noexcept
+    {
+        return storage_;
+    }
+
+    [[nodiscard]] std::uint8_t at(int x, int y) const
+    {
+        assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+        if (storage_ == Storage::A8)
+            return values_[index(x, y)];
+        const std::uint64_t word = words_[wordIndex(x, y)];
+        return ((word >> (x % 64)) & 1u) != 0 ? 255u : 0u;
+    }
+    void set(int x, int y, std::uint8_t value);
+
+    void fill(std::uint8_t value);
+    // Sets every pixel of rect (clipped to the mask) to value.
+    void fillRect(const common::Rect& rect, std::uint8_t value);
+
+    // ---- Rows and spans (A8 only) -------------------------------------------
+    [[nodiscard]] std::span<std::uint8_t> row(int y) noexcept
+    {
+        assert(storage_ == Storage::A8 && y >= 0 && y < height_);
+        return {values_.data() + index(0, y), static_cast<std::size_t>(width_)};
+    }
+    [[nodiscard]] std::span<const std::uint8_t> row(int y) const noexcept
+    {
+        assert(storage_ == Storage::A8 && y >= 0 && y < height_);
+        return {values_.data() + index(0, y), static_cast<std::size_t>(width_)};
+    }
+    [[nodiscard]] std::span<const std::uint8_t> span(int x, int y, int count) const noexcept
+    {
+        return row(y).subspan(static_cast<std::size_t>(x), static_cast<std::size_t>(count));
+    }
+
+    // Bit i set when pixel (x + i, y) is covered (non-zero), for n <= 64 pixels. Pixels outside
+    // the mask read as not covered, so x and n need not lie inside it. Both storages.
+    [[nodiscard]] std::uint64_t coverageBits(int x, int y, int n) const noexcept;
+
+    // Smallest rect holding every covered pixel, nullopt when there is none.
+    [[nodiscard]] std::optional<common::Rect> bounds() const;
+
+   private:
+    [[nodiscard]] std::size_t index(int x, int y) const noexcept
+    {
+        return static_cast<std::size_t>(y) * static_cast<std::size_t>(width_) +
+               static_cast<std::size_t>(x);
+    }
+    [[nodiscard]] std::size_t wordIndex(int x, int y) const noexcept
+    {
+        return static_cast<std::size_t>(y) * static_cast<std::size_t>(wordsPerRow_) +
+               static_cast<std::size_t>(x / 64);
+    }
+
+    int width_;
+    int height_;
+    Storage storage_;
+    int wordsPerRow_{0};
+    std::vector<std::uint8_t> values_;  // A8
+    std::vector<std::uint64_t> words_;  // Bits
+};
@@ -0,0 +1,50 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "core/BlendMode.hpp"
+#include "core/ImageBuffer.hpp"
+
+namespace core
+{
+// Instruction sets the row kernels are built for, chosen once at runtime.
+enum class SimdLevel : std::uint8_t
+{
+    Scalar,
+    Sse2,
+    Avx2,
+    Avx512,
+};
+
+// dst[i] = src[i] over dst[i] (straight alpha), the source alpha being scaled by `opacity`.
+using BlendRowFn = void (*)(const ImageBuffer::Pixel* src, ImageBuffer::Pixel* dst,
+                            std::size_t count, float opacity);
+
+// Best level supported by both the build and the running CPU.
+[[nodiscard]] SimdLevel detectedSimdLevel() noexcept;
+
+// Kernel for a given level, nullptr when that level is not available here.
+[[nodiscard]] BlendRowFn sourceOverKernel(SimdLevel level) noexcept;
+
+// Blends a whole run with the kernel of detectedSimdLevel(); src and dst have the same size.
+// Matches the float "src over dst" formula within 1 LSB per channel.
+void blendSourceOverRow(std::span<const ImageBuffer::Pixel> src,
+                        std::span<ImageBuffer::Pixel> dst, float opacity);
+
+// Row kernel for a blend mode: the mode and the opacity == 1 case are template parameters, so
+// the per-pixel loop has no switch. Normal is the source-over kernel of detectedSimdLevel().
+[[nodiscard]] BlendRowFn blendModeKernel(BlendMode mode, bool fullOpacity) noexcept;
+
+// dst = (src blended with dst by `mode`) over dst, picking the kernel once for the whole run.
+void blendRow(BlendMode mode, std::span<const ImageBuffer::Pixel> src,
+              std::span<ImageBuffer::Pixel> dst, float opacity);
+
+// Straight RGBA pixels -> premultiplied 0xAARRGGBB words (QImage::Format_ARGB32_Premultiplied),
+// each channel rounded to c * a / 255 like qPremultiply(). dst holds src.size() words.
+void premultiplyToArgb32Row(std::span<const ImageBuffer::Pixel> src, std::uint32_t* dst);
+}  // namespace core
@@ -0,0 +1,21 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#pragma once
+
+#include <cstdint>
+
+namespace core
+{
+// How a layer's colors combine with what is below it (W3C separable blend modes); the result
+// is then composited "over" with the layer alpha and opacity.
+enum class BlendMode : std::uint8_t
+{
+    Normal,
+    Multiply,
+    Screen,
+    Overlay,
+    Darken,
+    Lighten,
+};
+}  // namespace core
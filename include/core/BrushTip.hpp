@@ -0,0 +1,76 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace core
+{
+// Coverage of one round brush dab centered on a pixel, as a (2 * radius + 1) square of bytes
+// (0 = untouched, 255 = full strength), computed once per (diameter, hardness) and shared.
+// Hardness 1 is the hard aliased disc (pixel centers within diameter / 2); below 1 the
+// coverage falls off linearly to 0 half a pixel past the edge, over (1 - hardness) of the
+// radius and at least one pixel, so every soft tip is anti-aliased.
+class BrushTip
+{
+   public:
+    BrushTip(int diameter, float hardness);
+
+    // Cached tip; hardness is rounded to the percent.
+    static std::shared_ptr<const BrushTip> get(int diameter, float hardness);
+
+    [[nodiscard]] int radius() const noexcept
+    {
+        return radius_;
+    }
+    [[nodiscard]] int size() const noexcept
+    {
+        return 2 * radius_ + 1;
+    }
+    // Distance from the center past which the coverage is 0.
+    [[nodiscard]] double reach() const noexcept
+    {
+        return hard_ ? r_ : outer_;
+    }
+    // Coverage of a pixel center at squared distance distSq from the center (the tip table
+    // samples it on the pixel grid; a swept stroke samples it at the distance to its segment).
+    [[nodiscard]] std::uint8_t coverageAt(double distSq) const noexcept;
+    // Row dy (0 = top, the center is at (radius, radius)).
+    [[nodiscard]] std::span<const std::uint8_t> row(int dy) const noexcept
+    {
+        return {coverage_.data() + static_cast<std::size_t>(dy) * static_cast<std::size_t>(size()),
+                static_cast<std::size_t>(size())};
+    }
+    // Non-zero columns of row dy: [rowBegin, rowEnd), empty when rowBegin == rowEnd.
+    [[nodiscard]] int rowBegin(int dy) const noexcept
+    {
+        return extents_[static_cast<std::size_t>(dy)].begin;
+    }
+    [[nodiscard]] int rowEnd(int dy) const noexcept
+    {
+        return extents_[static_cast<std::size_t>(dy)].end;
+    }
+
+   private:
+    struct Extent
+    {
+        int begin;
+        int end;
+    };
+
+    double r_;
+    bool hard_;
+    double outer_;    // soft: coverage reaches 0 here
+    double falloff_;  // soft: over this many pixels
+    int radius_;
+    std::vector<std::uint8_t> coverage_;
+    std::vector<Extent> extents_;
+};
+
+// dst[i] = max(dst[i], src[i]) for i < n (n <= 64); returns bit i set when dst[i] grew.
+std::uint64_t raiseCoverage(std::uint8_t* dst, const std::uint8_t* src, int n) noexcept;
+}  // namespace core
@@ -1,9 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <cstddef>
 #include <cstdint>
-#include <tuple>
+#include <functional>
 #include <vector>
 
+#include "common/Geometry.hpp"
+
+class AlphaMask;
+class SelectionView;
 class ImageBuffer;
 
 namespace core
@@ -14,16 +21,130 @@ struct Color
     explicit constexpr Color(uint32_t v = 0u) noexcept : value(v) {}
 };
 
-void floodFill(ImageBuffer& buf, int startX, int startY, Color newColor);
-void floodFillWithinMask(ImageBuffer& buf, const ImageBuffer& mask, int startX, int startY,
-                         Color newColor);
+// How far a pixel may be from the seed pixel and still be filled: every channel within
+// `tolerance` (MaxChannel) or the RGBA distance within it (Euclidean), channels in 0..255.
+// Tolerance 0 is the exact match.
+enum class ColorMetric : std::uint8_t
+{
+    MaxChannel,
+    Euclidean,
+};
+
+struct FillCriteria
+{
+    int tolerance{0};  // 0..255
+    ColorMetric metric{ColorMetric::MaxChannel};
+};
+
+void floodFill(ImageBuffer& buf, int startX, int startY, Color newColor,
+               const FillCriteria& criteria = {});
+
+// The within-mask fills only reach the pixels the mask covers (non-zero). Buffer pixel (x, y)
+// reads mask pixel (x + maskOffset.x, y + maskOffset.y) and pixels off the mask are not covered,
+// so a document-sized selection clips an offset layer as it is.
+void floodFillWithinMask(ImageBuffer& buf, const AlphaMask& mask, int startX, int startY,
+                         Color newColor, const FillCriteria& criteria = {},
+                         common::Point maskOffset = {});
+
+// Pixels a fill reaches: one bit per pixel of `bounds` (buffer coordinates), rows padded to
+// whole 64-bit words, plus the single color they are filled with.
+struct FillRegion
+{
+    common::Rect bounds;  // empty when nothing is filled
+    int wordsPerRow{0};
+    std::vector<std::uint64_t> bits;
+    std::size_t count{0};  // set bits
+    Color color;
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return count == 0;
+    }
+
+    [[nodiscard]] bool contains(int x, int y) const noexcept
+    {
+        const int lx = x - bounds.x;
+        const int ly = y - bounds.y;
+        if (lx < 0 || ly < 0 || lx >= bounds.w || ly >= bounds.h)
+            return false;
+        const auto row = static_cast<std::size_t>(ly) * static_cast<std::size_t>(wordsPerRow);
+        const std::uint64_t word = bits[row + static_cast<std::size_t>(lx / 64)];
+        return ((word >> (lx % 64)) & 1u) != 0;
+    }
+
+    // fn(x0, x1, y) for every horizontal run [x0, x1) of row y inside `clip`, rows in order.
+    template <typename Fn>
+    void forEachRun(const common::Rect& clip, Fn&& fn) const
+    {
+        const common::Rect r = common::intersect(bounds, clip);
+        for (int y = r.y; y < r.y + r.h; ++y)
+        {
+            const std::uint64_t* row = bits.data() + static_cast<std::size_t>(y - bounds.y) *
+                                                         static_cast<std::size_t>(wordsPerRow);
+            int x = r.x - bounds.x;
+            const int end = r.x + r.w - bounds.x;
+            while (x < end)
+            {
+                const std::uint64_t word = row[x / 64] >> (x % 64);
+                if (word == 0)
+                {
+                    x = (x / 64 + 1) * 64;
+                    continue;
+                }
+                x += std::countr_zero(word);
+                if (x >= end)
+                    break;
+                int runEnd = x;
+                while (runEnd < end)
+                {
+                    // the shift leaves zeros on top, so a run stops at the word end at most
+                    const int ones = std::countr_one(row[runEnd / 64] >> (runEnd % 64));
+                    runEnd += ones;
+                    if (ones == 0 || runEnd % 64 != 0)
+                        break;
+                }
+                runEnd = std::min(runEnd, end);
+                fn(x + bounds.x, runEnd + bounds.x, y);
+                x = runEnd;
+            }
+        }
+    }
+
+    template <typename Fn>
+    void forEachRun(Fn&& fn) const
+    {
+        forEachRun(bounds, fn);
+    }
+};
+
+// Collect-only: the region floodFill would paint, without mutating buf.
+FillRegion floodFillCollect(const ImageBuffer& buf, int startX, int startY, Color newColor,
+                            const FillCriteria& criteria = {});
+
+FillRegion floodFillWithinMaskCollect(const ImageBuffer& buf, const AlphaMask& mask, int startX,
+                                      int startY, Color newColor,
+                                      const FillCriteria& criteria = {},
+                                      common::Point maskOffset = {});
+
+// Source produced on demand, one ImageBuffer tile (kTileSize pixels square) at a time, e.g.
+// composited from the layer stack: load(tx, ty) must write that tile of the buffer before the
+// fill reads it. Each tile is loaded at most once, and only the tiles the fill reaches are.
+using TileLoader = std::function<void(int tx, int ty)>;
+
+// Collect on a buffer filled in by `load`; selection may be null.
+FillRegion floodFillCollectLazy(const ImageBuffer& buf, const TileLoader& load,
+                                const SelectionView* selection, int startX, int startY,
+                                Color newColor, const FillCriteria& criteria = {});
+
+// Within-mask collect clipped by a layer's view of the document selection (no mask is built).
+FillRegion floodFillWithinSelectionCollect(const ImageBuffer& buf, const SelectionView& selection,
+                                           int startX, int startY, Color newColor,
+                                           const FillCriteria& criteria = {});
 
-// Collect-only: returns (x,y,oldColor) without mutating buf
-std::vector<std::tuple<int, int, uint32_t>> floodFillCollect(const ImageBuffer& buf, int startX,
-                                                             int startY, Color newColor);
+// Writes region.color into every pixel of the region, one span per run.
+void fillRegion(ImageBuffer& buf, const FillRegion& region);
 
-std::vector<std::tuple<int, int, uint32_t>> floodFillWithinMaskCollect(const ImageBuffer& buf,
-                                                                       const ImageBuffer& mask,
-                                                                       int startX, int startY,
-                                                                       Color newColor);
+// Regions growing past max(pixels, image area / 4) are labeled in parallel, tile by tile, with
+// the same result as the serial fill. Default 1 Mpx; tests lower it to reach that path.
+void setParallelFillThreshold(std::size_t pixels) noexcept;
 }  // namespace core
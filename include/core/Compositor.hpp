@@ -3,12 +3,46 @@
 //
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 class Document;
 class ImageBuffer;
+class Layer;
 
+// `out` must be a linear ImageBuffer (the composite is written row by row).
 class Compositor
 {
    public:
+    // Display framebuffer: premultiplied 0xAARRGGBB words (QImage::Format_ARGB32_Premultiplied
+    // layout), rows `stride` pixels apart. pixels points at the first pixel written.
+    struct PremultipliedTarget
+    {
+        std::uint32_t* pixels{nullptr};
+        int width{0};
+        int height{0};
+        std::ptrdiff_t stride{0};
+    };
+
     static void compose(const Document& doc, ImageBuffer& out);
     static void composeROI(const Document& doc, int x, int y, int w, int h, ImageBuffer& out);
+
+    // Composes an explicit bottom-to-top layer list over the document area starting at (x, y)
+    // and as large as out (which must lie inside the document). Hidden layers are skipped.
+    static void composeLayers(const std::vector<std::shared_ptr<Layer>>& layers, int x, int y,
+                              ImageBuffer& out);
+
+    // Same compositions written straight into a premultiplied framebuffer, the document area
+    // starting at (x, y) being as large as target. Each band is converted right after being
+    // composited, so there is no separate conversion pass.
+    static void composeInto(const Document& doc, int x, int y, const PremultipliedTarget& target);
+    static void composeLayersInto(const std::vector<std::shared_ptr<Layer>>& layers, int x, int y,
+                                  const PremultipliedTarget& target);
+
+    // Worker threads used to composite row bands (0 = one per hardware thread, the default).
+    // The output does not depend on this value.
+    static void setThreadCount(unsigned count);
+    [[nodiscard]] static unsigned threadCount();
 };
@@ -4,30 +4,221 @@
 
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <span>
 #include <vector>
 
+#include "common/Geometry.hpp"
+
 class ImageBuffer
 {
    public:
-    ImageBuffer(int width, int height);
+    // Linear: one contiguous RGBA block (data() is valid).
+    // Tiled: kTileSize x kTileSize tiles allocated on first write; unallocated tiles read as
+    // background(), so a mostly empty layer only pays for the tiles it actually touches.
+    enum class Storage : std::uint8_t
+    {
+        Linear,
+        Tiled,
+    };
+
+    static constexpr int kTileSize = 64;
+
+    // A pixel as stored in memory: bytes R,G,B,A in that order, whatever the CPU endianness.
+    // Rows and spans hand these out directly; compare or copy them as-is and only convert with
+    // toRgba()/toPixel() when the 0xRRGGBBAA packing of getPixel()/setPixel() is needed.
+    using Pixel = std::uint32_t;
+
+    static constexpr Pixel toPixel(std::uint32_t rgba) noexcept
+    {
+        if constexpr (std::endian::native == std::endian::little)
+            return byteSwap(rgba);
+        else
+            return rgba;
+    }
+    static constexpr std::uint32_t toRgba(Pixel px) noexcept
+    {
+        return toPixel(px);
+    }
+
+    ImageBuffer(int width, int height, Storage storage = Storage::Linear);
 
     [[nodiscard]] int width() const noexcept;
     [[nodiscard]] int height() const noexcept;
     [[nodiscard]] int strideBytes() const noexcept;
 
+    [[nodiscard]] Storage storage() const noexcept;
+    [[nodiscard]] bool isTiled() const noexcept;
+
+    // Unique per buffer object (a copy gets a new one) and bumped by every mutable access
+    // (setPixel, fill, non-const data/row/span...): caches key on the pair to detect changes.
+    [[nodiscard]] std::uint64_t id() const noexcept
+    {
+        return id_.value;
+    }
+    [[nodiscard]] std::uint64_t revision() const noexcept
+    {
+        return revision_;
+    }
+
+    // Contiguous pixels, only for Storage::Linear (nullptr when tiled, see toLinear()).
     uint8_t* data() noexcept;
     [[nodiscard]] const uint8_t* data() const noexcept;
 
     void fill(uint32_t rgba);
-    [[nodiscard]] uint32_t getPixel(int x, int y) const;
-    void setPixel(int x, int y, uint32_t rgba);
+    [[nodiscard]] uint32_t getPixel(int x, int y) const
+    {
+        return toRgba(pixel(x, y));
+    }
+    void setPixel(int x, int y, uint32_t rgba)
+    {
+        setPixelRaw(x, y, toPixel(rgba));
+    }
+
+    // Stored pixel, without RGBA repacking (for per-pixel algorithms that only compare/copy).
+    [[nodiscard]] Pixel pixel(int x, int y) const
+    {
+        assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+        if (!isTiled())
+            return pixels_[static_cast<std::size_t>(y) * static_cast<std::size_t>(width_) +
+                           static_cast<std::size_t>(x)];
+        return tiledPixel(x, y);
+    }
+    void setPixelRaw(int x, int y, Pixel px);
+
+    // ---- Rows and spans ----------------------------------------------------
+    // Whole row y; Storage::Linear only.
+    [[nodiscard]] std::span<Pixel> row(int y) noexcept
+    {
+        assert(!isTiled() && y >= 0 && y < height_);
+        ++revision_;
+        return {pixels_.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(width_),
+                static_cast<std::size_t>(width_)};
+    }
+    [[nodiscard]] std::span<const Pixel> row(int y) const noexcept
+    {
+        assert(!isTiled() && y >= 0 && y < height_);
+        return {pixels_.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(width_),
+                static_cast<std::size_t>(width_)};
+    }
+
+    // Every pixel, row after row; Storage::Linear only. Lets worker threads write disjoint rows
+    // without going through row() (one revision bump for the whole job).
+    [[nodiscard]] std::span<Pixel> pixels() noexcept
+    {
+        assert(!isTiled());
+        ++revision_;
+        return pixels_;
+    }
+
+    // Number of pixels contiguous in memory from (x, y) on, capped to maxCount: the rest of the
+    // row when linear, up to the tile edge when tiled.
+    [[nodiscard]] int runLength(int x, int maxCount) const noexcept
+    {
+        if (!isTiled())
+            return std::min(maxCount, width_ - x);
+        return std::min({maxCount, width_ - x, kTileSize - (x % kTileSize)});
+    }
+
+    // Sub-row [x, x + count) of row y; count must not exceed runLength(x, count). Works for both
+    // storages: the mutable overload allocates the tile, the const one reads background() for
+    // unallocated tiles.
+    [[nodiscard]] std::span<Pixel> span(int x, int y, int count);
+    [[nodiscard]] std::span<const Pixel> span(int x, int y, int count) const;
+
+    // ---- Tile directory ----------------------------------------------------
+    [[nodiscard]] int tileColumns() const noexcept;
+    [[nodiscard]] int tileRows() const noexcept;
+    [[nodiscard]] common::Rect tileRect(int tx, int ty) const noexcept;
+    [[nodiscard]] bool isTileAllocated(int tx, int ty) const noexcept;
+    [[nodiscard]] std::size_t allocatedTileCount() const noexcept;
+    // Value returned by unallocated tiles (last fill() color).
+    [[nodiscard]] uint32_t background() const noexcept;
+    // One byte per tile (row-major, tileColumns() x tileRows()), 1 when every pixel of the tile
+    // has alpha 255. Rebuilt by the first call after a write (revision change), so that first
+    // call must not race with other readers; the returned map is then safe to share.
+    [[nodiscard]] const std::vector<std::uint8_t>& opaqueTiles() const;
+
+    // Calls fn(const common::Rect&) for every allocated area intersecting `area` (buffer
+    // coordinates, already clipped). A linear buffer is a single allocation and yields one rect.
+    template <typename Fn>
+    void forEachAllocatedTile(const common::Rect& area, Fn&& fn) const
+    {
+        const int x0 = std::max(0, area.x);
+        const int y0 = std::max(0, area.y);
+        const int x1 = std::min(width_, area.x + area.w);
+        const int y1 = std::min(height_, area.y + area.h);
+        if (x0 >= x1 || y0 >= y1)
+            return;
+
+        if (!isTiled())
+        {
+            fn(common::Rect{x0, y0, x1 - x0, y1 - y0});
+            return;
+        }
+
+        for (int ty = y0 / kTileSize; ty <= (y1 - 1) / kTileSize; ++ty)
+        {
+            for (int tx = x0 / kTileSize; tx <= (x1 - 1) / kTileSize; ++tx)
+            {
+                if (!isTileAllocated(tx, ty))
+                    continue;
+                const int rx0 = std::max(x0, tx * kTileSize);
+                const int ry0 = std::max(y0, ty * kTileSize);
+                const int rx1 = std::min(x1, (tx + 1) * kTileSize);
+                const int ry1 = std::min(y1, (ty + 1) * kTileSize);
+                fn(common::Rect{rx0, ry0, rx1 - rx0, ry1 - ry0});
+            }
+        }
+    }
+
+    [[nodiscard]] ImageBuffer toLinear() const;
 
    private:
+    static constexpr std::uint32_t byteSwap(std::uint32_t v) noexcept
+    {
+        return (v >> 24) | ((v >> 8) & 0x0000FF00u) | ((v << 8) & 0x00FF0000u) | (v << 24);
+    }
+
+    [[nodiscard]] Pixel tiledPixel(int x, int y) const;
+    std::vector<Pixel>& tileForWrite(int tx, int ty);
+
+    // Fresh value for every object, copies included (see id()).
+    struct InstanceId
+    {
+        InstanceId() noexcept : value(next()) {}
+        InstanceId(const InstanceId&) noexcept : value(next()) {}
+        InstanceId& operator=(const InstanceId&) noexcept
+        {
+            value = next();
+            return *this;
+        }
+        ~InstanceId() = default;
+
+        static std::uint64_t next() noexcept;
+        std::uint64_t value;
+    };
+
+    InstanceId id_;
+    std::uint64_t revision_{0};
+
     int width_{};
     int height_{};
     int stride_{};
+    Storage storage_{Storage::Linear};
+
+    std::vector<Pixel> pixels_;
+
+    int tileCols_{0};
+    int tileRows_{0};
+    uint32_t background_{0u};
+    std::vector<Pixel> blankRow_;            // kTileSize x background, backs const spans
+    std::vector<std::vector<Pixel>> tiles_;  // row-major, empty = unallocated
 
-    std::vector<uint8_t> rgbaPixels_;
+    mutable std::vector<std::uint8_t> opaqueTiles_;
+    mutable std::uint64_t opaqueTilesRevision_{~std::uint64_t{0}};
 };
@@ -8,6 +8,8 @@
 #include <memory>
 #include <string>
 
+#include "core/BlendMode.hpp"
+
 class ImageBuffer;
 
 class Layer
@@ -32,6 +34,9 @@ class Layer
     [[nodiscard]] float opacity() const noexcept;
     void setOpacity(float opacity);
 
+    [[nodiscard]] core::BlendMode blendMode() const noexcept;
+    void setBlendMode(core::BlendMode mode);
+
     [[nodiscard]] const std::shared_ptr<ImageBuffer>& image() const noexcept;
     void setImageBuffer(std::shared_ptr<ImageBuffer> image);
 
@@ -45,6 +50,7 @@ class Layer
     bool visible_{true};
     bool locked_{false};
     float opacity_{1.0f};
+    core::BlendMode blendMode_{core::BlendMode::Normal};
     std::shared_ptr<ImageBuffer> image_;
     int offsetX_{0};
     int offsetY_{0};
@@ -0,0 +1,99 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "common/Geometry.hpp"
+#include "core/BlendMode.hpp"
+#include "core/Compositor.hpp"
+
+class Document;
+class ImageBuffer;
+class Layer;
+
+// Flattened composites of the layers below and above one "active" layer. As long as only that
+// layer changes (pixels, opacity, offset), recompositing takes three inputs instead of N.
+// Layers below are composed exactly as the Compositor does; the flattened layers above are
+// blended at once, which matches a full composite within rounding (1-2 LSB). Blend modes do
+// not flatten, so when a layer above is not Normal the layers above are blended one by one.
+class LayerStackCache
+{
+   public:
+    LayerStackCache();
+    ~LayerStackCache();
+
+    // Rebuilds both composites (document size) around layer `active`.
+    void build(const Document& doc, std::size_t active);
+
+    // True when the composites still match every layer of doc but the active one.
+    [[nodiscard]] bool isValid(const Document& doc, std::size_t active) const;
+
+    // isValid(), rebuilding first when the stack around `active` did not change since the
+    // previous call: an edit of another layer invalidates the cache without paying for a
+    // rebuild, a second edit in a row of the same active layer makes it worth it.
+    bool prepare(const Document& doc, std::size_t active);
+
+    void clear() noexcept;
+
+    // Layers [0, active) and (active, count); nullptr when empty or not built. above() is the
+    // Normal-mode flattening of its layers (see aboveIsExact()).
+    [[nodiscard]] const ImageBuffer* below() const noexcept;
+    [[nodiscard]] const ImageBuffer* above() const noexcept;
+    // False when a layer above uses a blend mode, which above() cannot represent.
+    [[nodiscard]] bool aboveIsExact() const noexcept;
+
+    // below + active layer + above over the document area (x, y, w, h) into out (w x h, linear).
+    // The cache must be valid for doc.
+    void composeROI(const Document& doc, int x, int y, int w, int h, ImageBuffer& out) const;
+    // Same, written into a premultiplied framebuffer (see Compositor::composeInto).
+    void composeInto(const Document& doc, int x, int y,
+                     const Compositor::PremultipliedTarget& target) const;
+    // Same with the active layer drawn at activeOffset instead of its own offset (layer drag
+    // preview). Exact whatever the blend modes, unlike drawing the layer over below() and
+    // under above().
+    void composeMovedInto(const Document& doc, common::Point activeOffset, int x, int y,
+                          const Compositor::PremultipliedTarget& target) const;
+
+   private:
+    struct LayerKey
+    {
+        const Layer* layer{nullptr};
+        std::uint64_t imageId{0};
+        std::uint64_t imageRevision{0};
+        bool visible{false};
+        float opacity{0.0f};
+        core::BlendMode blendMode{core::BlendMode::Normal};
+        int offsetX{0};
+        int offsetY{0};
+
+        bool operator==(const LayerKey&) const = default;
+    };
+    struct StackKey
+    {
+        int width{0};
+        int height{0};
+        std::size_t active{0};
+        std::vector<LayerKey> layers;  // the active one only records its identity
+
+        bool operator==(const StackKey&) const = default;
+    };
+
+    [[nodiscard]] static StackKey stackKey(const Document& doc, std::size_t active);
+    // below, the active layer (moved to activeOffset when given) and above (or the layers
+    // above one by one).
+    [[nodiscard]] std::vector<std::shared_ptr<Layer>> stackLayers(
+        const Document& doc, std::optional<common::Point> activeOffset = std::nullopt) const;
+
+    StackKey key_;
+    StackKey candidate_;  // stack seen by the last prepare() that did not rebuild
+    bool built_{false};
+    bool aboveIsExact_{true};
+    std::shared_ptr<Layer> below_;  // flattened composites wrapped as plain layers
+    std::shared_ptr<Layer> above_;
+};
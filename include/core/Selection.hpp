@@ -7,50 +7,150 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <cstdint>
 #include <memory>
 #include <optional>
 
 #include "common/Geometry.hpp"
+#include "core/SpanMask.hpp"
 
-class ImageBuffer;
+class AlphaMask;
 
+// A layer's window on the document selection: layer pixel (x, y) is document pixel
+// (x + offset.x, y + offset.y). It reads the selection spans in place, so clipping a layer costs
+// nothing for rows without spans and no layer-sized mask is ever built.
+class SelectionView
+{
+   public:
+    SelectionView(const SpanMask& spans, common::Point offset, int width, int height) noexcept
+        : spans_(&spans), offset_(offset), width_(width), height_(height)
+    {
+    }
+
+    [[nodiscard]] int width() const noexcept
+    {
+        return width_;
+    }
+    [[nodiscard]] int height() const noexcept
+    {
+        return height_;
+    }
+
+    // Layer row y has no selected pixel.
+    [[nodiscard]] bool rowEmpty(int y) const noexcept
+    {
+        return docRow(y) < 0 || spans_->row(docRow(y)).empty();
+    }
+    [[nodiscard]] std::uint8_t at(int x, int y) const noexcept
+    {
+        if (x < 0 || y < 0 || x >= width_ || y >= height_)
+            return 0;
+        return spans_->at(x + offset_.x, y + offset_.y);
+    }
+
+    // fn(x0, x1, coverage) for every selected run [x0, x1) of layer row y inside [from, to)
+    // (and inside the layer), in layer coordinates, left to right.
+    template <typename Fn>
+    void forEachSpan(int y, int from, int to, Fn&& fn) const
+    {
+        const int row = docRow(y);
+        from = std::max(from, 0);
+        to = std::min(to, width_);
+        if (row < 0 || from >= to)
+            return;
+        const auto spans = spans_->row(row);
+        const int docFrom = from + offset_.x;
+        // first span ending past docFrom
+        auto it = std::upper_bound(spans.begin(), spans.end(), docFrom,
+                                   [](int x, const SpanMask::Span& s) { return x < s.x1; });
+        for (; it != spans.end() && it->x0 - offset_.x < to; ++it)
+            fn(std::max(it->x0 - offset_.x, from), std::min(it->x1 - offset_.x, to), it->coverage);
+    }
+
+    // Bit i set when layer pixel (x + i, y) is selected, n <= 64.
+    [[nodiscard]] std::uint64_t coverageBits(int x, int y, int n) const noexcept
+    {
+        std::uint64_t bits = 0;
+        forEachSpan(y, x, x + n,
+                    [&](int x0, int x1, std::uint8_t)
+                    {
+                        const int len = x1 - x0;
+                        const std::uint64_t ones =
+                            len >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << len) - 1;
+                        bits |= ones << (x0 - x);
+                    });
+        return bits;
+    }
+
+   private:
+    // Document row of layer row y, -1 when either is out of range.
+    [[nodiscard]] int docRow(int y) const noexcept
+    {
+        const int row = y + offset_.y;
+        if (y < 0 || y >= height_ || row < 0 || row >= spans_->height())
+            return -1;
+        return row;
+    }
+
+    const SpanMask* spans_;
+    common::Point offset_;
+    int width_;
+    int height_;
+};
+
+// Selected area, kept as scanline spans (SpanMask). The per-pixel AlphaMask is only built when
+// mask() is asked for, and dropped again by the next edit.
 class Selection
 {
    public:
     Selection() = default;
     using Rect = common::Rect;
-    explicit Selection(std::shared_ptr<ImageBuffer> mask) : mask_(std::move(mask)) {}
+    explicit Selection(std::shared_ptr<AlphaMask> mask)
+    {
+        setMask(std::move(mask));
+    }
 
     [[nodiscard]] bool hasMask() const noexcept
     {
-        return static_cast<bool>(mask_);
+        return spans_.has_value();
     }
     uint8_t t_at(int x, int y) const;
 
-    void addRect(
-        const Rect& rect,
-        const std::shared_ptr<ImageBuffer>& reference =
-            std::shared_ptr<ImageBuffer>())  // NOLINT(bugprone-easily-swappable-parameters)
+    // Without a mask yet, one of maskWidth x maskHeight is created (nothing happens when those
+    // are not given).
+    void addRect(const Rect& rect, int maskWidth = 0,
+                 int maskHeight = 0)  // NOLINT(bugprone-easily-swappable-parameters)
         ;
     void subtractRect(const Rect& rect)  // NOLINT(bugprone-easily-swappable-parameters)
         ;
+    void intersectRect(const Rect& rect);
+    void invert();
     void clear() noexcept
     {
+        spans_.reset();
         mask_.reset();
     }
 
-    void setMask(std::shared_ptr<ImageBuffer> mask)
+    // Selects mask's coverage as it is now: later writes to it are not seen.
+    void setMask(std::shared_ptr<AlphaMask> mask);
+    // Per-pixel coverage, rasterized from the spans on first use after an edit.
+    [[nodiscard]] const std::shared_ptr<AlphaMask>& mask() const;
+    [[nodiscard]] const std::optional<SpanMask>& spans() const noexcept
     {
-        mask_ = std::move(mask);
+        return spans_;
     }
-    [[nodiscard]] const std::shared_ptr<ImageBuffer>& mask() const noexcept
+    // Selection as seen by a width x height layer at `offset`; hasMask() must be true.
+    [[nodiscard]] SelectionView view(common::Point offset, int width, int height) const
     {
-        return mask_;
+        assert(spans_);
+        return SelectionView{*spans_, offset, width, height};
     }
 
     [[nodiscard]] std::optional<Rect> boundingRect() const;
 
    private:
-    std::shared_ptr<ImageBuffer> mask_;
+    std::optional<SpanMask> spans_;
+    mutable std::shared_ptr<AlphaMask> mask_;  // raster cache of spans_
 };
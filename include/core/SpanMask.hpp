@@ -0,0 +1,77 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "common/Geometry.hpp"
+
+class AlphaMask;
+
+// Coverage stored as scanline intervals: per row, sorted non-overlapping [x0, x1) spans with a
+// non-zero coverage (adjacent spans of equal coverage are merged). Rectangle edits cost one
+// pass over the spans of the rows they touch and at() is a binary search, whatever the size of
+// the area covered. The bounds are kept up to date by the edits: adding only grows them, and
+// the other edits re-measure the rows inside them only when they may have shrunk.
+class SpanMask
+{
+   public:
+    struct Span
+    {
+        int x0;
+        int x1;
+        std::uint8_t coverage;
+    };
+
+    SpanMask(int width, int height);
+    // Runs of equal non-zero values of mask.
+    static SpanMask fromMask(const AlphaMask& mask);
+
+    [[nodiscard]] int width() const noexcept
+    {
+        return width_;
+    }
+    [[nodiscard]] int height() const noexcept
+    {
+        return static_cast<int>(rows_.size());
+    }
+
+    [[nodiscard]] std::span<const Span> row(int y) const noexcept
+    {
+        return rows_[static_cast<std::size_t>(y)];
+    }
+    // 0 outside the mask.
+    [[nodiscard]] std::uint8_t at(int x, int y) const noexcept;
+    [[nodiscard]] bool empty() const noexcept;
+    // Smallest rect holding every covered pixel, nullopt when there is none.
+    [[nodiscard]] const std::optional<common::Rect>& bounds() const noexcept
+    {
+        return bounds_;
+    }
+
+    // Rect edits are clipped to the mask.
+    void addRect(const common::Rect& rect, std::uint8_t coverage = 0xFFu);
+    void subtractRect(const common::Rect& rect);
+    void intersectRect(const common::Rect& rect);
+    // coverage -> 255 - coverage over the whole mask.
+    void invert();
+
+    // Writes every pixel of out (which must have the same size).
+    void rasterize(AlphaMask& out) const;
+
+   private:
+    // Replaces the coverage c of every pixel of row y in [x0, x1) (spans and gaps alike) by f(c).
+    template <typename F>
+    void applyRow(int y, int x0, int x1, F&& f);
+
+    // Bounds of the spans of the rows inside the current bounds (rows outside are empty).
+    void remeasureBounds();
+
+    int width_;
+    std::vector<std::vector<Span>> rows_;
+    std::optional<common::Rect> bounds_;
+};
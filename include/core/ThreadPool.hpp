@@ -0,0 +1,53 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core
+{
+// Fixed set of worker threads running index loops. The calling thread takes part in the work,
+// so a pool of size 1 has no worker and runs everything inline.
+class ThreadPool
+{
+   public:
+    explicit ThreadPool(unsigned threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Workers + calling thread.
+    [[nodiscard]] unsigned size() const noexcept;
+
+    // Calls fn(i) for every i in [0, count) and returns once all calls are done. Calls to
+    // parallelFor from different threads are serialized; the first exception is rethrown here.
+    void parallelFor(int count, const std::function<void(int)>& fn);
+
+   private:
+    void workerLoop();
+    void runTasks();
+
+    std::vector<std::thread> workers_;
+
+    std::mutex callMutex_;  // one parallelFor at a time
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(int)>* fn_{nullptr};
+    int count_{0};
+    int next_{0};
+    int pending_{0};  // tasks not finished yet
+    std::size_t generation_{0};
+    bool stop_{false};
+    std::exception_ptr error_;
+};
+}  // namespace core
@@ -5,6 +5,7 @@
 #include <QColor>
 #include <QImage>
 #include <QPointF>
+#include <QTimer>
 #include <QWidget>
 
 #include <optional>
@@ -27,6 +28,12 @@ class CanvasWidget : public QWidget
         return img_.size();
     }
     void setImage(const QImage& img);
+    // Displayed image, for in-place partial updates; call imageUpdated() afterwards.
+    QImage& image()
+    {
+        return img_;
+    }
+    void imageUpdated(const common::Rect& docArea);
     void clear();
 
     void setSelectionEnable(bool enable);
@@ -37,7 +44,9 @@ class CanvasWidget : public QWidget
 
     void setMoveLayerEnable(bool enable);
 
-    void setDragLayerPreview(const QImage& layerImg, int x, int y);
+    // aboveImg: layers above the dragged one, flattened (document size), drawn over it
+    void setDragLayerPreview(const QImage& layerImg, int x, int y,
+                             const QImage& aboveImg = QImage());
     void setDragLayerPos(int x, int y);
     void clearDragLayerPreview();
 
@@ -71,7 +80,8 @@ class CanvasWidget : public QWidget
     void endDragDoc(common::Point p);
 
     void beginStroke(common::Point p);
-    void moveStroke(common::Point p);
+    // Pointer samples since the previous batch, at most one batch per display frame.
+    void moveStroke(const std::vector<common::Point>& samples);
     void endStroke();
 
    protected:
@@ -82,6 +92,8 @@ class CanvasWidget : public QWidget
     void mouseReleaseEvent(QMouseEvent*) override;
 
    private:
+    void flushStrokeSamples();
+
     QImage img_;
     double scale_ = 1.0;
     QPointF pan_ = {0, 0};
@@ -96,7 +108,8 @@ class CanvasWidget : public QWidget
     //draw
     bool pencilEnabled_ = false;
     bool drawing_ = false;
-    std::vector<common::Point> previewPoints_;
+    std::vector<common::Point> pendingStroke_;  // samples not sent yet
+    QTimer strokeFrameTimer_;
     QColor pencilColor_ = QColor(0, 0, 0, 255);
     int pencilSize_ = 1;
     double pencilOpacity_ = 1.0;
@@ -117,6 +130,7 @@ class CanvasWidget : public QWidget
     // drag preview
     bool dragLayerPreviewOn_ = false;
     QImage dragLayerImg_;
+    QImage dragAboveImg_;
     QPoint dragLayerPos_{0, 0};
 
     void drawChecker(QPainter& p);
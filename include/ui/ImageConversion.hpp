@@ -13,8 +13,8 @@ namespace ImageConversion
  * @param height The height of the output ImageBuffer
  * @return An ImageBuffer containing the converted image data
  * 
- * This function converts a QImage to an ImageBuffer by iterating through pixels
- * and converting from Qt's ARGB format to our RGBA format.
+ * This function converts a QImage to an ImageBuffer row by row, going through
+ * QImage::Format_RGBA8888 whose memory layout matches ImageBuffer pixels.
  * The conversion only processes pixels within the bounds of both the source image
  * and the specified output dimensions.
  */
@@ -5,10 +5,51 @@
 #pragma once
 #include <QImage>
 
+#include <cstddef>
+#include <optional>
+
+#include "common/Geometry.hpp"
 #include "core/Document.hpp"
+#include "core/LayerStackCache.hpp"
 
 class Renderer
 {
    public:
+    Renderer();
+    ~Renderer();
+
+    // Display framebuffer format: the compositor writes it directly and QPainter draws it
+    // without converting.
+    static constexpr QImage::Format kFormat = QImage::Format_ARGB32_Premultiplied;
+
     static QImage render(const Document& doc);
+
+    // Keeps `target` (kFormat, document size) in sync with doc, recompositing only `dirty`
+    // (document coordinates, nullopt = everything) in place. Returns the document area
+    // rewritten.
+    // With an active layer, partial updates go through layerStack() once it holds.
+    common::Rect update(const Document& doc, std::optional<common::Rect> dirty, QImage& target,
+                        std::optional<std::size_t> activeLayer = std::nullopt);
+
+    // Recomposites `area` of target (kFormat, document size) with layer `active` drawn at
+    // `offset`: the exact layer drag preview, for stacks the cached preview cannot show (see
+    // LayerStackCache::aboveIsExact()). Returns the document area rewritten.
+    common::Rect updateMovedLayer(const Document& doc, std::size_t active, common::Point offset,
+                                  const common::Rect& area, QImage& target);
+
+    // Below/above composites around the active layer, shared with the layer drag preview.
+    LayerStackCache& layerStack() noexcept
+    {
+        return stack_;
+    }
+
+    // Next update() recomposites everything (target was replaced by someone else).
+    void invalidate() noexcept
+    {
+        valid_ = false;
+    }
+
+   private:
+    bool valid_{false};
+    LayerStackCache stack_;
 };
@@ -24,6 +24,7 @@
 #include <optional>
 
 #include "app/AppService.hpp"
+#include "ui/Render.hpp"
 
 // Définitions pour les analyseurs (clangd) qui ne connaissent pas la
 // macro `slots`. Ne pas redéfinir pour `moc`.
@@ -39,6 +40,8 @@ class CanvasWidget;
 class QToolBar;
 class QActionGroup;
 class QSpinBox;
+class QComboBox;
+class QCheckBox;
 
 class MainWindow : public QMainWindow
 {
@@ -92,6 +95,7 @@ class MainWindow : public QMainWindow
 
     void syncStrokeToolState();
     void refreshUIAfterDocChange();
+    void refreshCanvas();
     void updateLayerOverlayFromSelection();
     void clearUiStateOnClose();
 
@@ -173,8 +177,15 @@ class MainWindow : public QMainWindow
     std::size_t m_dragLayerIdx{0};
     common::Point m_dragStartDoc{0, 0};
     common::Point m_dragStartOffset{0, 0};
-    QImage m_dragBaseImage;   // rendu "base" pendant le drag (doc sans le layer déplacé)
+    QImage m_dragBaseImage;   // calques sous le layer déplacé, aplatis
     QImage m_dragLayerImage;  // image du layer déplacé (seul)
+    QImage m_dragAboveImage;  // calques au-dessus, aplatis (vide s'il n'y en a pas)
+    // faux quand un mode de fusion empêche l'aperçu par images aplaties : chaque pas du
+    // déplacement recompose alors la zone touchée
+    bool m_dragPreviewFlattened{true};
+    common::Rect m_dragLastRect;  // zone du layer au dernier pas (aperçu recomposé)
+
+    Renderer m_renderer;  // garde l'image du canvas à jour, zone modifiée seulement
 
     QColor m_toolColor{Qt::black};
 
@@ -182,11 +193,22 @@ class MainWindow : public QMainWindow
     QDockWidget* m_pencilDock{nullptr};
     QSpinBox* m_pencilSizeSpin{nullptr};
     QSpinBox* m_pencilOpacitySpin{nullptr};
+    QSpinBox* m_pencilHardnessSpin{nullptr};
+    QSpinBox* m_pencilSpacingSpin{nullptr};
+    QComboBox* m_pencilSmoothingCombo{nullptr};
+
+    QDockWidget* m_bucketDock{nullptr};
+    QSpinBox* m_bucketToleranceSpin{nullptr};
+    QComboBox* m_bucketMetricCombo{nullptr};
+    QCheckBox* m_bucketSampleMergedCheck{nullptr};
 
     QAction* m_eraseAct{nullptr};
     QDockWidget* m_eraseDock{nullptr};
     QSpinBox* m_eraseSizeSpin{nullptr};
     QSpinBox* m_eraseOpacitySpin{nullptr};
+    QSpinBox* m_eraseHardnessSpin{nullptr};
+    QSpinBox* m_eraseSpacingSpin{nullptr};
+    QComboBox* m_eraseSmoothingCombo{nullptr};
 
     bool m_handMode{false};
     bool m_panningActive{false};
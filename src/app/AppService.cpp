@@ -5,7 +5,9 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <optional>
 #include <stdexcept>
+#include <utility>
 
 #include "app/Command.hpp"
 #include "app/commands/CommandUtils.hpp"
@@ -14,6 +16,7 @@
 #include "app/ToolParams.hpp"
 #include "common/Colors.hpp"
 #include "core/BucketFill.hpp"
+#include "core/Compositor.hpp"
 #include "core/Document.hpp"
 #include "core/ImageBuffer.hpp"
 #include "core/Layer.hpp"
@@ -62,6 +65,7 @@ void AppService::closeDocument()
     dirty_ = false;
     activeLayer_ = 0;
     nextLayerId_ = 1;
+    invalidate(std::nullopt);
     documentChanged.notify();
 }
 
@@ -81,6 +85,7 @@ void AppService::newDocument(Size size, float dpi, std::uint32_t bgColor)
     auto layer = std::make_shared<Layer>(0, "Background", img, true, false, 1.f);
     doc_->addLayer(std::move(layer));
 
+    invalidate(std::nullopt);
     documentChanged.notify();
 }
 
@@ -111,6 +116,7 @@ void AppService::open(const std::string& path)
     activeLayer_ = pickEditableLayerIndex(*doc_);
 
     nextLayerId_ = computeNextLayerId(*doc_);
+    invalidate(std::nullopt);
     documentChanged.notify();
 }
 
@@ -134,14 +140,22 @@ void AppService::replaceBackgroundWithImage(const ImageBuffer& img, std::string
     const int copyH = std::min(out->height(), img.height());
 
     for (int y = 0; y < copyH; ++y)
-        for (int x = 0; x < copyW; ++x)
-            out->setPixel(x, y, img.getPixel(x, y));
+    {
+        const auto dstRow = out->row(y);
+        for (int x = 0; x < copyW;)
+        {
+            const auto src = img.span(x, y, img.runLength(x, copyW - x));
+            std::copy(src.begin(), src.end(), dstRow.begin() + x);
+            x += static_cast<int>(src.size());
+        }
+    }
 
     bg->setImageBuffer(out);
     bg->setName(std::move(name));
 
     activeLayer_ = 0;  // logique : on travaille sur le BG qui contient l’image
     history_.clear();  // ouvrir une image = nouvel état, pas d’historique
+    invalidate(std::nullopt);
     documentChanged.notify();
 }
 
@@ -252,7 +266,10 @@ void AppService::addLayer(const LayerSpec& spec)
     if (w == 0 || h == 0)
         throw std::invalid_argument("addLayer: invalid layer size");
 
-    auto img = std::make_shared<ImageBuffer>(w, h);
+    // a transparent layer starts empty: keep it sparse until something is drawn on it
+    const auto storage = (spec.color & 0xFFu) == 0 ? ImageBuffer::Storage::Tiled
+                                                   : ImageBuffer::Storage::Linear;
+    auto img = std::make_shared<ImageBuffer>(w, h, storage);
     img->fill(spec.color);
 
     auto layer = std::make_shared<Layer>(nextLayerId_++, spec.name, img, spec.visible, spec.locked,
@@ -267,10 +284,7 @@ void AppService::addImageLayer(const ImageBuffer& img, std::string name, bool vi
 {
     if (!doc_)
         throw std::runtime_error("addImageLayer: document is null");
-    auto out = std::make_shared<ImageBuffer>(img.width(), img.height());
-    for (int y = 0; y < img.height(); ++y)
-        for (int x = 0; x < img.width(); ++x)
-            out->setPixel(x, y, img.getPixel(x, y));
+    auto out = std::make_shared<ImageBuffer>(img.toLinear());
 
     auto layer = std::make_shared<Layer>(nextLayerId_++,
                                          name.empty() ? std::string("Layer") : std::move(name), out,
@@ -379,10 +393,11 @@ static std::shared_ptr<ImageBuffer> scaleNearest(const ImageBuffer& src, int new
     for (int y = 0; y < newH; ++y)
     {
         const int sy = (y * src.height()) / newH;
+        const auto dstRow = dst->row(y);
         for (int x = 0; x < newW; ++x)
         {
             const int sx = (x * src.width()) / newW;
-            dst->setPixel(x, y, src.getPixel(sx, sy));
+            dstRow[static_cast<std::size_t>(x)] = src.pixel(sx, sy);
         }
     }
     return dst;
@@ -425,12 +440,8 @@ void AppService::duplicateLayer(std::size_t idx)
     if (!src || !src->image())
         throw std::runtime_error("duplicateLayer: invalid layer");
 
-    // deep copy image
-    auto srcImg = src->image();
-    auto copyImg = std::make_shared<ImageBuffer>(srcImg->width(), srcImg->height());
-    for (int y = 0; y < srcImg->height(); ++y)
-        for (int x = 0; x < srcImg->width(); ++x)
-            copyImg->setPixel(x, y, srcImg->getPixel(x, y));
+    // deep copy image (keeps the storage mode: a sparse layer stays sparse)
+    auto copyImg = std::make_shared<ImageBuffer>(*src->image());
 
     // name suffix
     std::string newName = src->name();
@@ -442,6 +453,7 @@ void AppService::duplicateLayer(std::size_t idx)
     auto duplicated = std::make_shared<Layer>(nextLayerId_++, newName, copyImg, src->visible(),
                                               src->locked(), src->opacity());
     duplicated->setOffset(src->offsetX(), src->offsetY());
+    duplicated->setBlendMode(src->blendMode());
 
     const std::size_t insertAt = idx + 1;  // juste au-dessus du layer original
     apply(commands::makeDuplicateLayerCommand(doc_.get(), std::move(duplicated), insertAt,
@@ -469,41 +481,33 @@ void AppService::beginStroke(const ToolParams& params, common::Point pStart)
 
     const std::uint64_t layerId = layer->id();
 
-    ApplyFn applyFn = [doc = doc_.get()](std::uint64_t id, const std::vector<PixelChange>& changes,
-                                         bool useBefore)
-    {
-        if (!doc)
-            return;
-        auto idx = commands::findLayerIndexById(*doc, id);
-        if (!idx)
-            return;
-
-        auto layer2 = doc->layerAt(*idx);
-        if (!layer2 || !layer2->image())
-            return;
-        auto img = layer2->image();
-
-        for (const auto& ch : changes)
-        {
-            img->setPixel(ch.x, ch.y, useBefore ? ch.before : ch.after);
-        }
-    };
-    currentStroke_ =
-        std::make_unique<commands::StrokeCommand>(doc_.get(), layerId, params, std::move(applyFn));
-    currentStroke_->addPoint(pStart);
+    currentStroke_ = std::make_unique<commands::StrokeCommand>(doc_.get(), layerId, params);
+    strokeSmoother_.emplace(params.smoothing, pStart);
+    invalidate(currentStroke_->addPoint(pStart));
 }
 
 void AppService::moveStroke(common::Point p)
+{
+    moveStroke(std::span<const common::Point>(&p, 1));
+}
+
+void AppService::moveStroke(std::span<const common::Point> samples)
 {
     if (!currentStroke_)
         return;
-    currentStroke_->addPoint(p);
+    strokePoints_.clear();
+    strokeSmoother_->push(samples, strokePoints_);
+    invalidate(currentStroke_->addPoints(strokePoints_));
 }
 
 void AppService::endStroke()
 {
     if (!currentStroke_)
         return;
+    strokePoints_.clear();
+    strokeSmoother_->finish(strokePoints_);
+    invalidate(currentStroke_->addPoints(strokePoints_));
+    strokeSmoother_.reset();
     apply(std::move(currentStroke_));
 }
 
@@ -549,7 +553,7 @@ void AppService::setSelectionRect(Selection::Rect r)
         documentChanged.notify();
         return;
     }
-    doc_->selection().addRect(r, std::make_shared<ImageBuffer>(doc_->width(), doc_->height()));
+    doc_->selection().addRect(r, doc_->width(), doc_->height());
     documentChanged.notify();
 }
 
@@ -561,7 +565,8 @@ void AppService::clearSelectionRect()
     documentChanged.notify();
 }
 
-void AppService::bucketFill(common::Point p, std::uint32_t rgba)
+void AppService::bucketFill(common::Point p, std::uint32_t rgba,
+                            const core::FillCriteria& criteria, bool sampleMerged)
 {
     if (!doc_)
         throw std::runtime_error("bucketFill: document is null");
@@ -579,10 +584,12 @@ void AppService::bucketFill(common::Point p, std::uint32_t rgba)
     auto img = layer->image();
     const int w = img->width();
     const int h = img->height();
+    const int offX = layer->offsetX();
+    const int offY = layer->offsetY();
 
     //layer local pos
-    const int lx = p.x - layer->offsetX();
-    const int ly = p.y - layer->offsetY();
+    const int lx = p.x - offX;
+    const int ly = p.y - offY;
 
     if (lx < 0 || ly < 0 || lx >= w || ly >= h)
         return;
@@ -597,53 +604,60 @@ void AppService::bucketFill(common::Point p, std::uint32_t rgba)
             return;
     }
 
-    // --- Work on a copy to compute tracked changes WITHOUT mutating the document yet
-
-    std::vector<std::tuple<int, int, std::uint32_t>> changedPixels;
-    if (sel.hasMask() && sel.mask())
+    // Sampled area in document coordinates: the layer, or only its part inside the document
+    // when sampling the composite (which has nothing outside it).
+    common::Rect area{offX, offY, w, h};
+    if (sampleMerged)
     {
-        ImageBuffer maskLocal(w, h);
-        maskLocal.fill(0u);
+        area = common::intersect(area, common::Rect{0, 0, doc_->width(), doc_->height()});
+        if (p.x < area.x || p.y < area.y || p.x >= area.x + area.w || p.y >= area.y + area.h)
+            return;
+    }
 
-        const int offX = layer->offsetX();
-        const int offY = layer->offsetY();
+    // the selection clips the fill through its spans, seen from the sampled area
+    std::optional<SelectionView> selView;
+    if (sel.hasMask())
+        selView.emplace(sel.view(common::Point{area.x, area.y}, area.w, area.h));
+
+    // --- Work on a copy to compute tracked changes WITHOUT mutating the document yet
 
-        for (int y = 0; y < h; ++y)
+    core::FillRegion region;
+    if (sampleMerged)
+    {
+        // the composite is only built for the tiles the fill reaches
+        ImageBuffer merged(area.w, area.h, ImageBuffer::Storage::Tiled);
+        const auto composeTile = [&](int tx, int ty)
         {
-            for (int x = 0; x < w; ++x)
+            const common::Rect r = merged.tileRect(tx, ty);
+            ImageBuffer composed(r.w, r.h);
+            Compositor::composeROI(*doc_, area.x + r.x, area.y + r.y, r.w, r.h, composed);
+            for (int y = 0; y < r.h; ++y)
             {
-                const int dx = x + offX;
-                const int dy = y + offY;
-
-                // outside doc -> not selected
-                if (dx < 0 || dy < 0 || dx >= doc_->width() || dy >= doc_->height())
-                {
-                    maskLocal.setPixel(x, y, 0u);
-                    continue;
-                }
-                const std::uint8_t t = sel.t_at(dx, dy);
-                maskLocal.setPixel(x, y, t ? 0xFFFFFFFFu : 0u);
+                const auto src = std::as_const(composed).row(y);
+                std::copy(src.begin(), src.end(), merged.span(r.x, r.y + y, r.w).begin());
             }
-        }
-        changedPixels =
-            core::floodFillWithinMaskCollect(*img, maskLocal, lx, ly, core::Color{rgba});
+        };
+        region = core::floodFillCollectLazy(merged, composeTile, selView ? &*selView : nullptr,
+                                            p.x - area.x, p.y - area.y, core::Color{rgba},
+                                            criteria);
+        // sampled area -> layer coordinates
+        region.bounds.x += area.x - offX;
+        region.bounds.y += area.y - offY;
+    }
+    else if (selView)
+    {
+        region = core::floodFillWithinSelectionCollect(*img, *selView, lx, ly, core::Color{rgba},
+                                                       criteria);
     }
     else
     {
-        changedPixels = core::floodFillCollect(*img, lx, ly, core::Color{rgba});
+        region = core::floodFillCollect(*img, lx, ly, core::Color{rgba}, criteria);
     }
 
-    if (changedPixels.empty())
+    if (region.empty())
         return;
 
-    // --- Convert to PixelChange list (before/after) for DataCommand
-    std::vector<PixelChange> changes;
-    changes.reserve(changedPixels.size());
-    for (const auto& [x, y, oldColor] : changedPixels)
-        changes.push_back(PixelChange{x, y, oldColor, rgba});
-
-    const std::uint64_t layerId = layer->id();
-    apply(commands::makePixelChangesCommand(doc_.get(), layerId, std::move(changes)));
+    apply(commands::makeBucketFillCommand(doc_.get(), layer->id(), std::move(region)));
 }
 
 void AppService::undo()
@@ -651,7 +665,8 @@ void AppService::undo()
     if (!history_.canUndo())
         return;
 
-    history_.undo();
+    if (const auto* cmd = history_.undo())
+        invalidate(cmd->invalidatedRect());
     documentChanged.notify();
 }
 
@@ -660,7 +675,8 @@ void AppService::redo()
     if (!history_.canRedo())
         return;
 
-    history_.redo();
+    if (const auto* cmd = history_.redo())
+        invalidate(cmd->invalidatedRect());
     documentChanged.notify();
 }
 
@@ -680,9 +696,25 @@ void AppService::apply(History::CommandPtr cmd)
         return;
 
     cmd->redo();
+    invalidate(cmd->invalidatedRect());
     history_.push(std::move(cmd));
     dirty_ = true;
     documentChanged.notify();
 }
 
+void AppService::invalidate(std::optional<common::Rect> rect)
+{
+    if (!invalidated_)
+        return;  // already everything
+    if (!rect)
+        invalidated_.reset();
+    else
+        invalidated_ = common::unite(*invalidated_, *rect);
+}
+
+std::optional<common::Rect> AppService::takeInvalidatedRect()
+{
+    return std::exchange(invalidated_, common::Rect{});
+}
+
 }  // namespace app
\ No newline at end of file
@@ -40,26 +40,28 @@ bool History::canRedo() const noexcept
     return !redo_.empty();
 }
 
-void History::undo()
+app::Command* History::undo()
 {
     if (!canUndo())
-        return;
+        return nullptr;
 
     auto cmd = std::move(undo_.back());
     undo_.pop_back();
     cmd->undo();
     redo_.push_back(std::move(cmd));
+    return redo_.back().get();
 }
 
-void History::redo()
+app::Command* History::redo()
 {
     if (!canRedo())
-        return;
+        return nullptr;
 
     auto cmd = std::move(redo_.back());
     redo_.pop_back();
     cmd->redo();
     undo_.push_back(std::move(cmd));
+    return undo_.back().get();
 }
 
 void History::clear()
@@ -0,0 +1,114 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include "app/StrokeSmoother.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace app
+{
+namespace
+{
+// Curve points are taken about every kCurveStep pixels (the stroke joins them with segments).
+constexpr double kCurveStep = 2.0;
+}  // namespace
+
+StrokeSmoother::StrokeSmoother(const StrokeSmoothing mode, const common::Point start,
+                               const double stabilizerRadius)
+    : mode_(mode), stabilizerRadius_(std::max(0.0, stabilizerRadius)), last_(start)
+{
+    const Vec s{static_cast<double>(start.x), static_cast<double>(start.y)};
+    controls_ = {s, s, s};
+    pen_ = s;
+    pointer_ = s;
+}
+
+void StrokeSmoother::emit(const Vec p, std::vector<common::Point>& out)
+{
+    const common::Point q{static_cast<int>(std::lround(p.x)), static_cast<int>(std::lround(p.y))};
+    if (q.x == last_.x && q.y == last_.y)
+        return;
+    out.push_back(q);
+    last_ = q;
+}
+
+void StrokeSmoother::emitCurve(const Vec p3, std::vector<common::Point>& out)
+{
+    const Vec& p0 = controls_[0];
+    const Vec& p1 = controls_[1];
+    const Vec& p2 = controls_[2];
+    const double length = std::hypot(p2.x - p1.x, p2.y - p1.y);
+    const int steps = std::max(1, static_cast<int>(std::ceil(length / kCurveStep)));
+    for (int i = 1; i <= steps; ++i)
+    {
+        // uniform Catmull-Rom, passes through p1 (t = 0) and p2 (t = 1)
+        const double t = static_cast<double>(i) / steps;
+        const double t2 = t * t;
+        const double t3 = t2 * t;
+        const auto at = [&](double a, double b, double c, double d)
+        {
+            return 0.5 * (2.0 * b + (c - a) * t + (2.0 * a - 5.0 * b + 4.0 * c - d) * t2 +
+                          (3.0 * b - a - 3.0 * c + d) * t3);
+        };
+        emit(Vec{at(p0.x, p1.x, p2.x, p3.x), at(p0.y, p1.y, p2.y, p3.y)}, out);
+    }
+}
+
+void StrokeSmoother::push(const std::span<const common::Point> samples,
+                          std::vector<common::Point>& out)
+{
+    for (const common::Point& sample : samples)
+    {
+        const Vec p{static_cast<double>(sample.x), static_cast<double>(sample.y)};
+        switch (mode_)
+        {
+            case StrokeSmoothing::None:
+                emit(p, out);
+                break;
+            case StrokeSmoothing::CatmullRom:
+                if (p.x == controls_[2].x && p.y == controls_[2].y)
+                    break;
+                // the segment ending at the previous sample is known once p arrives
+                if (samples_ > 0)
+                    emitCurve(p, out);
+                controls_ = {controls_[1], controls_[2], p};
+                ++samples_;
+                break;
+            case StrokeSmoothing::Stabilizer:
+            {
+                pointer_ = p;
+                const double dx = p.x - pen_.x;
+                const double dy = p.y - pen_.y;
+                const double distance = std::hypot(dx, dy);
+                if (distance <= stabilizerRadius_)
+                    break;
+                const double pull = (distance - stabilizerRadius_) / distance;
+                pen_ = Vec{pen_.x + dx * pull, pen_.y + dy * pull};
+                emit(pen_, out);
+                break;
+            }
+        }
+    }
+}
+
+void StrokeSmoother::finish(std::vector<common::Point>& out)
+{
+    switch (mode_)
+    {
+        case StrokeSmoothing::None:
+            break;
+        case StrokeSmoothing::CatmullRom:
+            if (samples_ > 0)
+                emitCurve(controls_[2], out);
+            samples_ = 0;
+            break;
+        case StrokeSmoothing::Stabilizer:
+            // the stroke ends under the pointer
+            pen_ = pointer_;
+            emit(pen_, out);
+            break;
+    }
+}
+}  // namespace app
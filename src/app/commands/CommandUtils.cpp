@@ -5,6 +5,7 @@
 #include "app/commands/CommandUtils.hpp"
 
 #include "core/Document.hpp"
+#include "core/ImageBuffer.hpp"
 #include "core/Layer.hpp"
 
 namespace app::commands
@@ -33,4 +34,23 @@ void clampActiveLayer(std::size_t* activeLayer, std::size_t layerCount)
     if (*activeLayer >= layerCount)
         *activeLayer = layerCount - 1;
 }
+
+common::Rect layerBounds(const Layer& layer)
+{
+    const auto& img = layer.image();
+    if (!img)
+        return common::Rect{};
+    return common::Rect{layer.offsetX(), layer.offsetY(), img->width(), img->height()};
+}
+
+common::Rect toDocumentRect(const Document& doc, std::uint64_t id, const common::Rect& local)
+{
+    const auto idx = findLayerIndexById(doc, id);
+    if (!idx || common::isEmpty(local))
+        return common::Rect{};
+    const auto layer = doc.layerAt(*idx);
+    if (!layer)
+        return common::Rect{};
+    return common::Rect{local.x + layer->offsetX(), local.y + layer->offsetY(), local.w, local.h};
+}
 }  // namespace app::commands
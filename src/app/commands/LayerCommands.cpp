@@ -4,6 +4,7 @@
 
 #include "app/commands/LayerCommands.hpp"
 
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -38,6 +39,7 @@ class AddLayerCommand final : public Command
         doc_->addLayer(layer_);
         if (activeLayer_)
             *activeLayer_ = doc_->layerCount() - 1;
+        invalidated_ = layerBounds(*layer_);
     }
 
     void undo() override
@@ -62,12 +64,19 @@ class AddLayerCommand final : public Command
 #endif
 #endif
         clampActiveLayer(activeLayer_, doc_->layerCount());
+        invalidated_ = layerBounds(*layer_);
+    }
+
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override
+    {
+        return invalidated_;
     }
 
    private:
     Document* doc_{nullptr};
     std::shared_ptr<Layer> layer_;
     std::size_t* activeLayer_{nullptr};
+    common::Rect invalidated_;
 };
 
 class SetLayerLockedCommand final : public Command
@@ -87,6 +96,11 @@ class SetLayerLockedCommand final : public Command
         set(before_);
     }
 
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override
+    {
+        return common::Rect{};  // not visible on the canvas
+    }
+
    private:
     void set(bool v) const
     {
@@ -127,6 +141,11 @@ class SetLayerVisibleCommand final : public Command
         set(before_);
     }
 
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override
+    {
+        return invalidated_;
+    }
+
    private:
     void set(bool v) const
     {
@@ -142,12 +161,14 @@ class SetLayerVisibleCommand final : public Command
             return;
 
         layer->setVisible(v);
+        invalidated_ = layerBounds(*layer);
     }
 
     Document* doc_{nullptr};
     std::uint64_t layerId_{0};
     bool before_{};
     bool after_{};
+    mutable common::Rect invalidated_;
 };
 
 class SetLayerOpacityCommand final : public Command
@@ -168,6 +189,11 @@ class SetLayerOpacityCommand final : public Command
         set(before_);
     }
 
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override
+    {
+        return invalidated_;
+    }
+
    private:
     void set(float v) const
     {
@@ -183,12 +209,14 @@ class SetLayerOpacityCommand final : public Command
             return;
 
         layer->setOpacity(v);
+        invalidated_ = layerBounds(*layer);
     }
 
     Document* doc_{nullptr};
     std::uint64_t layerId_{0};
     float before_{1.f};
     float after_{1.f};
+    mutable common::Rect invalidated_;
 };
 
 class SetLayerNameCommand final : public Command
@@ -210,6 +238,11 @@ class SetLayerNameCommand final : public Command
         set(before_);
     }
 
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override
+    {
+        return common::Rect{};  // not visible on the canvas
+    }
+
    private:
     void set(std::string v) const
     {
@@ -252,6 +285,11 @@ class SetMoveLayerCommand final : public Command
         set(before_);
     }
 
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override
+    {
+        return invalidated_;
+    }
+
    private:
     void set(common::Point v) const
     {
@@ -266,13 +304,16 @@ class SetMoveLayerCommand final : public Command
         if (!layer)
             return;
 
+        const common::Rect before = layerBounds(*layer);
         layer->setOffset(v.x, v.y);
+        invalidated_ = common::unite(before, layerBounds(*layer));
     }
 
     Document* doc_{nullptr};
     std::uint64_t layerId_{0};
     common::Point before_;
     common::Point after_;
+    mutable common::Rect invalidated_;
 };
 
 class RemoveLayerCommand final : public Command
@@ -298,6 +339,7 @@ class RemoveLayerCommand final : public Command
         if (layer && layer->locked())
             throw std::runtime_error("Cannot remove locked layer");
 
+        invalidated_ = layerBounds(*removed_);
         doc_->removeLayer(*idx);
         clampActiveLayer(activeLayer_, doc_->layerCount());
     }
@@ -313,6 +355,12 @@ class RemoveLayerCommand final : public Command
         doc_->addLayer(removed_, insertAt);
         if (activeLayer_)
             *activeLayer_ = insertAt;
+        invalidated_ = layerBounds(*removed_);
+    }
+
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override
+    {
+        return invalidated_;
     }
 
    private:
@@ -320,6 +368,7 @@ class RemoveLayerCommand final : public Command
     std::shared_ptr<Layer> removed_;
     std::size_t index_{0};
     std::size_t* activeLayer_{nullptr};
+    common::Rect invalidated_;
 };
 
 class ReorderLayerCommand final : public Command
@@ -341,6 +390,11 @@ class ReorderLayerCommand final : public Command
         moveTo(from_);
     }
 
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override
+    {
+        return invalidated_;
+    }
+
    private:
     void moveTo(std::size_t target)
     {
@@ -362,6 +416,8 @@ class ReorderLayerCommand final : public Command
             return;
 
         doc_->reorderLayer(cur, t);
+        if (auto layer = doc_->layerAt(t))
+            invalidated_ = layerBounds(*layer);
 
         if (activeLayer_)
         {
@@ -376,6 +432,7 @@ class ReorderLayerCommand final : public Command
     std::size_t from_{0};
     std::size_t to_{0};
     std::size_t* activeLayer_{nullptr};
+    common::Rect invalidated_;
 };
 
 class MergeDownCommand final : public Command
@@ -400,6 +457,8 @@ class MergeDownCommand final : public Command
         if (*idx == 0)
             throw std::runtime_error("Cannot merge down background");
 
+        // the layer below only changes under the merged layer
+        invalidated_ = layerBounds(*removed_);
         doc_->mergeDown(*idx);
         clampActiveLayer(activeLayer_, doc_->layerCount());
     }
@@ -415,6 +474,12 @@ class MergeDownCommand final : public Command
         doc_->addLayer(removed_, insertAt);
         if (activeLayer_)
             *activeLayer_ = insertAt;
+        invalidated_ = layerBounds(*removed_);
+    }
+
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override
+    {
+        return invalidated_;
     }
 
    private:
@@ -422,6 +487,7 @@ class MergeDownCommand final : public Command
     std::shared_ptr<Layer> removed_;
     std::size_t from_{0};
     std::size_t* activeLayer_{nullptr};
+    common::Rect invalidated_;
 };
 
 class ResizeLayerCommand final : public Command
@@ -442,6 +508,11 @@ class ResizeLayerCommand final : public Command
         set(before_);
     }
 
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override
+    {
+        return invalidated_;
+    }
+
    private:
     void set(const std::shared_ptr<ImageBuffer>& img) const
     {
@@ -453,12 +524,15 @@ class ResizeLayerCommand final : public Command
         auto layer = doc_->layerAt(*idx);
         if (!layer)
             return;
+        const common::Rect before = layerBounds(*layer);
         layer->setImageBuffer(img);
+        invalidated_ = common::unite(before, layerBounds(*layer));
     }
     Document* doc_{nullptr};
     std::uint64_t layerId_{0};
     std::shared_ptr<ImageBuffer> before_;
     std::shared_ptr<ImageBuffer> after_;
+    mutable common::Rect invalidated_;
 };
 
 class DuplicateLayerCommand final : public Command
@@ -501,6 +575,11 @@ class DuplicateLayerCommand final : public Command
         clampActiveLayer(activeLayer_, doc_->layerCount());
     }
 
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override
+    {
+        return duplicated_ ? layerBounds(*duplicated_) : common::Rect{};
+    }
+
    private:
     Document* doc_{nullptr};
     std::shared_ptr<Layer> duplicated_;
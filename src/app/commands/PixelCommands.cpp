@@ -4,6 +4,9 @@
 
 #include "app/commands/PixelCommands.hpp"
 
+#include <algorithm>
+#include <cstddef>
+
 #include "app/commands/CommandUtils.hpp"
 #include "core/Document.hpp"
 #include "core/ImageBuffer.hpp"
@@ -13,51 +16,121 @@ namespace app::commands
 {
 namespace
 {
-class PixelChangesCommand final : public Command
+// Undo keeps the previous pixels of the tiles the region touches (tile-aligned, clipped to the
+// region bounds), not one entry per pixel: redo repaints the region, undo copies the saved
+// pixels back under the region bits only.
+class BucketFillCommand final : public Command
 {
    public:
-    PixelChangesCommand(Document* doc, std::uint64_t layerId, std::vector<PixelChange> changes)
-        : doc_(doc), layerId_(layerId), changes_(std::move(changes))
+    BucketFillCommand(Document* doc, std::uint64_t layerId, core::FillRegion region)
+        : doc_(doc), layerId_(layerId), region_(std::move(region))
     {
+        saveBefore();
     }
 
     void redo() override
     {
-        apply(/*useBefore=*/false);
+        if (auto img = image())
+        {
+            core::fillRegion(*img, region_);
+            invalidated_ = toDocumentRect(*doc_, layerId_, region_.bounds);
+        }
     }
     void undo() override
     {
-        apply(/*useBefore=*/true);
+        auto img = image();
+        if (!img)
+            return;
+        for (const auto& tile : before_)
+        {
+            region_.forEachRun(tile.rect,
+                               [&](int x0, int x1, int y)
+                               {
+                                   const auto* src = tile.pixels.data() +
+                                                     static_cast<std::size_t>(y - tile.rect.y) *
+                                                         static_cast<std::size_t>(tile.rect.w) +
+                                                     static_cast<std::size_t>(x0 - tile.rect.x);
+                                   for (int x = x0; x < x1;)
+                                   {
+                                       const int n = img->runLength(x, x1 - x);
+                                       const auto dst = img->span(x, y, n);
+                                       std::copy_n(src, n, dst.begin());
+                                       src += n;
+                                       x += n;
+                                   }
+                               });
+        }
+        invalidated_ = toDocumentRect(*doc_, layerId_, region_.bounds);
+    }
+
+    [[nodiscard]] std::optional<common::Rect> invalidatedRect() const override
+    {
+        return invalidated_;
     }
 
    private:
-    void apply(bool useBefore)
+    struct SavedTile
     {
-        if (!doc_)
-            return;
+        common::Rect rect;  // layer-local
+        std::vector<ImageBuffer::Pixel> pixels;
+    };
 
+    [[nodiscard]] std::shared_ptr<ImageBuffer> image() const
+    {
+        if (!doc_)
+            return nullptr;
         const auto idx = findLayerIndexById(*doc_, layerId_);
         if (!idx)
-            return;
+            return nullptr;
+        const auto layer = doc_->layerAt(*idx);
+        return layer ? layer->image() : nullptr;
+    }
 
-        auto layer = doc_->layerAt(*idx);
-        if (!layer || !layer->image())
+    void saveBefore()
+    {
+        const auto img = image();
+        if (!img || region_.empty())
             return;
 
-        auto img = layer->image();
-        for (const auto& c : changes_)
-            img->setPixel(c.x, c.y, useBefore ? c.before : c.after);
+        constexpr int kTile = ImageBuffer::kTileSize;
+        const common::Rect& b = region_.bounds;
+        for (int ty = b.y / kTile; ty <= (b.y + b.h - 1) / kTile; ++ty)
+            for (int tx = b.x / kTile; tx <= (b.x + b.w - 1) / kTile; ++tx)
+            {
+                const common::Rect rect =
+                    common::intersect(b, common::Rect{tx * kTile, ty * kTile, kTile, kTile});
+                bool touched = false;
+                region_.forEachRun(rect, [&](int, int, int) { touched = true; });
+                if (!touched)
+                    continue;
+
+                SavedTile tile{rect, {}};
+                tile.pixels.reserve(static_cast<std::size_t>(rect.w) *
+                                    static_cast<std::size_t>(rect.h));
+                const ImageBuffer& src = *img;
+                for (int y = rect.y; y < rect.y + rect.h; ++y)
+                    for (int x = rect.x; x < rect.x + rect.w;)
+                    {
+                        const int n = src.runLength(x, rect.x + rect.w - x);
+                        const auto px = src.span(x, y, n);
+                        tile.pixels.insert(tile.pixels.end(), px.begin(), px.end());
+                        x += n;
+                    }
+                before_.push_back(std::move(tile));
+            }
     }
 
     Document* doc_{nullptr};
     std::uint64_t layerId_{0};
-    std::vector<PixelChange> changes_;
+    core::FillRegion region_;
+    std::vector<SavedTile> before_;
+    common::Rect invalidated_;
 };
 }  // namespace
 
-std::unique_ptr<Command> makePixelChangesCommand(Document* doc, std::uint64_t layerId,
-                                                 std::vector<PixelChange> changes)
+std::unique_ptr<Command> makeBucketFillCommand(Document* doc, std::uint64_t layerId,
+                                               core::FillRegion region)
 {
-    return std::make_unique<PixelChangesCommand>(doc, layerId, std::move(changes));
+    return std::make_unique<BucketFillCommand>(doc, layerId, std::move(region));
 }
 }  // namespace app::commands
@@ -4,10 +4,11 @@
 #include "app/commands/StrokeCommand.hpp"
 
 #include <algorithm>
+#include <bit>
 #include <cmath>
 #include <cstdlib>
-#include <iterator>
-#include <unordered_map>
+#include <limits>
+#include <optional>
 
 #include "app/commands/CommandUtils.hpp"
 #include "core/Document.hpp"
@@ -18,217 +19,375 @@ namespace app::commands
 {
 namespace
 {
-static void rasterizeLine(common::Point a, common::Point b,
-                          const std::function<void(int, int)>& emitPixel)
+std::uint32_t applyEraser(std::uint32_t before, float op)
 {
-    int x0 = a.x, y0 = a.y;
-    int x1 = b.x, y1 = b.y;
+    // RGBA: R<<24 G<<16 B<<8 A
+    const uint8_t a = static_cast<uint8_t>(before & 0xFFu);
+    const float keep = 1.f - std::clamp(op, 0.f, 1.f);
+    const uint8_t newA = static_cast<uint8_t>(std::lround(static_cast<float>(a) * keep));
 
-    int dx = std::abs(x1 - x0), sx = (x0 < x1) ? 1 : -1;
-    int dy = -std::abs(y1 - y0), sy = (y0 < y1) ? 1 : -1;
-    int err = dx + dy;
+    // on garde RGB, on change alpha
+    return (before & 0xFFFFFF00u) | static_cast<std::uint32_t>(newA);
+}
+
+std::uint32_t blendOver(std::uint32_t dst, std::uint32_t src, float op)
+{
+    op = std::clamp(op, 0.f, 1.f);
+
+    const float dr = float((dst >> 24) & 0xFFu) / 255.f;
+    const float dg = float((dst >> 16) & 0xFFu) / 255.f;
+    const float db = float((dst >> 8) & 0xFFu) / 255.f;
+    const float da = float(dst & 0xFFu) / 255.f;
+
+    const float sr = float((src >> 24) & 0xFFu) / 255.f;
+    const float sg = float((src >> 16) & 0xFFu) / 255.f;
+    const float sb = float((src >> 8) & 0xFFu) / 255.f;
+    const float sa = (float(src & 0xFFu) / 255.f) * op;  // alpha effectif
+
+    // "source over" en alpha non-premultiplié
+    const float outA = sa + da * (1.f - sa);
+    if (outA <= 0.f)
+        return 0u;
+
+    const float outR = (sr * sa + dr * da * (1.f - sa)) / outA;
+    const float outG = (sg * sa + dg * da * (1.f - sa)) / outA;
+    const float outB = (sb * sa + db * da * (1.f - sa)) / outA;
 
-    while (true)
+    const auto to8 = [](float v) -> std::uint32_t
     {
-        emitPixel(x0, y0);
-        if (x0 == x1 && y0 == y1)
-            break;
+        v = std::clamp(v, 0.f, 1.f);
+        return static_cast<std::uint32_t>(std::lround(v * 255.f));
+    };
 
-        int e2 = 2 * err;
-        if (e2 >= dy)
-        {
-            err += dy;
-            x0 += sx;
-        }
-        if (e2 <= dx)
-        {
-            err += dx;
-            y0 += sy;
-        }
-    }
+    return (to8(outR) << 24) | (to8(outG) << 16) | (to8(outB) << 8) | to8(outA);
 }
 }  // namespace
 
-StrokeCommand::StrokeCommand(Document* doc, std::uint64_t layerId, ToolParams params, ApplyFn apply)
-    : doc_(doc), layerId_(layerId), params_(params), apply_(std::move(apply))
+StrokeCommand::StrokeCommand(Document* doc, std::uint64_t layerId, ToolParams params)
+    : doc_(doc), layerId_(layerId), params_(params)
 {
+    img_ = image();
+    if (!img_)
+        return;
+    tip_ = core::BrushTip::get(params_.size, params_.hardness);
+
+    const auto layer = doc_->layerAt(*findLayerIndexById(*doc_, layerId_));
+    layerOffset_ = common::Point{layer->offsetX(), layer->offsetY()};
+    tileDirectory_.assign(static_cast<std::size_t>((img_->width() + kTile - 1) / kTile) *
+                              static_cast<std::size_t>((img_->height() + kTile - 1) / kTile),
+                          nullptr);
+    // selection clip, seen from the layer (span lookups, no raster needed)
+    if (doc_->selection().hasMask())
+        selection_.emplace(doc_->selection().view(layerOffset_, img_->width(), img_->height()));
 }
 
-void StrokeCommand::addPoint(common::Point p)
+common::Rect StrokeCommand::addPoint(common::Point p)
 {
-    points_.push_back(p);
+    if (!img_)
+        return {};
+
+    segmentArea_ = common::Rect{};
+    if (!last_)
+    {
+        stampDab(p.x, p.y);
+        untilNextDab_ = std::max(1.0, params_.size * params_.spacing / 100.0);
+    }
+    else if (params_.spacing > 0)
+    {
+        placeDabs(*last_, p);
+    }
+    else
+    {
+        sweepSegment(*last_, p);
+    }
+    last_ = p;
+
+    changedArea_ = common::unite(changedArea_, segmentArea_);
+    return toDocumentRect(*doc_, layerId_, segmentArea_);
+}
+
+common::Rect StrokeCommand::addPoints(std::span<const common::Point> points)
+{
+    common::Rect area;
+    for (const common::Point& p : points)
+        area = common::unite(area, addPoint(p));
+    return area;
 }
 
 void StrokeCommand::redo()
 {
-    if (!built_)
-        buildChanges();
-    apply_(layerId_, changes_, /*useBefore=*/false);
+    if (!applied_)
+        if (const auto img = image())
+            writeTiles(*img, /*useBefore=*/false);
+    applied_ = true;
+    // the stroke is committed: drop the live state
+    img_.reset();
+    tip_.reset();
+    selection_.reset();
+    tileDirectory_ = {};
+    if (doc_)
+        invalidated_ = toDocumentRect(*doc_, layerId_, changedArea_);
 }
 
 void StrokeCommand::undo()
 {
-    if (!built_)
-        return;
-    apply_(layerId_, changes_, /*useBefore=*/true);
+    if (const auto img = image())
+        writeTiles(*img, /*useBefore=*/true);
+    applied_ = false;
+    if (doc_)
+        invalidated_ = toDocumentRect(*doc_, layerId_, changedArea_);
 }
 
-void StrokeCommand::buildChanges()
+std::optional<common::Rect> StrokeCommand::invalidatedRect() const
 {
-    built_ = true;
-    if (!doc_)
-        return;
-
-    auto idxOpt = findLayerIndexById(*doc_, layerId_);
-    if (!idxOpt)
-        return;
-
-    auto layer = doc_->layerAt(*idxOpt);
-    if (!layer || !layer->image())
-        return;
-
-    auto img = layer->image();
-    const int w = img->width();
-    const int h = img->height();
-
-    const int offX = layer->offsetX();
-    const int offY = layer->offsetY();
+    return invalidated_;
+}
 
-    const Selection* sel = nullptr;
-    if (doc_)
-        sel = &doc_->selection();
-    const bool hasSel = sel && sel->hasMask() && sel->mask();
+std::shared_ptr<ImageBuffer> StrokeCommand::image() const
+{
+    if (!doc_)
+        return nullptr;
+    const auto idx = findLayerIndexById(*doc_, layerId_);
+    if (!idx)
+        return nullptr;
+    const auto layer = doc_->layerAt(*idx);
+    return layer ? layer->image() : nullptr;
+}
 
-    std::unordered_map<std::uint64_t, PixelChange> map;
-    map.reserve(256);
+std::uint32_t StrokeCommand::paint(std::uint32_t before, std::uint8_t coverage) const
+{
+    const float op = params_.opacity * (static_cast<float>(coverage) / 255.f);
+    if (params_.tool == ToolKind::Eraser)
+        return applyEraser(before, op);
+    return blendOver(before, params_.color, op);
+}
 
-    auto applyEraser = [&](std::uint32_t before, float op) -> std::uint32_t
+StrokeCommand::Tile& StrokeCommand::tileAt(int x, int y)
+{
+    const int columns = (img_->width() + kTile - 1) / kTile;
+    Tile*& slot = tileDirectory_[static_cast<std::size_t>(y / kTile) *
+                                     static_cast<std::size_t>(columns) +
+                                 static_cast<std::size_t>(x / kTile)];
+    if (!slot)
     {
-        // RGBA: R<<24 G<<16 B<<8 A
-        const uint8_t a = static_cast<uint8_t>(before & 0xFFu);
-        const float keep = 1.f - std::clamp(op, 0.f, 1.f);
-        const uint8_t newA = static_cast<uint8_t>(std::lround(static_cast<float>(a) * keep));
-
-        // on garde RGB, on change alpha
-        return (before & 0xFFFFFF00u) | static_cast<std::uint32_t>(newA);
-    };
+        auto tile = std::make_unique<Tile>();
+        tile->x0 = x - x % kTile;
+        tile->y0 = y - y % kTile;
+        slot = tile.get();
+        tiles_.push_back(std::move(tile));
+    }
+    return *slot;
+}
 
-    auto blendOver = [&](std::uint32_t dst, std::uint32_t src, float op) -> std::uint32_t
+void StrokeCommand::paintRun(ImageBuffer& img, int x0, int x1, int y, const std::uint8_t* dab)
+{
+    Tile& tile = tileAt(x0, y);
+    const auto r = static_cast<std::size_t>(y - tile.y0);
+    const int bit0 = x0 - tile.x0;
+    auto* coverage = tile.coverage.data() + r * kTile;
+    const std::uint64_t raised = core::raiseCoverage(coverage + bit0, dab, x1 - x0) << bit0;
+    if (raised == 0)
+        return;
+    std::uint64_t& covered = tile.covered[r];
+    const std::uint64_t fresh = raised & ~covered;
+    covered |= raised;
+
+    auto* before = tile.before.data() + r * kTile;
+    const int first = std::countr_zero(raised);
+    const int last = 63 - std::countl_zero(raised);
+    for (int x = tile.x0 + first; x <= tile.x0 + last;)
     {
-        op = std::clamp(op, 0.f, 1.f);
-
-        const float dr = float((dst >> 24) & 0xFFu) / 255.f;
-        const float dg = float((dst >> 16) & 0xFFu) / 255.f;
-        const float db = float((dst >> 8) & 0xFFu) / 255.f;
-        const float da = float(dst & 0xFFu) / 255.f;
-
-        const float sr = float((src >> 24) & 0xFFu) / 255.f;
-        const float sg = float((src >> 16) & 0xFFu) / 255.f;
-        const float sb = float((src >> 8) & 0xFFu) / 255.f;
-        const float sa = (float(src & 0xFFu) / 255.f) * op;  // alpha effectif
-
-        // "source over" en alpha non-premultiplié
-        const float outA = sa + da * (1.f - sa);
-        if (outA <= 0.f)
-            return 0u;
-
-        const float outR = (sr * sa + dr * da * (1.f - sa)) / outA;
-        const float outG = (sg * sa + dg * da * (1.f - sa)) / outA;
-        const float outB = (sb * sa + db * da * (1.f - sa)) / outA;
-
-        const auto to8 = [](float v) -> std::uint32_t
+        const int count = img.runLength(x, tile.x0 + last + 1 - x);
+        const auto px = img.span(x, y, count);
+        for (int i = 0; i < count; ++i)
         {
-            v = std::clamp(v, 0.f, 1.f);
-            return static_cast<std::uint32_t>(std::lround(v * 255.f));
-        };
-
-        return (to8(outR) << 24) | (to8(outG) << 16) | (to8(outB) << 8) | to8(outA);
-    };
+            const int b = x + i - tile.x0;
+            if (((raised >> b) & 1u) == 0)
+                continue;
+            if ((fresh >> b) & 1u)
+                before[b] = px[static_cast<std::size_t>(i)];
+            px[static_cast<std::size_t>(i)] =
+                ImageBuffer::toPixel(paint(ImageBuffer::toRgba(before[b]), coverage[b]));
+        }
+        x += count;
+    }
+    segmentArea_ = common::unite(
+        segmentArea_, common::Rect{tile.x0 + first, y, last - first + 1, 1});
+}
 
-    auto recordPixel = [&](int docX, int docY)
-    {
-        if (hasSel)
+void StrokeCommand::writeTiles(ImageBuffer& img, bool useBefore) const
+{
+    for (const auto& tile : tiles_)
+        for (int r = 0; r < kTile; ++r)
         {
-            if (docX < 0 || docY < 0 || docX >= doc_->width() || docY >= doc_->height())
-                return;
-            if (sel->t_at(docX, docY) == 0)
-                return;
+            const std::uint64_t covered = tile->covered[static_cast<std::size_t>(r)];
+            if (covered == 0)
+                continue;
+            const int y = tile->y0 + r;
+            const auto* before = tile->before.data() + static_cast<std::size_t>(r) * kTile;
+            const auto* coverage = tile->coverage.data() + static_cast<std::size_t>(r) * kTile;
+            const int first = std::countr_zero(covered);
+            const int last = 63 - std::countl_zero(covered);
+            for (int x = tile->x0 + first; x <= tile->x0 + last;)
+            {
+                const int count = img.runLength(x, tile->x0 + last + 1 - x);
+                const auto px = img.span(x, y, count);
+                for (int i = 0; i < count; ++i)
+                {
+                    const int b = x + i - tile->x0;
+                    if (((covered >> b) & 1u) == 0)
+                        continue;
+                    px[static_cast<std::size_t>(i)] =
+                        useBefore ? before[b]
+                                  : ImageBuffer::toPixel(
+                                        paint(ImageBuffer::toRgba(before[b]), coverage[b]));
+                }
+                x += count;
+            }
         }
-        const int x = docX - offX;
-        const int y = docY - offY;
-
-        if (x < 0 || y < 0 || x >= w || y >= h)
-            return;
+}
 
-        const std::uint64_t key =
-            (static_cast<std::uint64_t>(static_cast<std::uint32_t>(y)) << 32) |
-            static_cast<std::uint32_t>(x);
+void StrokeCommand::paintRow(int x0, int x1, int y, const std::uint8_t* coverage)
+{
+    if (y < 0 || y >= img_->height() || (selection_ && selection_->rowEmpty(y)))
+        return;
+    const int lx0 = std::max(x0, 0);
+    const int lx1 = std::min(x1, img_->width());
+    if (lx0 >= lx1)
+        return;
 
-        auto it = map.find(key);
-        if (it == map.end())
-        {
-            PixelChange ch{};
-            ch.x = x;
-            ch.y = y;
-            ch.before = img->getPixel(x, y);
-            if (params_.tool == ToolKind::Eraser)
-                ch.after = applyEraser(ch.before, params_.opacity);
-            else
-                ch.after = blendOver(ch.before, params_.color, params_.opacity);
-            map.emplace(key, ch);
-        }
-        else
+    const auto paintSpan = [&](int sx0, int sx1)
+    {
+        // one run per tile
+        for (int x = sx0; x < sx1;)
         {
-            const std::uint32_t base = it->second.before;
-            if (params_.tool == ToolKind::Eraser)
-                it->second.after = applyEraser(base, params_.opacity);
-            else
-                it->second.after = blendOver(base, params_.color, params_.opacity);
+            const int end = std::min(sx1, (x / kTile + 1) * kTile);
+            paintRun(*img_, x, end, y, coverage + (x - x0));
+            x = end;
         }
     };
+    if (!selection_)
+        paintSpan(lx0, lx1);
+    else
+        selection_->forEachSpan(y, lx0, lx1,
+                                [&](int sx0, int sx1, std::uint8_t) { paintSpan(sx0, sx1); });
+}
 
-    // Stamp a filled circle centered at (cx,cy) using params_.size as diameter
-    auto stampCircle = [&](int cx, int cy)
+// Stamps the brush tip centered at document pixel (cx,cy)
+void StrokeCommand::stampDab(int cx, int cy)
+{
+    const int radius = tip_->radius();
+    // layer position of the tip's top-left pixel
+    const int tipX = cx - radius - layerOffset_.x;
+    const int tipY = cy - radius - layerOffset_.y;
+    for (int dy = 0; dy < tip_->size(); ++dy)
     {
-        const int diameter = std::max(1, params_.size);
-        const double radius = static_cast<double>(diameter) * 0.5;
-        const int rInt = static_cast<int>(std::ceil(radius));
+        const int begin = tip_->rowBegin(dy);
+        paintRow(tipX + begin, tipX + tip_->rowEnd(dy), tipY + dy,
+                 tip_->row(dy).data() + begin);
+    }
+}
 
-        const int x0 = cx - rInt;
-        const int x1 = cx + rInt;
-        const int y0 = cy - rInt;
-        const int y1 = cy + rInt;
+void StrokeCommand::placeDabs(common::Point a, common::Point b)
+{
+    const double step = std::max(1.0, params_.size * params_.spacing / 100.0);
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double length = std::sqrt(dx * dx + dy * dy);
+    double at = untilNextDab_;
+    for (; at <= length; at += step)
+    {
+        const double t = at / length;
+        stampDab(static_cast<int>(std::lround(a.x + dx * t)),
+                 static_cast<int>(std::lround(a.y + dy * t)));
+    }
+    untilNextDab_ = at - length;
+}
 
-        const double r2 = radius * radius;
-        for (int yy = y0; yy <= y1; ++yy)
+void StrokeCommand::sweepSegment(common::Point a, common::Point b)
+{
+    const double ax = a.x;
+    const double ay = a.y;
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double len2 = dx * dx + dy * dy;
+    const double reach = tip_->reach();
+    const double reach2 = reach * reach;
+
+    const int yTop = static_cast<int>(std::floor(std::min(a.y, b.y) - reach));
+    const int yBottom = static_cast<int>(std::ceil(std::max(a.y, b.y) + reach));
+    for (int yy = yTop; yy <= yBottom; ++yy)
+    {
+        // x range of the capsule (the two end discs and the band between them) on this row
+        double lo = std::numeric_limits<double>::max();
+        double hi = std::numeric_limits<double>::lowest();
+        const auto include = [&](double from, double to)
         {
-            for (int xx = x0; xx <= x1; ++xx)
+            if (from > to)
+                std::swap(from, to);
+            lo = std::min(lo, from);
+            hi = std::max(hi, to);
+        };
+        const double ry = yy - ay;
+        for (const common::Point c : {a, b})
+        {
+            const double h = yy - c.y;
+            if (std::abs(h) <= reach)
             {
-                const double dx = static_cast<double>(xx) - static_cast<double>(cx);
-                const double dy = static_cast<double>(yy) - static_cast<double>(cy);
-                if (dx * dx + dy * dy <= r2)
-                    recordPixel(xx, yy);
+                const double half = std::sqrt(reach2 - h * h);
+                include(c.x - half, c.x + half);
             }
         }
-    };
-
-    if (points_.empty())
-        return;
-
-    if (points_.size() == 1)
-    {
-        stampCircle(points_[0].x, points_[0].y);
-    }
-    else
-    {
-        for (std::size_t i = 1; i < points_.size(); ++i)
-            rasterizeLine(points_[i - 1], points_[i], [&](int x, int y) { stampCircle(x, y); });
+        if (dy != 0.0)
+        {
+            // within reach of the line, and projecting inside the segment
+            double bandLo = ax + (dx * ry - reach * std::sqrt(len2)) / dy;
+            double bandHi = ax + (dx * ry + reach * std::sqrt(len2)) / dy;
+            if (bandLo > bandHi)
+                std::swap(bandLo, bandHi);
+            if (dx != 0.0)
+            {
+                double pLo = ax - dy * ry / dx;
+                double pHi = ax + (len2 - dy * ry) / dx;
+                if (pLo > pHi)
+                    std::swap(pLo, pHi);
+                bandLo = std::max(bandLo, pLo);
+                bandHi = std::min(bandHi, pHi);
+            }
+            else if (ry / dy < 0.0 || ry / dy > 1.0)
+            {
+                bandLo = bandHi + 1.0;
+            }
+            if (bandLo <= bandHi)
+                include(bandLo, bandHi);
+        }
+        else if (std::abs(ry) <= reach)
+        {
+            include(ax, ax + dx);
+        }
+        if (lo > hi)
+            continue;
+
+        // layer pixels, one spare pixel each side for the rounding of the bounds
+        const int ly = yy - layerOffset_.y;
+        const int lx0 = std::max(static_cast<int>(std::floor(lo)) - 1 - layerOffset_.x, 0);
+        const int lx1 = std::min(static_cast<int>(std::ceil(hi)) + 2 - layerOffset_.x,
+                                 img_->width());
+        if (ly < 0 || ly >= img_->height() || lx0 >= lx1 ||
+            (selection_ && selection_->rowEmpty(ly)))
+            continue;
+
+        sweepRow_.resize(static_cast<std::size_t>(lx1 - lx0));
+        for (int x = lx0; x < lx1; ++x)
+        {
+            // squared distance from the pixel to the segment
+            const double rx = x + layerOffset_.x - ax;
+            const double t = len2 > 0.0 ? std::clamp((rx * dx + ry * dy) / len2, 0.0, 1.0) : 0.0;
+            const double ex = rx - t * dx;
+            const double ey = ry - t * dy;
+            sweepRow_[static_cast<std::size_t>(x - lx0)] = tip_->coverageAt(ex * ex + ey * ey);
+        }
+        paintRow(lx0, lx1, ly, sweepRow_.data());
     }
-
-    changes_.clear();
-    changes_.reserve(map.size());
-
-    std::transform(map.begin(), map.end(), std::back_inserter(changes_),
-                   [](const auto& kv) { return kv.second; });
 }
 }  // namespace app::commands
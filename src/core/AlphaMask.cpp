@@ -0,0 +1,167 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include "core/AlphaMask.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define EPIGIMP_MASK_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+std::uint64_t lowBits(int n)
+{
+    return n >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << n) - 1;
+}
+
+// Bit i set when values[i] != 0, n <= 64.
+std::uint64_t nonZeroBits(const std::uint8_t* values, int n)
+{
+    std::uint64_t bits = 0;
+    int i = 0;
+#if defined(EPIGIMP_MASK_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        const auto isZero = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)));
+        bits |= static_cast<std::uint64_t>(~isZero & 0xFFFFu) << i;
+    }
+#endif
+    for (; i < n; ++i)
+        if (values[i] != 0)
+            bits |= std::uint64_t{1} << i;
+    return bits;
+}
+}  // namespace
+
+AlphaMask::AlphaMask(const int width, const int height, const Storage storage)
+    : width_(std::max(0, width)), height_(std::max(0, height)), storage_(storage)
+{
+    if (storage_ == Storage::A8)
+    {
+        values_.assign(static_cast<std::size_t>(width_) * static_cast<std::size_t>(height_), 0);
+    }
+    else
+    {
+        wordsPerRow_ = (width_ + 63) / 64;
+        words_.assign(static_cast<std::size_t>(wordsPerRow_) * static_cast<std::size_t>(height_),
+                      0);
+    }
+}
+
+void AlphaMask::set(const int x, const int y, const std::uint8_t value)
+{
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+    if (storage_ == Storage::A8)
+    {
+        values_[index(x, y)] = value;
+        return;
+    }
+    const std::uint64_t bit = std::uint64_t{1} << (x % 64);
+    std::uint64_t& word = words_[wordIndex(x, y)];
+    word = value != 0 ? (word | bit) : (word & ~bit);
+}
+
+void AlphaMask::fill(const std::uint8_t value)
+{
+    if (storage_ == Storage::A8)
+    {
+        std::fill(values_.begin(), values_.end(), value);
+        return;
+    }
+    // padding bits stay clear so whole words can be tested
+    std::fill(words_.begin(), words_.end(), 0);
+    if (value != 0)
+        fillRect(common::Rect{0, 0, width_, height_}, value);
+}
+
+void AlphaMask::fillRect(const common::Rect& rect, const std::uint8_t value)
+{
+    const common::Rect r = common::intersect(rect, common::Rect{0, 0, width_, height_});
+    for (int y = r.y; y < r.y + r.h; ++y)
+    {
+        if (storage_ == Storage::A8)
+        {
+            const auto dst = row(y).subspan(static_cast<std::size_t>(r.x),
+                                            static_cast<std::size_t>(r.w));
+            std::fill(dst.begin(), dst.end(), value);
+            continue;
+        }
+        for (int x = r.x; x < r.x + r.w;)
+        {
+            const int bit = x % 64;
+            const int n = std::min(64 - bit, r.x + r.w - x);
+            const std::uint64_t ones = lowBits(n) << bit;
+            std::uint64_t& word = words_[wordIndex(x, y)];
+            word = value != 0 ? (word | ones) : (word & ~ones);
+            x += n;
+        }
+    }
+}
+
+std::uint64_t AlphaMask::coverageBits(const int x, const int y, const int n) const noexcept
+{
+    assert(n <= 64);
+    if (y < 0 || y >= height_)
+        return 0;
+    const int x0 = std::max(x, 0);
+    const int x1 = std::min(x + n, width_);
+    if (x0 >= x1)
+        return 0;
+
+    std::uint64_t bits = 0;
+    if (storage_ == Storage::A8)
+    {
+        bits = nonZeroBits(values_.data() + index(x0, y), x1 - x0);
+    }
+    else
+    {
+        const int bit = x0 % 64;
+        bits = words_[wordIndex(x0, y)] >> bit;
+        if (bit != 0 && bit + (x1 - x0) > 64)
+            bits |= words_[wordIndex(x0, y) + 1] << (64 - bit);
+        bits &= lowBits(x1 - x0);
+    }
+    return bits << (x0 - x);
+}
+
+std::optional<common::Rect> AlphaMask::bounds() const
+{
+    int minX = width_;
+    int minY = height_;
+    int maxX = -1;
+    int maxY = -1;
+
+    for (int y = 0; y < height_; ++y)
+    {
+        int first = -1;
+        int last = -1;
+        for (int x = 0; x < width_; x += 64)
+        {
+            const int n = std::min(64, width_ - x);
+            const std::uint64_t bits = coverageBits(x, y, n);
+            if (bits == 0)
+                continue;
+            if (first < 0)
+                first = x + std::countr_zero(bits);
+            last = x + 63 - std::countl_zero(bits);
+        }
+        if (first < 0)
+            continue;
+        minX = std::min(minX, first);
+        maxX = std::max(maxX, last);
+        minY = std::min(minY, y);
+        maxY = y;
+    }
+
+    if (maxX < minX || maxY < minY)
+        return std::nullopt;
+    return common::Rect{minX, minY, maxX - minX + 1, maxY - minY + 1};
+}
@@ -0,0 +1,511 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include "core/Blend.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define EPIGIMP_BLEND_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define EPIGIMP_TARGET(isa)
+#else
+#define EPIGIMP_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+// Le calcul reste celui du compositor ("src over dst" en straight alpha), réécrit sur des
+// canaux 0..255 pour n'avoir qu'une division par pixel :
+//   E   = srcA * opacity                      (alpha effectif, 0..255)
+//   K   = dstA * (255 - E)
+//   N   = 255 * E + K                         (= outA * 255 * 255)
+//   outC = (255 * srcC * E + dstC * K) / N
+//   outA = N / 255
+// Les SIMD mettent les 4 canaux d'un pixel dans 4 lanes float : le lane alpha utilise 255 à la
+// place de srcA/dstA et 255 * 255 comme diviseur, ce qui donne outA avec la même formule.
+// Tous les produits restent < 2^24, exacts en float ; seul l'arrondi final peut différer d'un
+// LSB de la version std::lround.
+
+namespace
+{
+using Pixel = ImageBuffer::Pixel;
+using core::BlendRowFn;
+using core::SimdLevel;
+
+constexpr Pixel kAlphaMask = ImageBuffer::toPixel(0x000000FFu);
+
+float clampOpacity(float opacity)
+{
+    return std::clamp(opacity, 0.0f, 1.0f);
+}
+
+void blendOne(const Pixel src, Pixel& dst, const float opacity, const bool fullOpacity)
+{
+    const Pixel srcA = src & kAlphaMask;
+    if (srcA == 0)
+    {
+        // nothing to add; a fully transparent dst is normalised to 0
+        if ((dst & kAlphaMask) == 0)
+            dst = 0;
+        return;
+    }
+    if (srcA == kAlphaMask && fullOpacity)
+    {
+        dst = src;
+        return;
+    }
+
+    const auto* s = reinterpret_cast<const std::uint8_t*>(&src);
+    auto* d = reinterpret_cast<std::uint8_t*>(&dst);
+
+    const float e = static_cast<float>(s[3]) * opacity;
+    const float k = static_cast<float>(d[3]) * (255.0f - e);
+    const float n = e * 255.0f + k;
+    if (n <= 0.0f)
+    {
+        dst = 0;
+        return;
+    }
+
+    const auto toByte = [](float v) -> std::uint8_t
+    { return static_cast<std::uint8_t>(std::lrint(std::min(v, 255.0f))); };
+    for (int c = 0; c < 3; ++c)
+        d[c] = toByte((static_cast<float>(s[c]) * e * 255.0f + static_cast<float>(d[c]) * k) / n);
+    d[3] = toByte(n / 255.0f);
+}
+
+void sourceOverScalar(const Pixel* src, Pixel* dst, std::size_t count, float opacity)
+{
+    opacity = clampOpacity(opacity);
+    const bool fullOpacity = opacity >= 1.0f;
+    for (std::size_t i = 0; i < count; ++i)
+        blendOne(src[i], dst[i], opacity, fullOpacity);
+}
+
+#if defined(EPIGIMP_BLEND_X86) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define EPIGIMP_BLEND_SSE2 1
+
+// One pixel (R,G,B,A as int32 lanes) -> blended int32 lanes.
+inline __m128i blendPixelSse2(const __m128 s, const __m128 d, const __m128 op)
+{
+    const __m128 k255 = _mm_set1_ps(255.0f);
+    const __m128 alphaLane = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+    const __m128 alphaDiv = _mm_and_ps(alphaLane, _mm_set1_ps(255.0f * 255.0f));
+
+    const __m128 e = _mm_mul_ps(_mm_shuffle_ps(s, s, 0xFF), op);
+    const __m128 k = _mm_mul_ps(_mm_shuffle_ps(d, d, 0xFF), _mm_sub_ps(k255, e));
+    const __m128 n = _mm_add_ps(_mm_mul_ps(e, k255), k);
+
+    const __m128 s2 = _mm_or_ps(_mm_andnot_ps(alphaLane, s), _mm_and_ps(alphaLane, k255));
+    const __m128 d2 = _mm_or_ps(_mm_andnot_ps(alphaLane, d), _mm_and_ps(alphaLane, k255));
+    const __m128 num = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s2, e), k255), _mm_mul_ps(d2, k));
+    const __m128 div = _mm_or_ps(_mm_andnot_ps(alphaLane, n), alphaDiv);
+
+    const __m128 q = _mm_and_ps(_mm_div_ps(num, div), _mm_cmpgt_ps(n, _mm_setzero_ps()));
+    return _mm_cvtps_epi32(q);
+}
+
+// Four pixels, general path.
+inline __m128i blendQuadSse2(const __m128i s, const __m128i d, const __m128 op)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i sLo = _mm_unpacklo_epi8(s, zero);
+    const __m128i sHi = _mm_unpackhi_epi8(s, zero);
+    const __m128i dLo = _mm_unpacklo_epi8(d, zero);
+    const __m128i dHi = _mm_unpackhi_epi8(d, zero);
+    const auto toPs = [&](__m128i v16, bool high)
+    {
+        return _mm_cvtepi32_ps(high ? _mm_unpackhi_epi16(v16, zero)
+                                    : _mm_unpacklo_epi16(v16, zero));
+    };
+
+    const __m128i p0 = blendPixelSse2(toPs(sLo, false), toPs(dLo, false), op);
+    const __m128i p1 = blendPixelSse2(toPs(sLo, true), toPs(dLo, true), op);
+    const __m128i p2 = blendPixelSse2(toPs(sHi, false), toPs(dHi, false), op);
+    const __m128i p3 = blendPixelSse2(toPs(sHi, true), toPs(dHi, true), op);
+    return _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+}
+
+void sourceOverSse2(const Pixel* src, Pixel* dst, std::size_t count, float opacity)
+{
+    opacity = clampOpacity(opacity);
+    const bool fullOpacity = opacity >= 1.0f;
+    const __m128 op = _mm_set1_ps(opacity);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(kAlphaMask));
+    const __m128i zero = _mm_setzero_si128();
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        auto* dp = reinterpret_cast<__m128i*>(dst + i);
+        const __m128i sA = _mm_and_si128(s, alpha);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(sA, zero)) == 0xFFFF)
+        {
+            const __m128i d = _mm_loadu_si128(dp);
+            const __m128i dClear = _mm_cmpeq_epi32(_mm_and_si128(d, alpha), zero);
+            _mm_storeu_si128(dp, _mm_andnot_si128(dClear, d));
+            continue;
+        }
+        if (fullOpacity && _mm_movemask_epi8(_mm_cmpeq_epi32(sA, alpha)) == 0xFFFF)
+        {
+            _mm_storeu_si128(dp, s);
+            continue;
+        }
+        _mm_storeu_si128(dp, blendQuadSse2(s, _mm_loadu_si128(dp), op));
+    }
+    for (; i < count; ++i)
+        blendOne(src[i], dst[i], opacity, fullOpacity);
+}
+#endif
+
+#if defined(EPIGIMP_BLEND_X86)
+#define EPIGIMP_BLEND_AVX 1
+
+// Two pixels per vector, one per 128-bit lane.
+EPIGIMP_TARGET("avx2")
+inline __m256i blendPairAvx2(const __m256 s, const __m256 d, const __m256 op)
+{
+    const __m256 k255 = _mm256_set1_ps(255.0f);
+    const __m256 kDiv = _mm256_set1_ps(255.0f * 255.0f);
+
+    const __m256 e = _mm256_mul_ps(_mm256_shuffle_ps(s, s, 0xFF), op);
+    const __m256 k = _mm256_mul_ps(_mm256_shuffle_ps(d, d, 0xFF), _mm256_sub_ps(k255, e));
+    const __m256 n = _mm256_add_ps(_mm256_mul_ps(e, k255), k);
+
+    const __m256 s2 = _mm256_blend_ps(s, k255, 0x88);
+    const __m256 d2 = _mm256_blend_ps(d, k255, 0x88);
+    const __m256 num =
+        _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(s2, e), k255), _mm256_mul_ps(d2, k));
+    const __m256 div = _mm256_blend_ps(n, kDiv, 0x88);
+
+    const __m256 q = _mm256_and_ps(_mm256_div_ps(num, div),
+                                   _mm256_cmp_ps(n, _mm256_setzero_ps(), _CMP_GT_OQ));
+    return _mm256_cvtps_epi32(q);
+}
+
+// Four pixels, general path.
+EPIGIMP_TARGET("avx2")
+inline __m128i blendQuadAvx2(const __m128i s, const __m128i d, const __m256 op)
+{
+    const __m128i sHi = _mm_srli_si128(s, 8);
+    const __m128i dHi = _mm_srli_si128(d, 8);
+    const __m256i p01 = blendPairAvx2(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(s)),
+                                      _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(d)), op);
+    const __m256i p23 = blendPairAvx2(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(sHi)),
+                                      _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(dHi)), op);
+    // packs works per 128-bit lane: the pixels come out as p0,p2,p1,p3
+    const __m256i packed =
+        _mm256_packus_epi16(_mm256_packs_epi32(p01, p23), _mm256_setzero_si256());
+    const __m256i ordered =
+        _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 0, 0, 0, 0));
+    return _mm256_castsi256_si128(ordered);
+}
+
+EPIGIMP_TARGET("avx2")
+void sourceOverAvx2(const Pixel* src, Pixel* dst, std::size_t count, float opacity)
+{
+    opacity = clampOpacity(opacity);
+    const bool fullOpacity = opacity >= 1.0f;
+    const __m256 op = _mm256_set1_ps(opacity);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(kAlphaMask));
+    const __m256i zero = _mm256_setzero_si256();
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        auto* dp = reinterpret_cast<__m256i*>(dst + i);
+        const __m256i sA = _mm256_and_si256(s, alpha);
+
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(sA, zero)) == -1)
+        {
+            const __m256i d = _mm256_loadu_si256(dp);
+            const __m256i dClear = _mm256_cmpeq_epi32(_mm256_and_si256(d, alpha), zero);
+            _mm256_storeu_si256(dp, _mm256_andnot_si256(dClear, d));
+            continue;
+        }
+        if (fullOpacity && _mm256_movemask_epi8(_mm256_cmpeq_epi32(sA, alpha)) == -1)
+        {
+            _mm256_storeu_si256(dp, s);
+            continue;
+        }
+        const __m256i d = _mm256_loadu_si256(dp);
+        const __m128i lo =
+            blendQuadAvx2(_mm256_castsi256_si128(s), _mm256_castsi256_si128(d), op);
+        const __m128i hi =
+            blendQuadAvx2(_mm256_extracti128_si256(s, 1), _mm256_extracti128_si256(d, 1), op);
+        _mm256_storeu_si256(dp, _mm256_set_m128i(hi, lo));
+    }
+    for (; i < count; ++i)
+        blendOne(src[i], dst[i], opacity, fullOpacity);
+}
+
+// Four pixels per vector, one per 128-bit lane.
+EPIGIMP_TARGET("avx512f")
+inline __m128i blendQuadAvx512(const __m128i s8, const __m128i d8, const __m512 op)
+{
+    constexpr __mmask16 kAlphaLanes = 0x8888;
+    const __m512 k255 = _mm512_set1_ps(255.0f);
+    const __m512 kDiv = _mm512_set1_ps(255.0f * 255.0f);
+    const __m512 s = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(s8));
+    const __m512 d = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(d8));
+
+    const __m512 e = _mm512_mul_ps(_mm512_shuffle_ps(s, s, 0xFF), op);
+    const __m512 k = _mm512_mul_ps(_mm512_shuffle_ps(d, d, 0xFF), _mm512_sub_ps(k255, e));
+    const __m512 n = _mm512_add_ps(_mm512_mul_ps(e, k255), k);
+
+    const __m512 s2 = _mm512_mask_blend_ps(kAlphaLanes, s, k255);
+    const __m512 d2 = _mm512_mask_blend_ps(kAlphaLanes, d, k255);
+    const __m512 num =
+        _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(s2, e), k255), _mm512_mul_ps(d2, k));
+    const __m512 div = _mm512_mask_blend_ps(kAlphaLanes, n, kDiv);
+
+    const __mmask16 visible = _mm512_cmp_ps_mask(n, _mm512_setzero_ps(), _CMP_GT_OQ);
+    const __m512 q = _mm512_maskz_div_ps(visible, num, div);
+    return _mm512_cvtusepi32_epi8(_mm512_cvtps_epi32(q));
+}
+
+EPIGIMP_TARGET("avx512f")
+void sourceOverAvx512(const Pixel* src, Pixel* dst, std::size_t count, float opacity)
+{
+    opacity = clampOpacity(opacity);
+    const bool fullOpacity = opacity >= 1.0f;
+    const __m512 op = _mm512_set1_ps(opacity);
+    const __m512i alpha = _mm512_set1_epi32(static_cast<int>(kAlphaMask));
+    const __m512i zero = _mm512_setzero_si512();
+
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m512i s = _mm512_loadu_si512(src + i);
+        const __m512i sA = _mm512_and_si512(s, alpha);
+
+        if (_mm512_cmpeq_epi32_mask(sA, zero) == 0xFFFF)
+        {
+            const __m512i d = _mm512_loadu_si512(dst + i);
+            const __mmask16 keep = _mm512_test_epi32_mask(d, alpha);
+            _mm512_storeu_si512(dst + i, _mm512_maskz_mov_epi32(keep, d));
+            continue;
+        }
+        if (fullOpacity && _mm512_cmpeq_epi32_mask(sA, alpha) == 0xFFFF)
+        {
+            _mm512_storeu_si512(dst + i, s);
+            continue;
+        }
+        for (std::size_t q = 0; q < 16; q += 4)
+        {
+            const __m128i s4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + q));
+            auto* dp = reinterpret_cast<__m128i*>(dst + i + q);
+            _mm_storeu_si128(dp, blendQuadAvx512(s4, _mm_loadu_si128(dp), op));
+        }
+    }
+    for (; i < count; ++i)
+        blendOne(src[i], dst[i], opacity, fullOpacity);
+}
+#endif
+
+// ---- Blend modes -----------------------------------------------------------
+// Formule W3C (alpha non prémultiplié), canaux ramenés à 0..1 :
+//   as = srcA * opacity, ab = dstA, ao = as + ab * (1 - as)
+//   Cs' = (1 - ab) * Cs + ab * B(Cb, Cs)
+//   Co  = (as * Cs' + ab * Cb * (1 - as)) / ao
+// Avec B(Cb, Cs) = Cs on retrouve exactement "src over dst".
+
+// Separable blend function B(cb, cs).
+template <core::BlendMode Mode>
+inline float blendChannel(const float cb, const float cs) noexcept
+{
+    if constexpr (Mode == core::BlendMode::Multiply)
+        return cb * cs;
+    else if constexpr (Mode == core::BlendMode::Screen)
+        return cb + cs - cb * cs;
+    else if constexpr (Mode == core::BlendMode::Overlay)
+        return cb <= 0.5f ? 2.0f * cb * cs : 1.0f - 2.0f * (1.0f - cb) * (1.0f - cs);
+    else if constexpr (Mode == core::BlendMode::Darken)
+        return std::min(cb, cs);
+    else if constexpr (Mode == core::BlendMode::Lighten)
+        return std::max(cb, cs);
+    else
+        return cs;
+}
+
+template <core::BlendMode Mode, bool FullOpacity>
+void blendModeRow(const Pixel* src, Pixel* dst, std::size_t count, float opacity)
+{
+    if constexpr (FullOpacity)
+        opacity = 1.0f;
+    else
+        opacity = clampOpacity(opacity);
+    constexpr float kInv255 = 1.0f / 255.0f;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        // transparent src or dst: B() plays no part, this is plain source-over
+        if ((src[i] & kAlphaMask) == 0 || (dst[i] & kAlphaMask) == 0)
+        {
+            blendOne(src[i], dst[i], opacity, FullOpacity);
+            continue;
+        }
+
+        const auto* s = reinterpret_cast<const std::uint8_t*>(&src[i]);
+        auto* d = reinterpret_cast<std::uint8_t*>(&dst[i]);
+        const float as = static_cast<float>(s[3]) * kInv255 * opacity;
+        const float ab = static_cast<float>(d[3]) * kInv255;
+        const float ao = as + ab * (1.0f - as);
+        const float keep = ab * (1.0f - as) / ao;
+        const float take = as / ao;
+
+        for (int c = 0; c < 3; ++c)
+        {
+            const float cs = static_cast<float>(s[c]) * kInv255;
+            const float cb = static_cast<float>(d[c]) * kInv255;
+            const float mixed = cs + ab * (blendChannel<Mode>(cb, cs) - cs);
+            const float co = take * mixed + keep * cb;
+            d[c] = static_cast<std::uint8_t>(std::lrint(std::clamp(co, 0.0f, 1.0f) * 255.0f));
+        }
+        d[3] = static_cast<std::uint8_t>(std::lrint(std::min(ao, 1.0f) * 255.0f));
+    }
+}
+
+template <core::BlendMode Mode>
+constexpr BlendRowFn modeKernel(const bool fullOpacity) noexcept
+{
+    return fullOpacity ? &blendModeRow<Mode, true> : &blendModeRow<Mode, false>;
+}
+
+SimdLevel detectSimdLevel() noexcept
+{
+#if defined(EPIGIMP_BLEND_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4]{};
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuidex(info, 1, 0);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool avx2 = false;
+    bool avx512 = false;
+    if (maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = avx && (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+        avx512 = avx2 && (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    const bool avx2 = __builtin_cpu_supports("avx2");
+    const bool avx512 = avx2 && __builtin_cpu_supports("avx512f");
+#endif
+    if (avx512)
+        return SimdLevel::Avx512;
+    if (avx2)
+        return SimdLevel::Avx2;
+#if defined(EPIGIMP_BLEND_SSE2)
+    return SimdLevel::Sse2;
+#endif
+#endif
+    return SimdLevel::Scalar;
+}
+}  // namespace
+
+namespace core
+{
+SimdLevel detectedSimdLevel() noexcept
+{
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+BlendRowFn sourceOverKernel(const SimdLevel level) noexcept
+{
+    if (static_cast<int>(level) > static_cast<int>(detectedSimdLevel()))
+        return nullptr;
+    switch (level)
+    {
+        case SimdLevel::Scalar:
+            return &sourceOverScalar;
+#if defined(EPIGIMP_BLEND_SSE2)
+        case SimdLevel::Sse2:
+            return &sourceOverSse2;
+#endif
+#if defined(EPIGIMP_BLEND_AVX)
+        case SimdLevel::Avx2:
+            return &sourceOverAvx2;
+        case SimdLevel::Avx512:
+            return &sourceOverAvx512;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+void blendSourceOverRow(std::span<const ImageBuffer::Pixel> src,
+                        std::span<ImageBuffer::Pixel> dst, float opacity)
+{
+    assert(src.size() == dst.size());
+    static const BlendRowFn kernel = sourceOverKernel(detectedSimdLevel());
+    kernel(src.data(), dst.data(), src.size(), opacity);
+}
+
+BlendRowFn blendModeKernel(const BlendMode mode, const bool fullOpacity) noexcept
+{
+    switch (mode)
+    {
+        case BlendMode::Multiply:
+            return modeKernel<BlendMode::Multiply>(fullOpacity);
+        case BlendMode::Screen:
+            return modeKernel<BlendMode::Screen>(fullOpacity);
+        case BlendMode::Overlay:
+            return modeKernel<BlendMode::Overlay>(fullOpacity);
+        case BlendMode::Darken:
+            return modeKernel<BlendMode::Darken>(fullOpacity);
+        case BlendMode::Lighten:
+            return modeKernel<BlendMode::Lighten>(fullOpacity);
+        case BlendMode::Normal:
+        default:
+            return sourceOverKernel(detectedSimdLevel());
+    }
+}
+
+void blendRow(const BlendMode mode, std::span<const ImageBuffer::Pixel> src,
+              std::span<ImageBuffer::Pixel> dst, const float opacity)
+{
+    if (mode == BlendMode::Normal)
+    {
+        blendSourceOverRow(src, dst, opacity);
+        return;
+    }
+    assert(src.size() == dst.size());
+    blendModeKernel(mode, opacity >= 1.0f)(src.data(), dst.data(), src.size(), opacity);
+}
+
+void premultiplyToArgb32Row(std::span<const ImageBuffer::Pixel> src, std::uint32_t* dst)
+{
+    const auto mul = [](std::uint32_t c, std::uint32_t a)
+    {
+        const std::uint32_t v = c * a;
+        return (v + (v >> 8) + 0x80u) >> 8;
+    };
+    for (std::size_t i = 0; i < src.size(); ++i)
+    {
+        const std::uint32_t rgba = ImageBuffer::toRgba(src[i]);
+        const std::uint32_t a = rgba & 0xFFu;
+        const std::uint32_t r = rgba >> 24;
+        const std::uint32_t g = (rgba >> 16) & 0xFFu;
+        const std::uint32_t b = (rgba >> 8) & 0xFFu;
+        if (a == 0xFFu)
+            dst[i] = 0xFF000000u | (r << 16) | (g << 8) | b;
+        else
+            dst[i] = (a << 24) | (mul(r, a) << 16) | (mul(g, a) << 8) | mul(b, a);
+    }
+}
+}  // namespace core
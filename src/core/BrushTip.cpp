@@ -0,0 +1,109 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include "core/BrushTip.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define EPIGIMP_BRUSH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace core
+{
+namespace
+{
+// A stroke asks for the same tip at every dab; a handful of sizes are live at once.
+constexpr std::size_t kMaxCachedTips = 32;
+
+std::mutex cacheMutex;
+std::map<std::pair<int, int>, std::shared_ptr<const BrushTip>> cache;
+}  // namespace
+
+BrushTip::BrushTip(const int diameter, const float hardness)
+    : r_(static_cast<double>(std::max(1, diameter)) * 0.5),
+      hard_(hardness >= 1.f),
+      // soft: coverage reaches 0 half a pixel past the edge
+      outer_(r_ + 0.5),
+      falloff_(std::max(1.0, r_ * (1.0 - std::clamp(static_cast<double>(hardness), 0.0, 1.0)))),
+      radius_(static_cast<int>(std::ceil(reach())))
+{
+    const int n = size();
+    coverage_.assign(static_cast<std::size_t>(n) * static_cast<std::size_t>(n), 0);
+    extents_.assign(static_cast<std::size_t>(n), Extent{0, 0});
+    for (int dy = 0; dy < n; ++dy)
+    {
+        int begin = n;
+        int end = 0;
+        for (int dx = 0; dx < n; ++dx)
+        {
+            const double x = static_cast<double>(dx - radius_);
+            const double y = static_cast<double>(dy - radius_);
+            const std::uint8_t c = coverageAt(x * x + y * y);
+            coverage_[static_cast<std::size_t>(dy) * static_cast<std::size_t>(n) +
+                      static_cast<std::size_t>(dx)] = c;
+            if (c != 0)
+            {
+                begin = std::min(begin, dx);
+                end = dx + 1;
+            }
+        }
+        if (begin < end)
+            extents_[static_cast<std::size_t>(dy)] = Extent{begin, end};
+    }
+}
+
+std::uint8_t BrushTip::coverageAt(const double distSq) const noexcept
+{
+    if (hard_)
+        return distSq <= r_ * r_ ? 255 : 0;
+    const double t = (outer_ - std::sqrt(distSq)) / falloff_;
+    return static_cast<std::uint8_t>(std::lround(std::clamp(t, 0.0, 1.0) * 255.0));
+}
+
+std::shared_ptr<const BrushTip> BrushTip::get(const int diameter, const float hardness)
+{
+    const std::pair key{std::max(1, diameter),
+                        static_cast<int>(std::lround(std::clamp(hardness, 0.f, 1.f) * 100.f))};
+    std::lock_guard lock(cacheMutex);
+    if (const auto it = cache.find(key); it != cache.end())
+        return it->second;
+    if (cache.size() >= kMaxCachedTips)
+        cache.clear();
+    auto tip = std::make_shared<const BrushTip>(key.first, static_cast<float>(key.second) / 100.f);
+    cache.emplace(key, tip);
+    return tip;
+}
+
+std::uint64_t raiseCoverage(std::uint8_t* dst, const std::uint8_t* src, const int n) noexcept
+{
+    assert(n <= 64);
+    std::uint64_t raised = 0;
+    int i = 0;
+#if defined(EPIGIMP_BRUSH_SSE2)
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        const __m128i m = _mm_max_epu8(d, _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), m);
+        const auto same = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(m, d)));
+        raised |= static_cast<std::uint64_t>(~same & 0xFFFFu) << i;
+    }
+#endif
+    for (; i < n; ++i)
+        if (src[i] > dst[i])
+        {
+            dst[i] = src[i];
+            raised |= std::uint64_t{1} << i;
+        }
+    return raised;
+}
+}  // namespace core
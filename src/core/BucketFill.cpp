@@ -7,203 +7,803 @@
 
 #include "core/BucketFill.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cassert>
-#include <tuple>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <span>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "core/AlphaMask.hpp"
 #include "core/ImageBuffer.hpp"
+#include "core/Selection.hpp"
+#include "core/ThreadPool.hpp"
+
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define EPIGIMP_FILL_SSE2 1
+#include <emmintrin.h>
+#endif
 
 namespace core
 {
-void floodFill(ImageBuffer& buf, int startX, int startY, Color newColor)
+namespace
 {
-    const uint32_t newCol = newColor.value;
-    const int w = buf.width();
-    const int h = buf.height();
-    if (startX < 0 || startX >= w || startY < 0 || startY >= h)
-        return;
+using Pixel = ImageBuffer::Pixel;
 
-    const uint32_t target = buf.getPixel(startX, startY);
-    if (target == newCol)
-        return;
-
-    std::vector<std::pair<int, int>> stack;
-    stack.emplace_back(startX, startY);
+// Per-channel test against the seed pixel, on stored pixels (the channel order does not matter
+// for either metric).
+struct ColorMatcher
+{
+    Pixel target;
+    int tolerance;  // 0 = exact match
+    ColorMetric metric;
+};
 
-    while (!stack.empty())
+bool matchesScalar(const ColorMatcher& m, Pixel px)
+{
+    if (m.tolerance == 0)
+        return px == m.target;
+    int maxDiff = 0;
+    int sumSq = 0;
+    for (int shift = 0; shift < 32; shift += 8)
     {
-        auto [x, y] = stack.back();
-        stack.pop_back();
+        const int d = std::abs(static_cast<int>((px >> shift) & 0xFFu) -
+                               static_cast<int>((m.target >> shift) & 0xFFu));
+        maxDiff = std::max(maxDiff, d);
+        sumSq += d * d;
+    }
+    return m.metric == ColorMetric::MaxChannel ? maxDiff <= m.tolerance
+                                               : sumSq <= m.tolerance * m.tolerance;
+}
 
-        if (x < 0 || x >= w || y < 0 || y >= h)
-            continue;
+#if defined(EPIGIMP_FILL_SSE2)
+// Four pixels -> 4 bits (movemask of the per-pixel lanes).
+int matchQuadSse2(const ColorMatcher& m, __m128i px, __m128i target, __m128i tol)
+{
+    if (m.tolerance == 0)
+        return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(px, target)));
 
-        if (buf.getPixel(x, y) != target)
-            continue;
+    const __m128i diff = _mm_or_si128(_mm_subs_epu8(px, target), _mm_subs_epu8(target, px));
+    if (m.metric == ColorMetric::MaxChannel)
+    {
+        // every channel within tolerance <=> no byte left once the tolerance is subtracted
+        const __m128i over = _mm_subs_epu8(diff, tol);
+        return _mm_movemask_ps(
+            _mm_castsi128_ps(_mm_cmpeq_epi32(over, _mm_setzero_si128())));
+    }
 
-        buf.setPixel(x, y, newCol);
+    // squared channel differences summed per pixel: madd gives (c0² + c1²), (c2² + c3²) pairs
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(diff, zero), _mm_unpacklo_epi8(diff, zero));
+    const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(diff, zero), _mm_unpackhi_epi8(diff, zero));
+    const __m128 sums = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi),
+                                       _MM_SHUFFLE(2, 0, 2, 0));
+    const __m128 pairs = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi),
+                                        _MM_SHUFFLE(3, 1, 3, 1));
+    const __m128i sumSq = _mm_add_epi32(_mm_castps_si128(sums), _mm_castps_si128(pairs));
+    const __m128i tolSq = _mm_set1_epi32(m.tolerance * m.tolerance);
+    return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(sumSq, tolSq))) ^ 0xF;
+}
+#endif
 
-        stack.emplace_back(x + 1, y);
-        stack.emplace_back(x - 1, y);
-        stack.emplace_back(x, y + 1);
-        stack.emplace_back(x, y - 1);
+// Bit i set when px[i] matches, n <= 64.
+std::uint64_t matchBits(const ColorMatcher& m, const Pixel* px, int n)
+{
+    std::uint64_t bits = 0;
+    int i = 0;
+#if defined(EPIGIMP_FILL_SSE2)
+    const __m128i target = _mm_set1_epi32(static_cast<int>(m.target));
+    const __m128i tol = _mm_set1_epi8(static_cast<char>(std::clamp(m.tolerance, 0, 255)));
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i quad = _mm_loadu_si128(reinterpret_cast<const __m128i*>(px + i));
+        bits |= static_cast<std::uint64_t>(matchQuadSse2(m, quad, target, tol)) << i;
     }
+#endif
+    for (; i < n; ++i)
+        if (matchesScalar(m, px[i]))
+            bits |= std::uint64_t{1} << i;
+    return bits;
 }
 
-void floodFillWithinMask(ImageBuffer& buf, const ImageBuffer& mask, int startX, int startY,
-                         Color newColor)
+std::uint64_t lowBits(int n)
 {
-    const uint32_t newCol = newColor.value;
-    const int w = buf.width();
-    const int h = buf.height();
-    assert(mask.width() == w && mask.height() == h);
-    if (startX < 0 || startX >= w || startY < 0 || startY >= h)
-        return;
-
-    if ((mask.getPixel(startX, startY) & 0xFF) == 0)
-        return;
-
-    const uint32_t target = buf.getPixel(startX, startY);
-    if (target == newCol)
-        return;
+    return n >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << n) - 1;
+}
 
-    std::vector<std::pair<int, int>> stack;
-    stack.emplace_back(startX, startY);
+// Pixels the collect variants already took, one bit per pixel in 64x64 tiles allocated the
+// first time the fill reaches them (one word per tile row). reset() keeps the storage, so a
+// set reused across fills stops allocating once it has seen its largest region.
+class VisitedSet
+{
+   public:
+    void reset(int w, int h)
+    {
+        cols_ = (w + kTile - 1) / kTile;
+        const int rows = (h + kTile - 1) / kTile;
+        tileWords_.assign(static_cast<std::size_t>(cols_) * static_cast<std::size_t>(rows), -1);
+        words_.clear();
+    }
 
-    while (!stack.empty())
+    // Bit i set when pixel (x + i, y) was visited, n <= 64.
+    [[nodiscard]] std::uint64_t bits(int x, int y, int n) const
     {
-        auto [x, y] = stack.back();
-        stack.pop_back();
+        const int bit = x % kTile;
+        std::uint64_t out = word(x / kTile, y) >> bit;
+        if (bit != 0 && bit + n > kTile)
+            out |= word(x / kTile + 1, y) << (kTile - bit);
+        return out & lowBits(n);
+    }
 
-        if (x < 0 || x >= w || y < 0 || y >= h)
-            continue;
+    void set(int x0, int x1, int y)
+    {
+        while (x0 < x1)
+        {
+            const int bit = x0 % kTile;
+            const int n = std::min(kTile - bit, x1 - x0);
+            wordForWrite(x0 / kTile, y) |= lowBits(n) << bit;
+            x0 += n;
+        }
+    }
 
-        if ((mask.getPixel(x, y) & 0xFF) == 0)
-            continue;
+   private:
+    static constexpr int kTile = 64;
 
-        if (buf.getPixel(x, y) != target)
-            continue;
+    [[nodiscard]] std::size_t tileIndex(int tx, int y) const
+    {
+        return static_cast<std::size_t>(y / kTile) * static_cast<std::size_t>(cols_) +
+               static_cast<std::size_t>(tx);
+    }
 
-        buf.setPixel(x, y, newCol);
+    [[nodiscard]] std::uint64_t word(int tx, int y) const
+    {
+        const std::ptrdiff_t first = tileWords_[tileIndex(tx, y)];
+        return first < 0 ? 0 : words_[static_cast<std::size_t>(first + y % kTile)];
+    }
 
-        stack.emplace_back(x + 1, y);
-        stack.emplace_back(x - 1, y);
-        stack.emplace_back(x, y + 1);
-        stack.emplace_back(x, y - 1);
+    std::uint64_t& wordForWrite(int tx, int y)
+    {
+        std::ptrdiff_t& first = tileWords_[tileIndex(tx, y)];
+        if (first < 0)
+        {
+            first = static_cast<std::ptrdiff_t>(words_.size());
+            words_.resize(words_.size() + kTile, 0);
+        }
+        return words_[static_cast<std::size_t>(first + y % kTile)];
     }
-}
 
-std::vector<std::tuple<int, int, uint32_t>> floodFillCollect(const ImageBuffer& buf, int startX,
-                                                             int startY, Color newColor)
+    int cols_{0};
+    std::vector<std::ptrdiff_t> tileWords_;  // first word of each tile in words_, -1 = none
+    std::vector<std::uint64_t> words_;
+};
+
+struct Seed
 {
-    std::vector<std::tuple<int, int, uint32_t>> changes;
+    int x;
+    int y;
+};
 
-    const int w = buf.width();
-    const int h = buf.height();
-    const uint32_t newCol = newColor.value;
+// Working buffers of the serial fill, one set per thread and reused by every fill it runs.
+struct FillScratch
+{
+    VisitedSet visited;
+    std::vector<Seed> seeds;
+};
 
-    if (startX < 0 || startX >= w || startY < 0 || startY >= h)
-        return changes;
+thread_local FillScratch fillScratch;
 
-    const uint32_t target = buf.getPixel(startX, startY);
-    if (target == newCol)
-        return changes;
+// Loads the tiles of a lazy source the first time the serial fill reads them.
+class LazyTiles
+{
+   public:
+    LazyTiles(const ImageBuffer& buf, const TileLoader& load)
+        : load_(load),
+          cols_((buf.width() + ImageBuffer::kTileSize - 1) / ImageBuffer::kTileSize),
+          loaded_(static_cast<std::size_t>(cols_) *
+                      static_cast<std::size_t>((buf.height() + ImageBuffer::kTileSize - 1) /
+                                               ImageBuffer::kTileSize),
+                  0)
+    {
+    }
 
-    std::vector<uint8_t> visited(static_cast<size_t>(w) * static_cast<size_t>(h), 0);
+    // Tile holding pixel (x, y).
+    void ensure(int x, int y)
+    {
+        ensureTile(x / ImageBuffer::kTileSize, y / ImageBuffer::kTileSize);
+    }
 
-    auto pushIfValid = [&](int x, int y, std::vector<std::pair<int, int>>& st)
+   private:
+    void ensureTile(int tx, int ty)
     {
-        if (x < 0 || x >= w || y < 0 || y >= h)
+        auto& loaded = loaded_[static_cast<std::size_t>(ty) * static_cast<std::size_t>(cols_) +
+                               static_cast<std::size_t>(tx)];
+        if (loaded != 0)
             return;
-        const size_t idx = static_cast<size_t>(y) * static_cast<size_t>(w) + static_cast<size_t>(x);
-        if (visited[idx])
-            return;
-        visited[idx] = 1;
-        st.emplace_back(x, y);
-    };
+        loaded = 1;
+        load_(tx, ty);
+    }
 
-    std::vector<std::pair<int, int>> stack;
-    pushIfValid(startX, startY, stack);
+    const TileLoader& load_;
+    int cols_;
+    std::vector<std::uint8_t> loaded_;
+};
+
+// Clip of the within-mask fills: buffer pixel (x, y) is selected when mask pixel
+// (x + offset.x, y + offset.y) is covered, or when the selection view covers it.
+struct MaskClip
+{
+    const AlphaMask* mask{nullptr};
+    common::Point offset{};
+    const SelectionView* selection{nullptr};
+};
+
+// Which pixels belong to the region: close enough to the seed pixel, selected in the mask when
+// there is one, and not visited yet for the collect variants (the in-place fills
+// need no visited set: a filled pixel no longer matches the target).
+struct FillRule
+{
+    const ImageBuffer& buf;
+    MaskClip clip;
+    ColorMatcher matcher;
+    const VisitedSet* visited;
+    LazyTiles* lazy{nullptr};  // serial collect on a lazy source only
+};
+
+// Pixels of row y in [x, x + n) that may be read as one contiguous run of buf.
+int chunkLength(const FillRule& rule, int x, int n)
+{
+    n = rule.buf.runLength(x, n);
+    if (rule.lazy)
+        n = std::min(n, ImageBuffer::kTileSize - x % ImageBuffer::kTileSize);
+    return n;
+}
+
+// Bit i set when pixel (x + i, y) is in the region; n <= 64 and within chunkLength().
+std::uint64_t insideBits(const FillRule& rule, int x, int y, int n)
+{
+    if (rule.lazy)
+        rule.lazy->ensure(x, y);
+    std::uint64_t bits = matchBits(rule.matcher, rule.buf.span(x, y, n).data(), n);
+    if (rule.clip.mask && bits != 0)
+        bits &= rule.clip.mask->coverageBits(x + rule.clip.offset.x, y + rule.clip.offset.y, n);
+    if (rule.clip.selection && bits != 0)
+        bits &= rule.clip.selection->coverageBits(x, y, n);
+    if (rule.visited && bits != 0)
+        bits &= ~rule.visited->bits(x, y, n);
+    return bits;
+}
+
+// First x in [x, limit) whose "inside" state differs from `inside`, limit when there is none.
+int scanRight(const FillRule& rule, int x, int y, int limit, bool inside)
+{
+    while (x < limit)
+    {
+        const int n = chunkLength(rule, x, std::min(64, limit - x));
+        std::uint64_t bits = insideBits(rule, x, y, n);
+        if (inside)
+            bits = ~bits & lowBits(n);
+        if (bits != 0)
+            return x + std::countr_zero(bits);
+        x += n;
+    }
+    return limit;
+}
+
+// Leftmost x' <= x such that [x', x] is inside; x itself must be inside.
+int scanLeft(const FillRule& rule, int x, int y)
+{
+    while (x > 0)
+    {
+        // chunks end on tile edges, the start of a tile is always a valid run start
+        const int start = ((x - 1) / ImageBuffer::kTileSize) * ImageBuffer::kTileSize;
+        const int n = chunkLength(rule, start, x - start);
+        const std::uint64_t outside = ~insideBits(rule, start, y, n) & lowBits(n);
+        if (outside != 0)
+            return start + (63 - std::countl_zero(outside)) + 1;
+        x = start;
+    }
+    return 0;
+}
+
+// Scanline fill: every popped seed grows into the whole horizontal run [x0, x1) of row y, which
+// is handed to fillSpan (that must take it out of the region), then one seed is pushed per run
+// of region pixels touching it in the rows above and below. The stack holds runs, not pixels.
+// fillSpan returns false to stop early; scanlineFill then returns false too.
+template <typename FillSpan>
+bool scanlineFill(const FillRule& rule, int startX, int startY, FillSpan&& fillSpan)
+{
+    const int w = rule.buf.width();
+    const int h = rule.buf.height();
+
+    std::vector<Seed>& stack = fillScratch.seeds;
+    stack.clear();
+    stack.push_back({startX, startY});
 
     while (!stack.empty())
     {
-        auto [x, y] = stack.back();
+        const Seed seed = stack.back();
         stack.pop_back();
 
-        const uint32_t oldColor = buf.getPixel(x, y);
-        if (oldColor != target)
+        // outside the region (masked start) or already filled from another seed
+        if (scanRight(rule, seed.x, seed.y, seed.x + 1, true) == seed.x)
             continue;
 
-        changes.emplace_back(x, y, oldColor);
-
-        pushIfValid(x + 1, y, stack);
-        pushIfValid(x - 1, y, stack);
-        pushIfValid(x, y + 1, stack);
-        pushIfValid(x, y - 1, stack);
+        const int x0 = scanLeft(rule, seed.x, seed.y);
+        const int x1 = scanRight(rule, seed.x + 1, seed.y, w, true);
+        if (!fillSpan(x0, x1, seed.y))
+            return false;
+
+        for (const int ny : {seed.y - 1, seed.y + 1})
+        {
+            if (ny < 0 || ny >= h)
+                continue;
+            int x = x0;
+            while (x < x1)
+            {
+                x = scanRight(rule, x, ny, x1, false);
+                if (x >= x1)
+                    break;
+                stack.push_back({x, ny});
+                x = scanRight(rule, x + 1, ny, x1, true);
+            }
+        }
     }
+    return true;
+}
+
+// ---- Parallel labeling ------------------------------------------------------
+// Large regions are labeled tile by tile on the pool: each worker splits its tile rows into runs
+// of region pixels and joins the runs that touch in consecutive rows (union-find local to the
+// tile). The runs touching across tile borders are then joined serially, and the region is the
+// set of runs sharing the seed's root, the same 4-connected component the scanline fill finds.
+
+constexpr int kLabelTile = 4 * ImageBuffer::kTileSize;
+
+std::atomic<std::size_t> parallelThreshold{std::size_t{1} << 20};
 
-    return changes;
+core::ThreadPool& fillPool()
+{
+    static core::ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
 }
 
-std::vector<std::tuple<int, int, uint32_t>> floodFillWithinMaskCollect(const ImageBuffer& buf,
-                                                                       const ImageBuffer& mask,
-                                                                       int startX, int startY,
-                                                                       Color newColor)
+struct Run
 {
-    std::vector<std::tuple<int, int, uint32_t>> changes;
+    int x0;
+    int x1;
+};
 
-    const int w = buf.width();
-    const int h = buf.height();
-    assert(mask.width() == w && mask.height() == h);
+struct TileRuns
+{
+    common::Rect rect;
+    std::vector<Run> runs;      // row after row
+    std::vector<int> rowStart;  // rect.h + 1 offsets into runs
+    int offset{0};              // global label of runs[0]
+};
 
-    const uint32_t newCol = newColor.value;
-    if (startX < 0 || startX >= w || startY < 0 || startY >= h)
-        return changes;
+int findRoot(std::vector<int>& parent, int i)
+{
+    while (parent[static_cast<std::size_t>(i)] != i)
+    {
+        auto& p = parent[static_cast<std::size_t>(i)];
+        p = parent[static_cast<std::size_t>(p)];
+        i = p;
+    }
+    return i;
+}
 
-    if ((mask.getPixel(startX, startY) & 0xFF) == 0)
-        return changes;
+void unite(std::vector<int>& parent, int a, int b)
+{
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a != b)
+        parent[static_cast<std::size_t>(std::max(a, b))] = std::min(a, b);
+}
 
-    const uint32_t target = buf.getPixel(startX, startY);
-    if (target == newCol)
-        return changes;
+// Joins the overlapping runs of two consecutive rows: above[a0, a1) and below[b0, b1).
+template <typename Join>
+void joinOverlaps(const std::vector<Run>& above, int a0, int a1, const std::vector<Run>& below,
+                  int b0, int b1, Join&& join)
+{
+    while (a0 < a1 && b0 < b1)
+    {
+        const Run& a = above[static_cast<std::size_t>(a0)];
+        const Run& b = below[static_cast<std::size_t>(b0)];
+        if (a.x0 < b.x1 && b.x0 < a.x1)
+            join(a0, b0);
+        if (a.x1 < b.x1)
+            ++a0;
+        else
+            ++b0;
+    }
+}
 
-    std::vector<uint8_t> visited(static_cast<size_t>(w) * static_cast<size_t>(h), 0);
+void labelTile(const FillRule& rule, TileRuns& tile, std::vector<int>& parent)
+{
+    const common::Rect& r = tile.rect;
+    tile.rowStart.assign(static_cast<std::size_t>(r.h) + 1, 0);
+    for (int y = 0; y < r.h; ++y)
+    {
+        tile.rowStart[static_cast<std::size_t>(y)] = static_cast<int>(tile.runs.size());
+        int x = r.x;
+        while (x < r.x + r.w)
+        {
+            x = scanRight(rule, x, r.y + y, r.x + r.w, false);
+            if (x >= r.x + r.w)
+                break;
+            const int end = scanRight(rule, x + 1, r.y + y, r.x + r.w, true);
+            tile.runs.push_back({x, end});
+            x = end;
+        }
+    }
+    tile.rowStart.back() = static_cast<int>(tile.runs.size());
+
+    parent.resize(tile.runs.size());
+    for (std::size_t i = 0; i < parent.size(); ++i)
+        parent[i] = static_cast<int>(i);
+    for (std::size_t y = 1; y < static_cast<std::size_t>(r.h); ++y)
+        joinOverlaps(tile.runs, tile.rowStart[y - 1], tile.rowStart[y], tile.runs,
+                     tile.rowStart[y], tile.rowStart[y + 1],
+                     [&](int a, int b) { unite(parent, a, b); });
+}
 
-    auto pushIfValid = [&](int x, int y, std::vector<std::pair<int, int>>& st)
+void setBits(std::uint64_t* row, int from, int to)
+{
+    while (from < to)
     {
-        if (x < 0 || x >= w || y < 0 || y >= h)
-            return;
-        const size_t idx = static_cast<size_t>(y) * static_cast<size_t>(w) + static_cast<size_t>(x);
-        if (visited[idx])
-            return;
-        visited[idx] = 1;
-        st.emplace_back(x, y);
+        const int bit = from % 64;
+        const int n = std::min(64 - bit, to - from);
+        const std::uint64_t ones = n == 64 ? ~std::uint64_t{0} : ((std::uint64_t{1} << n) - 1);
+        row[from / 64] |= ones << bit;
+        from += n;
+    }
+}
+
+FillRegion parallelRegion(const FillRule& rule, int startX, int startY, Color newColor)
+{
+    const int w = rule.buf.width();
+    const int h = rule.buf.height();
+    const int cols = (w + kLabelTile - 1) / kLabelTile;
+    const int rows = (h + kLabelTile - 1) / kLabelTile;
+    auto& pool = fillPool();
+
+    std::vector<TileRuns> tiles(static_cast<std::size_t>(cols) * static_cast<std::size_t>(rows));
+    std::vector<std::vector<int>> localParents(tiles.size());
+    pool.parallelFor(static_cast<int>(tiles.size()),
+                     [&](int i)
+                     {
+                         auto& tile = tiles[static_cast<std::size_t>(i)];
+                         const int tx = i % cols;
+                         const int ty = i / cols;
+                         tile.rect = common::intersect(
+                             common::Rect{0, 0, w, h},
+                             common::Rect{tx * kLabelTile, ty * kLabelTile, kLabelTile,
+                                          kLabelTile});
+                         labelTile(rule, tile, localParents[static_cast<std::size_t>(i)]);
+                     });
+
+    // global labels: tile offset + local root
+    int total = 0;
+    for (auto& tile : tiles)
+    {
+        tile.offset = total;
+        total += static_cast<int>(tile.runs.size());
+    }
+    std::vector<int> parent(static_cast<std::size_t>(total));
+    for (std::size_t t = 0; t < tiles.size(); ++t)
+        for (std::size_t i = 0; i < localParents[t].size(); ++i)
+            parent[static_cast<std::size_t>(tiles[t].offset) + i] =
+                tiles[t].offset + findRoot(localParents[t], static_cast<int>(i));
+    localParents = {};
+
+    const auto tileAt = [&](int tx, int ty) -> TileRuns&
+    { return tiles[static_cast<std::size_t>(ty) * static_cast<std::size_t>(cols) +
+                   static_cast<std::size_t>(tx)]; };
+    const auto rowRuns = [](const TileRuns& tile, int y)
+    {
+        return std::pair{tile.rowStart[static_cast<std::size_t>(y)],
+                         tile.rowStart[static_cast<std::size_t>(y) + 1]};
     };
 
-    std::vector<std::pair<int, int>> stack;
-    pushIfValid(startX, startY, stack);
+    for (int ty = 0; ty < rows; ++ty)
+        for (int tx = 0; tx < cols; ++tx)
+        {
+            const TileRuns& tile = tileAt(tx, ty);
+            // right border: a run ending on the edge meets a run starting there, same row
+            if (tx + 1 < cols)
+            {
+                const TileRuns& right = tileAt(tx + 1, ty);
+                for (int y = 0; y < tile.rect.h; ++y)
+                {
+                    const auto [a0, a1] = rowRuns(tile, y);
+                    const auto [b0, b1] = rowRuns(right, y);
+                    if (a0 < a1 && b0 < b1 &&
+                        tile.runs[static_cast<std::size_t>(a1) - 1].x1 == right.rect.x &&
+                        right.runs[static_cast<std::size_t>(b0)].x0 == right.rect.x)
+                        unite(parent, tile.offset + a1 - 1, right.offset + b0);
+                }
+            }
+            // bottom border: last row of this tile against the first row of the one below
+            if (ty + 1 < rows)
+            {
+                const TileRuns& below = tileAt(tx, ty + 1);
+                const auto [a0, a1] = rowRuns(tile, tile.rect.h - 1);
+                const auto [b0, b1] = rowRuns(below, 0);
+                joinOverlaps(tile.runs, a0, a1, below.runs, b0, b1, [&](int a, int b)
+                             { unite(parent, tile.offset + a, below.offset + b); });
+            }
+        }
+    for (int i = 0; i < total; ++i)
+        parent[static_cast<std::size_t>(i)] = findRoot(parent, i);
+
+    FillRegion region;
+    region.color = newColor;
+    int seedLabel = -1;
+    {
+        const TileRuns& tile = tileAt(startX / kLabelTile, startY / kLabelTile);
+        const auto [a0, a1] = rowRuns(tile, startY - tile.rect.y);
+        for (int a = a0; a < a1; ++a)
+        {
+            const Run& run = tile.runs[static_cast<std::size_t>(a)];
+            if (run.x0 <= startX && startX < run.x1)
+                seedLabel = parent[static_cast<std::size_t>(tile.offset + a)];
+        }
+    }
+    if (seedLabel < 0)
+        return region;
+
+    const auto inRegion = [&](const TileRuns& tile, int i)
+    { return parent[static_cast<std::size_t>(tile.offset + i)] == seedLabel; };
+
+    int x0 = w;
+    int y0 = h;
+    int x1 = 0;
+    int y1 = 0;
+    for (const auto& tile : tiles)
+        for (int y = 0; y < tile.rect.h; ++y)
+        {
+            const auto [a0, a1] = rowRuns(tile, y);
+            for (int a = a0; a < a1; ++a)
+            {
+                if (!inRegion(tile, a))
+                    continue;
+                const Run& run = tile.runs[static_cast<std::size_t>(a)];
+                region.count += static_cast<std::size_t>(run.x1 - run.x0);
+                x0 = std::min(x0, run.x0);
+                x1 = std::max(x1, run.x1);
+                y0 = std::min(y0, tile.rect.y + y);
+                y1 = std::max(y1, tile.rect.y + y + 1);
+            }
+        }
+
+    region.bounds = common::Rect{x0, y0, x1 - x0, y1 - y0};
+    region.wordsPerRow = (region.bounds.w + 63) / 64;
+    region.bits.assign(
+        static_cast<std::size_t>(region.wordsPerRow) * static_cast<std::size_t>(region.bounds.h),
+        0);
+    // one tile row per task: tiles of the same row share words, different rows do not
+    pool.parallelFor(rows,
+                     [&](int ty)
+                     {
+                         for (int tx = 0; tx < cols; ++tx)
+                         {
+                             const TileRuns& tile = tileAt(tx, ty);
+                             for (int y = 0; y < tile.rect.h; ++y)
+                             {
+                                 const int docY = tile.rect.y + y;
+                                 if (docY < y0 || docY >= y1)
+                                     continue;
+                                 std::uint64_t* row =
+                                     region.bits.data() +
+                                     static_cast<std::size_t>(docY - y0) *
+                                         static_cast<std::size_t>(region.wordsPerRow);
+                                 const auto [a0, a1] = rowRuns(tile, y);
+                                 for (int a = a0; a < a1; ++a)
+                                     if (inRegion(tile, a))
+                                     {
+                                         const Run& run = tile.runs[static_cast<std::size_t>(a)];
+                                         setBits(row, run.x0 - x0, run.x1 - x0);
+                                     }
+                             }
+                         }
+                     });
+    return region;
+}
 
-    while (!stack.empty())
+// Region size past which the serial fill hands over to parallelRegion(). Labeling costs the
+// whole image whatever the region, so small regions of huge images stay serial.
+std::size_t serialBudget(const ImageBuffer& buf)
+{
+    const std::size_t area =
+        static_cast<std::size_t>(buf.width()) * static_cast<std::size_t>(buf.height());
+    return std::max(parallelThreshold.load(std::memory_order_relaxed), area / 4);
+}
+
+// Exact fills with the seed already at the new color change nothing. With a tolerance, the
+// neighbours that only come close to it are still filled.
+bool nothingToFill(Pixel target, Pixel newCol, const FillCriteria& criteria)
+{
+    return criteria.tolerance <= 0 && target == newCol;
+}
+
+ColorMatcher makeMatcher(Pixel target, const FillCriteria& criteria)
+{
+    return ColorMatcher{target, std::clamp(criteria.tolerance, 0, 255), criteria.metric};
+}
+
+FillRegion collect(const ImageBuffer& buf, const MaskClip& clip, int startX, int startY,
+                   Color newColor, const FillCriteria& criteria, LazyTiles* lazy = nullptr);
+
+void fillInPlace(ImageBuffer& buf, const MaskClip& clip, int startX, int startY,
+                 Color newColor, const FillCriteria& criteria)
+{
+    const Pixel newCol = ImageBuffer::toPixel(newColor.value);
+    const int w = buf.width();
+    const int h = buf.height();
+    if (startX < 0 || startX >= w || startY < 0 || startY >= h)
+        return;
+
+    const Pixel target = buf.pixel(startX, startY);
+    if (nothingToFill(target, newCol, criteria))
+        return;
+
+    // The in-place fill relies on filled pixels no longer matching, which a tolerance breaks, and
+    // cannot be handed over halfway: those cases go through a collected region.
+    if (criteria.tolerance > 0 ||
+        static_cast<std::size_t>(w) * static_cast<std::size_t>(h) > serialBudget(buf))
     {
-        auto [x, y] = stack.back();
-        stack.pop_back();
+        fillRegion(buf, collect(buf, clip, startX, startY, newColor, criteria));
+        return;
+    }
 
-        if ((mask.getPixel(x, y) & 0xFF) == 0)
-            continue;
+    const FillRule rule{buf, clip, makeMatcher(target, criteria), nullptr};
+    scanlineFill(rule, startX, startY,
+                 [&](int x0, int x1, int y)
+                 {
+                     for (int x = x0; x < x1;)
+                     {
+                         const int n = buf.runLength(x, x1 - x);
+                         const auto px = buf.span(x, y, n);
+                         std::fill(px.begin(), px.end(), newCol);
+                         x += n;
+                     }
+                     return true;
+                 });
+}
 
-        const uint32_t oldColor = buf.getPixel(x, y);
-        if (oldColor != target)
-            continue;
+FillRegion collect(const ImageBuffer& buf, const MaskClip& clip, int startX, int startY,
+                   Color newColor, const FillCriteria& criteria, LazyTiles* lazy)
+{
+    FillRegion region;
+    region.color = newColor;
 
-        changes.emplace_back(x, y, oldColor);
+    const int w = buf.width();
+    const int h = buf.height();
 
-        pushIfValid(x + 1, y, stack);
-        pushIfValid(x - 1, y, stack);
-        pushIfValid(x, y + 1, stack);
-        pushIfValid(x, y - 1, stack);
+    const Pixel newCol = ImageBuffer::toPixel(newColor.value);
+    if (startX < 0 || startX >= w || startY < 0 || startY >= h)
+        return region;
+
+    if (lazy)
+        lazy->ensure(startX, startY);
+    const Pixel target = buf.pixel(startX, startY);
+    if (nothingToFill(target, newCol, criteria))
+        return region;
+
+    VisitedSet& visited = fillScratch.visited;
+    visited.reset(w, h);
+    const FillRule rule{buf, clip, makeMatcher(target, criteria), &visited, lazy};
+    // A lazy source stays serial whatever the region: labeling would load every tile, the
+    // scanline fill only the ones it reaches.
+    const std::size_t budget =
+        lazy ? std::numeric_limits<std::size_t>::max() : serialBudget(buf);
+    int x0 = w;
+    int y0 = h;
+    int x1 = 0;
+    int y1 = 0;
+    const bool done = scanlineFill(rule, startX, startY,
+                                   [&](int spanX0, int spanX1, int y)
+                                   {
+                                       visited.set(spanX0, spanX1, y);
+                                       region.count += static_cast<std::size_t>(spanX1 - spanX0);
+                                       x0 = std::min(x0, spanX0);
+                                       x1 = std::max(x1, spanX1);
+                                       y0 = std::min(y0, y);
+                                       y1 = std::max(y1, y + 1);
+                                       return region.count <= budget;
+                                   });
+    if (!done)
+        return parallelRegion(FillRule{buf, clip, rule.matcher, nullptr}, startX, startY,
+                              newColor);
+    if (region.count == 0)
+        return region;
+
+    // copy the visited bits of the bounding box, realigned on its left edge
+    region.bounds = common::Rect{x0, y0, x1 - x0, y1 - y0};
+    region.wordsPerRow = (region.bounds.w + 63) / 64;
+    region.bits.assign(
+        static_cast<std::size_t>(region.wordsPerRow) * static_cast<std::size_t>(region.bounds.h),
+        0);
+    for (int y = y0; y < y1; ++y)
+    {
+        std::uint64_t* dst = region.bits.data() + static_cast<std::size_t>(y - y0) *
+                                                      static_cast<std::size_t>(region.wordsPerRow);
+        for (int k = 0; k < region.wordsPerRow; ++k)
+        {
+            const int x = x0 + k * 64;
+            dst[k] = visited.bits(x, y, std::min(64, x1 - x));
+        }
     }
+    return region;
+}
+}  // namespace
+
+void floodFill(ImageBuffer& buf, int startX, int startY, Color newColor,
+               const FillCriteria& criteria)
+{
+    fillInPlace(buf, MaskClip{}, startX, startY, newColor, criteria);
+}
+
+void floodFillWithinMask(ImageBuffer& buf, const AlphaMask& mask, int startX, int startY,
+                         Color newColor, const FillCriteria& criteria, common::Point maskOffset)
+{
+    fillInPlace(buf, MaskClip{&mask, maskOffset}, startX, startY, newColor, criteria);
+}
+
+FillRegion floodFillCollect(const ImageBuffer& buf, int startX, int startY, Color newColor,
+                            const FillCriteria& criteria)
+{
+    return collect(buf, MaskClip{}, startX, startY, newColor, criteria);
+}
+
+FillRegion floodFillWithinMaskCollect(const ImageBuffer& buf, const AlphaMask& mask, int startX,
+                                      int startY, Color newColor, const FillCriteria& criteria,
+                                      common::Point maskOffset)
+{
+    return collect(buf, MaskClip{&mask, maskOffset}, startX, startY, newColor, criteria);
+}
 
-    return changes;
+FillRegion floodFillWithinSelectionCollect(const ImageBuffer& buf, const SelectionView& selection,
+                                           int startX, int startY, Color newColor,
+                                           const FillCriteria& criteria)
+{
+    return collect(buf, MaskClip{nullptr, {}, &selection}, startX, startY, newColor, criteria);
+}
+
+FillRegion floodFillCollectLazy(const ImageBuffer& buf, const TileLoader& load,
+                                const SelectionView* selection, int startX, int startY,
+                                Color newColor, const FillCriteria& criteria)
+{
+    LazyTiles lazy(buf, load);
+    return collect(buf, MaskClip{nullptr, {}, selection}, startX, startY, newColor, criteria,
+                   &lazy);
+}
+
+void setParallelFillThreshold(std::size_t pixels) noexcept
+{
+    parallelThreshold.store(pixels, std::memory_order_relaxed);
+}
+
+void fillRegion(ImageBuffer& buf, const FillRegion& region)
+{
+    const Pixel color = ImageBuffer::toPixel(region.color.value);
+    region.forEachRun(common::Rect{0, 0, buf.width(), buf.height()},
+                      [&](int x0, int x1, int y)
+                      {
+                          for (int x = x0; x < x1;)
+                          {
+                              const int n = buf.runLength(x, x1 - x);
+                              const auto px = buf.span(x, y, n);
+                              std::fill(px.begin(), px.end(), color);
+                              x += n;
+                          }
+                      });
 }
 
 }  // namespace core
@@ -5,146 +5,272 @@
 #include "core/Compositor.hpp"
 
 #include <algorithm>
-#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "common/Geometry.hpp"
+#include "core/Blend.hpp"
 #include "core/Document.hpp"
 #include "core/ImageBuffer.hpp"
 #include "core/Layer.hpp"
+#include "core/ThreadPool.hpp"
 
-static inline std::uint8_t extractR(std::uint32_t rgba)
+namespace
 {
-    return static_cast<std::uint8_t>((rgba >> 24) & 0xFFu);
-}
+// Hauteur d'une bande de lignes traitée par un worker (les bandes sont indépendantes : chaque
+// ligne de sortie est calculée par exactement le même code, quel que soit le découpage).
+constexpr int kBandRows = 32;
+// Largeur des cellules d'une bande pour le culling opaque (une colonne de tuiles).
+constexpr int kCellColumns = ImageBuffer::kTileSize;
 
-static inline std::uint8_t extractG(std::uint32_t rgba)
-{
-    return static_cast<std::uint8_t>((rgba >> 16) & 0xFFu);
-}
+std::mutex poolMutex;
+unsigned requestedThreads = 0;  // 0 = one per hardware thread
+std::shared_ptr<core::ThreadPool> pool;
 
-static inline std::uint8_t extractB(std::uint32_t rgba)
+unsigned resolveThreadCount(unsigned requested)
 {
-    return static_cast<std::uint8_t>((rgba >> 8) & 0xFFu);
+    if (requested != 0)
+        return requested;
+    return std::max(1u, std::thread::hardware_concurrency());
 }
 
-static inline std::uint8_t extractA(std::uint32_t rgba)
+std::shared_ptr<core::ThreadPool> compositorPool()
 {
-    return static_cast<std::uint8_t>(rgba & 0xFFu);
+    std::lock_guard lock(poolMutex);
+    if (!pool)
+        pool = std::make_shared<core::ThreadPool>(resolveThreadCount(requestedThreads));
+    return pool;
 }
 
-static inline std::uint32_t makePixel(std::uint8_t r, std::uint8_t g, std::uint8_t b,
-                                      std::uint8_t a)
+// Where the workers write: out.pixels() is fetched once by the caller so they never touch the
+// ImageBuffer itself.
+struct OutView
 {
-    return (static_cast<std::uint32_t>(r) << 24) | (static_cast<std::uint32_t>(g) << 16) |
-           (static_cast<std::uint32_t>(b) << 8) | static_cast<std::uint32_t>(a);
-}
+    std::span<ImageBuffer::Pixel> pixels;
+    int width;
+    int docX0;  // document position of out(0, 0)
+    int docY0;
+};
 
-// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
-static std::uint32_t blendPixel(std::uint32_t src, std::uint32_t dst,
-                                float layerOpacity)  // NOLINT(bugprone-easily-swappable-parameters)
+// Whether `layer` only has opaque pixels over docRect (its tiles there are all opaque).
+bool coversOpaque(const Layer& layer, const std::vector<std::uint8_t>& opaqueTiles,
+                  const common::Rect& docRect)
 {
-    const float srcR = static_cast<float>(extractR(src)) / 255.0f;
-    const float srcG = static_cast<float>(extractG(src)) / 255.0f;
-    const float srcB = static_cast<float>(extractB(src)) / 255.0f;
-    const float srcA = static_cast<float>(extractA(src)) / 255.0f;
-
-    const float dstR = static_cast<float>(extractR(dst)) / 255.0f;
-    const float dstG = static_cast<float>(extractG(dst)) / 255.0f;
-    const float dstB = static_cast<float>(extractB(dst)) / 255.0f;
-    const float dstA = static_cast<float>(extractA(dst)) / 255.0f;
+    const ImageBuffer& img = *layer.image();
+    const int x0 = docRect.x - layer.offsetX();
+    const int y0 = docRect.y - layer.offsetY();
+    if (x0 < 0 || y0 < 0 || x0 + docRect.w > img.width() || y0 + docRect.h > img.height())
+        return false;
 
-    // On applique l'opacité du layer sur l'alpha source
-    const float effA = srcA * std::clamp(layerOpacity, 0.0f, 1.0f);
+    const auto cols = static_cast<std::size_t>(img.tileColumns());
+    for (int ty = y0 / ImageBuffer::kTileSize; ty <= (y0 + docRect.h - 1) / ImageBuffer::kTileSize;
+         ++ty)
+        for (int tx = x0 / ImageBuffer::kTileSize;
+             tx <= (x0 + docRect.w - 1) / ImageBuffer::kTileSize; ++tx)
+            if (opaqueTiles[static_cast<std::size_t>(ty) * cols + static_cast<std::size_t>(tx)] ==
+                0)
+                return false;
+    return true;
+}
 
-    // Alpha out (formule "src over dst")
-    const float outA = effA + dstA * (1.0f - effA);
+// Blends layers[first...] into the out cell (out coordinates).
+void composeCell(const std::vector<std::shared_ptr<Layer>>& layers, std::size_t first,
+                 const OutView& out, const common::Rect& cell)
+{
+    for (std::size_t i = first; i < layers.size(); ++i)
+    {
+        const auto& layer = layers[i];
+        const auto& imgPtr = layer->image();
+        const float opacity = layer->opacity();
+        const core::BlendMode mode = layer->blendMode();
+        const int ox = layer->offsetX();
+        const int oy = layer->offsetY();
 
-    if (outA <= 0.0f)
-        return 0u;
+        // Only the part of the layer that overlaps the cell contributes: a transparent source
+        // leaves dst untouched, so pixels outside the layer (or in unallocated transparent
+        // tiles) are skipped instead of being blended with 0.
+        const common::Rect localRoi{out.docX0 + cell.x - ox, out.docY0 + cell.y - oy, cell.w,
+                                    cell.h};
+        const auto blendArea = [&](const common::Rect& r)
+        {
+            for (int ly = r.y; ly < r.y + r.h; ++ly)
+            {
+                const auto outRow =
+                    out.pixels.subspan(static_cast<std::size_t>(ly + oy - out.docY0) *
+                                           static_cast<std::size_t>(out.width),
+                                       static_cast<std::size_t>(out.width));
+                for (int lx = r.x; lx < r.x + r.w;)
+                {
+                    const int n = imgPtr->runLength(lx, r.x + r.w - lx);
+                    const auto sx = static_cast<std::size_t>(lx + ox - out.docX0);
+                    core::blendRow(mode, std::as_const(*imgPtr).span(lx, ly, n),
+                                   outRow.subspan(sx, static_cast<std::size_t>(n)), opacity);
+                    lx += n;
+                }
+            }
+        };
 
-    // RGB out, en "straight alpha"
-    const float outR = (srcR * effA + dstR * dstA * (1.0f - effA)) / outA;
-    const float outG = (srcG * effA + dstG * dstA * (1.0f - effA)) / outA;
-    const float outB = (srcB * effA + dstB * dstA * (1.0f - effA)) / outA;
+        if (imgPtr->isTiled() && (imgPtr->background() & 0xFFu) != 0)
+        {
+            // unallocated tiles are visible too: walk the whole overlap
+            const int x0 = std::max(0, localRoi.x);
+            const int y0 = std::max(0, localRoi.y);
+            const int x1 = std::min(imgPtr->width(), localRoi.x + localRoi.w);
+            const int y1 = std::min(imgPtr->height(), localRoi.y + localRoi.h);
+            if (x0 < x1 && y0 < y1)
+                blendArea(common::Rect{x0, y0, x1 - x0, y1 - y0});
+        }
+        else
+        {
+            imgPtr->forEachAllocatedTile(localRoi, blendArea);
+        }
+    }
+}
 
-    const auto toByte = [](float v) -> std::uint8_t
+// Visible, non transparent layers of `layers` (bottom to top).
+std::vector<std::shared_ptr<Layer>> contributingLayers(
+    const std::vector<std::shared_ptr<Layer>>& layers)
+{
+    std::vector<std::shared_ptr<Layer>> out;
+    out.reserve(layers.size());
+    for (const auto& layer : layers)
     {
-        float clamped = std::clamp(v, 0.0f, 1.0f);
-        return static_cast<std::uint8_t>(std::lround(clamped * 255.0f));
-    };
-
-    return makePixel(toByte(outR), toByte(outG), toByte(outB), toByte(outA));
+        if (!layer || !layer->visible() || !layer->image() || layer->opacity() <= 0.0f)
+            continue;
+        out.push_back(layer);
+    }
+    return out;
 }
+}  // namespace
 
 // ---- Fonction interne : compose une région du doc vers out -----------------
 //
+// layers       : calques contribuant, du bas vers le haut
 // docX0, docY0 : point haut/gauche dans le document
-// roiW, roiH   : taille de la région
-// out          : image de sortie (roiW x roiH)
-// On assume que roi est dans les bornes du document (sinon on peut clamp).
+// maxW, maxH   : partie de la sortie couverte par le document
+// dst          : sortie, entièrement réécrite (fond transparent + calques)
+// La partie hors du document reste transparente. Les lignes sont réparties en bandes sur le
+// pool de threads du compositor, chaque bande en cellules qui commencent au calque opaque le
+// plus haut qui les recouvre (le résultat est identique : un pixel opaque à opacité 1 est
+// copié tel quel).
+// Un ImageBuffer est écrit en place ; pour un framebuffer prémultiplié, chaque bande est
+// composée dans un tampon du worker puis convertie tant qu'elle est encore en cache.
 
-// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
-static void composeRegion(const Document& doc, int docX0, int docY0, int roiW, int roiH,
-                          ImageBuffer& out)  // NOLINT(bugprone-easily-swappable-parameters)
+namespace
 {
-    if (roiW <= 0 || roiH <= 0)
-        return;
-    const int docW = doc.width();
-    const int docH = doc.height();
-    if (docW <= 0 || docH <= 0)
-        return;
-    if (docX0 >= docW || docY0 >= docH)
-        return;
-    const int maxW = std::min(roiW, docW - docX0);
-    const int maxH = std::min(roiH, docH - docY0);
-    if (maxW <= 0 || maxH <= 0)
-        return;
+struct Destination
+{
+    ImageBuffer* buffer{nullptr};
+    const Compositor::PremultipliedTarget* premultiplied{nullptr};
+    int width{0};
+    int height{0};
+};
 
-    const size_t layerCount = doc.layerCount();
-    if (layerCount == 0)
-        return;
+thread_local std::vector<ImageBuffer::Pixel> bandScratch;
 
-    for (size_t i = 0; i < layerCount; ++i)
+// Blends the band (view.docY0 = document row of its first row) cell by cell, each cell
+// starting at the topmost layer hiding it completely.
+void composeBand(const std::vector<std::shared_ptr<Layer>>& layers,
+                 const std::vector<const std::vector<std::uint8_t>*>& opaque, const OutView& view,
+                 int rows, int maxW)
+{
+    for (int cellX = 0; cellX < maxW; cellX += kCellColumns)
     {
-        const auto layer = doc.layerAt(i);
-        if (!layer)
-            continue;
-        if (!layer->visible())
-            continue;
-        const auto& imgPtr = layer->image();
-        if (!imgPtr)
-            continue;
+        const common::Rect cell{cellX, 0, std::min(kCellColumns, maxW - cellX), rows};
+        const common::Rect docCell{view.docX0 + cell.x, view.docY0, cell.w, cell.h};
+        std::size_t first = 0;
+        for (std::size_t i = layers.size(); i-- > 0;)
+        {
+            if (opaque[i] && coversOpaque(*layers[i], *opaque[i], docCell))
+            {
+                first = i;
+                break;
+            }
+        }
+        composeCell(layers, first, view, cell);
+    }
+}
 
-        float opacity = layer->opacity();
-        if (opacity <= 0.0f)
-            continue;
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void composeRegion(const std::vector<std::shared_ptr<Layer>>& layers, int docX0, int docY0,
+                   int maxW, int maxH, const Destination& dst)
+{
+    const int width = dst.width;
+    const std::span<ImageBuffer::Pixel> bufferPixels =
+        dst.buffer ? dst.buffer->pixels() : std::span<ImageBuffer::Pixel>{};
 
-        const int ox = layer->offsetX();
-        const int oy = layer->offsetY();
-        const int imgW = imgPtr->width();
-        const int imgH = imgPtr->height();
+    // Couverture opaque : seuls les calques Normal à opacité 1 remplacent ce qui est dessous.
+    // Les cartes sont (re)calculées ici, avant de lancer les workers qui ne font que les lire.
+    std::vector<const std::vector<std::uint8_t>*> opaque(layers.size(), nullptr);
+    for (std::size_t i = 0; i < layers.size(); ++i)
+        if (layers[i]->opacity() >= 1.0f && layers[i]->blendMode() == core::BlendMode::Normal)
+            opaque[i] = &layers[i]->image()->opaqueTiles();
 
-        for (int sy = 0; sy < maxH; ++sy)
+    const int bandCount = (dst.height + kBandRows - 1) / kBandRows;
+    compositorPool()->parallelFor(
+        bandCount,
+        [&](int band)
         {
-            const int docY = docY0 + sy;
-            for (int sx = 0; sx < maxW; ++sx)
+            const int rowBegin = band * kBandRows;
+            const int rows = std::min(dst.height, rowBegin + kBandRows) - rowBegin;
+            const auto bandSize = static_cast<std::size_t>(rows) * static_cast<std::size_t>(width);
+
+            std::span<ImageBuffer::Pixel> pixels;
+            if (dst.buffer)
             {
-                const int docX = docX0 + sx;
-                const int lx = docX - ox;  // local x in layer image
-                const int ly = docY - oy;  // local y in layer image
+                pixels = bufferPixels.subspan(
+                    static_cast<std::size_t>(rowBegin) * static_cast<std::size_t>(width), bandSize);
+            }
+            else
+            {
+                bandScratch.resize(bandSize);
+                pixels = bandScratch;
+            }
+            std::fill(pixels.begin(), pixels.end(), ImageBuffer::Pixel{0});
 
-                std::uint32_t src = 0u;  // transparent by default
-                if (lx >= 0 && lx < imgW && ly >= 0 && ly < imgH)
-                {
-                    src = imgPtr->getPixel(lx, ly);
-                }
+            if (!layers.empty() && maxW > 0 && rowBegin < maxH)
+                composeBand(layers, opaque, OutView{pixels, width, docX0, docY0 + rowBegin},
+                            std::min(rows, maxH - rowBegin), maxW);
 
-                const std::uint32_t dst = out.getPixel(sx, sy);
-                const std::uint32_t blended = blendPixel(src, dst, opacity);
-                out.setPixel(sx, sy, blended);
+            if (dst.premultiplied)
+            {
+                const auto& target = *dst.premultiplied;
+                const auto w = static_cast<std::size_t>(width);
+                for (int r = 0; r < rows; ++r)
+                    core::premultiplyToArgb32Row(
+                        pixels.subspan(static_cast<std::size_t>(r) * w, w),
+                        target.pixels + static_cast<std::ptrdiff_t>(rowBegin + r) * target.stride);
             }
-        }
-    }
+        });
+}
+
+std::vector<std::shared_ptr<Layer>> documentLayers(const Document& doc)
+{
+    std::vector<std::shared_ptr<Layer>> layers;
+    layers.reserve(doc.layerCount());
+    for (size_t i = 0; i < doc.layerCount(); ++i)
+        layers.push_back(doc.layerAt(i));
+    return contributingLayers(layers);
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void composeDocRegion(const Document& doc, int docX0, int docY0, const Destination& dst)
+{
+    const int maxW = std::min(dst.width, doc.width() - docX0);
+    const int maxH = std::min(dst.height, doc.height() - docY0);
+
+    std::vector<std::shared_ptr<Layer>> layers;
+    if (maxW > 0 && maxH > 0)
+        layers = documentLayers(doc);
+    composeRegion(layers, docX0, docY0, maxW, maxH, dst);
 }
+}  // namespace
 
 void Compositor::compose(const Document& doc, ImageBuffer& out)
 {
@@ -153,8 +279,7 @@ void Compositor::compose(const Document& doc, ImageBuffer& out)
 
     if (out.width() != width || out.height() != height)
         return;
-    out.fill(0u);
-    composeRegion(doc, 0, 0, width, height, out);
+    composeDocRegion(doc, 0, 0, Destination{&out, nullptr, width, height});
 }
 
 void Compositor::composeROI(const Document& doc, int x, int y, int w, int h, ImageBuffer& out)
@@ -164,6 +289,42 @@ void Compositor::composeROI(const Document& doc, int x, int y, int w, int h, Ima
     if (out.width() != w || out.height() != h)
         return;
 
-    out.fill(0u);
-    composeRegion(doc, x, y, w, h, out);
-}
\ No newline at end of file
+    composeDocRegion(doc, x, y, Destination{&out, nullptr, w, h});
+}
+
+void Compositor::composeLayers(const std::vector<std::shared_ptr<Layer>>& layers, int x, int y,
+                               ImageBuffer& out)
+{
+    composeRegion(contributingLayers(layers), x, y, out.width(), out.height(),
+                  Destination{&out, nullptr, out.width(), out.height()});
+}
+
+void Compositor::composeInto(const Document& doc, int x, int y, const PremultipliedTarget& target)
+{
+    if (!target.pixels || target.width <= 0 || target.height <= 0)
+        return;
+    composeDocRegion(doc, x, y, Destination{nullptr, &target, target.width, target.height});
+}
+
+void Compositor::composeLayersInto(const std::vector<std::shared_ptr<Layer>>& layers, int x,
+                                   int y, const PremultipliedTarget& target)
+{
+    if (!target.pixels || target.width <= 0 || target.height <= 0)
+        return;
+    composeRegion(contributingLayers(layers), x, y, target.width, target.height,
+                  Destination{nullptr, &target, target.width, target.height});
+}
+
+void Compositor::setThreadCount(unsigned count)
+{
+    std::lock_guard lock(poolMutex);
+    requestedThreads = count;
+    // compositions already running keep their own reference on the old pool
+    pool.reset();
+}
+
+unsigned Compositor::threadCount()
+{
+    std::lock_guard lock(poolMutex);
+    return resolveThreadCount(requestedThreads);
+}
@@ -5,11 +5,12 @@
 #include "core/Document.hpp"
 
 #include <algorithm>
-#include <cmath>
 #include <cstddef>
 #include <memory>
 #include <stdexcept>
+#include <utility>
 
+#include "core/Blend.hpp"
 #include "core/ImageBuffer.hpp"
 #include "core/Layer.hpp"
 
@@ -144,60 +145,23 @@ void Document::mergeDown(const std::size_t from)
         // Only blend if there's an overlap
         if (minX < maxX && minY < maxY)
         {
-            // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
-            auto blendPixel = [](std::uint32_t src, std::uint32_t dst,
-                                 float layerOpacity)
-                -> std::uint32_t  // NOLINT(bugprone-easily-swappable-parameters)
-            {
-                auto extract = [](std::uint32_t px, int shift) -> std::uint8_t
-                { return static_cast<std::uint8_t>((px >> shift) & 0xFFu); };
-                const float srcR = static_cast<float>(extract(src, 24)) / 255.0f;
-                const float srcG = static_cast<float>(extract(src, 16)) / 255.0f;
-                const float srcB = static_cast<float>(extract(src, 8)) / 255.0f;
-                const float srcA = static_cast<float>(extract(src, 0)) / 255.0f;
-
-                const float dstR = static_cast<float>(extract(dst, 24)) / 255.0f;
-                const float dstG = static_cast<float>(extract(dst, 16)) / 255.0f;
-                const float dstB = static_cast<float>(extract(dst, 8)) / 255.0f;
-                const float dstA = static_cast<float>(extract(dst, 0)) / 255.0f;
-
-                const float effA = srcA * std::clamp(layerOpacity, 0.0f, 1.0f);
-                const float outA = effA + dstA * (1.0f - effA);
-                if (outA <= 0.0f)
-                    return 0u;
-
-                const float outR = (srcR * effA + dstR * dstA * (1.0f - effA)) / outA;
-                const float outG = (srcG * effA + dstG * dstA * (1.0f - effA)) / outA;
-                const float outB = (srcB * effA + dstB * dstA * (1.0f - effA)) / outA;
-
-                auto toByte = [](float v) -> std::uint8_t
-                {
-                    float clamped = std::clamp(v, 0.0f, 1.0f);
-                    return static_cast<std::uint8_t>(std::lround(clamped * 255.0f));
-                };
-
-                return (static_cast<std::uint32_t>(toByte(outR)) << 24) |
-                       (static_cast<std::uint32_t>(toByte(outG)) << 16) |
-                       (static_cast<std::uint32_t>(toByte(outB)) << 8) |
-                       static_cast<std::uint32_t>(toByte(outA));
-            };
-
             const float opacity = srcLayer->opacity();
-            // Iterate over the intersection in document coordinates
+            // Iterate over the intersection row by row, one contiguous run at a time
             for (int docY = minY; docY < maxY; ++docY)
             {
-                for (int docX = minX; docX < maxX; ++docX)
+                const int srcY = docY - srcOffsetY;
+                const int dstY = docY - dstOffsetY;
+                for (int docX = minX; docX < maxX;)
                 {
-                    // Convert document coordinates to layer-local coordinates
                     const int srcX = docX - srcOffsetX;
-                    const int srcY = docY - srcOffsetY;
                     const int dstX = docX - dstOffsetX;
-                    const int dstY = docY - dstOffsetY;
+                    const int n = std::min(srcImg->runLength(srcX, maxX - docX),
+                                           dstImg->runLength(dstX, maxX - docX));
 
-                    const std::uint32_t s = srcImg->getPixel(srcX, srcY);
-                    const std::uint32_t d = dstImg->getPixel(dstX, dstY);
-                    const std::uint32_t blended = blendPixel(s, d, opacity);
-                    dstImg->setPixel(dstX, dstY, blended);
+                    core::blendRow(srcLayer->blendMode(),
+                                   std::as_const(*srcImg).span(srcX, srcY, n),
+                                   dstImg->span(dstX, dstY, n), opacity);
+                    docX += n;
                 }
             }
         }
@@ -4,13 +4,45 @@
 
 #include "core/ImageBuffer.hpp"
 
+#include <atomic>
+
 #include <common/Colors.hpp>
 
-ImageBuffer::ImageBuffer(const int width, const int height) : width_(width), height_(height)
+namespace
+{
+constexpr ImageBuffer::Pixel kAlphaPixel = ImageBuffer::toPixel(0x000000FFu);
+constexpr std::size_t kTilePixels = static_cast<std::size_t>(ImageBuffer::kTileSize) *
+                                    static_cast<std::size_t>(ImageBuffer::kTileSize);
+
+std::size_t tileOffset(int x, int y)
+{
+    return static_cast<std::size_t>(y % ImageBuffer::kTileSize) *
+               static_cast<std::size_t>(ImageBuffer::kTileSize) +
+           static_cast<std::size_t>(x % ImageBuffer::kTileSize);
+}
+}  // namespace
+
+std::uint64_t ImageBuffer::InstanceId::next() noexcept
+{
+    static std::atomic<std::uint64_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+ImageBuffer::ImageBuffer(const int width, const int height, const Storage storage)
+    : width_(width), height_(height), storage_(storage)
 {
     assert(width_ > 0 && height_ > 0);
     stride_ = width_ * 4;
-    rgbaPixels_.resize(static_cast<std::size_t>(height_) * static_cast<std::size_t>(stride_));
+    if (storage_ == Storage::Tiled)
+    {
+        tileCols_ = (width_ + kTileSize - 1) / kTileSize;
+        tileRows_ = (height_ + kTileSize - 1) / kTileSize;
+        tiles_.resize(static_cast<std::size_t>(tileCols_) * static_cast<std::size_t>(tileRows_));
+    }
+    else
+    {
+        pixels_.resize(static_cast<std::size_t>(height_) * static_cast<std::size_t>(width_));
+    }
     fill(common::colors::Transparent);
 }
 
@@ -29,61 +61,196 @@ int ImageBuffer::strideBytes() const noexcept
     return stride_;
 }
 
+ImageBuffer::Storage ImageBuffer::storage() const noexcept
+{
+    return storage_;
+}
+
+bool ImageBuffer::isTiled() const noexcept
+{
+    return storage_ == Storage::Tiled;
+}
+
 uint8_t* ImageBuffer::data() noexcept
 {
-    return rgbaPixels_.data();
+    ++revision_;
+    return isTiled() ? nullptr : reinterpret_cast<uint8_t*>(pixels_.data());
 }
 const uint8_t* ImageBuffer::data() const noexcept
 {
-    return rgbaPixels_.data();
+    return isTiled() ? nullptr : reinterpret_cast<const uint8_t*>(pixels_.data());
 }
 
 void ImageBuffer::fill(uint32_t rgba)
 {
-    const auto r = static_cast<uint8_t>((rgba >> 24) & 0xFF);
-    const auto g = static_cast<uint8_t>((rgba >> 16) & 0xFF);
-    const auto b = static_cast<uint8_t>((rgba >> 8) & 0xFF);
-    const auto a = static_cast<uint8_t>(rgba & 0xFF);
+    ++revision_;
+    background_ = rgba;
+    if (isTiled())
+    {
+        // every tile now reads as the background: drop the storage
+        for (auto& tile : tiles_)
+            std::vector<Pixel>().swap(tile);
+        blankRow_.assign(kTileSize, toPixel(rgba));
+        return;
+    }
+
+    std::fill(pixels_.begin(), pixels_.end(), toPixel(rgba));
+}
 
-    for (int y = 0; y < height_; ++y)
+void ImageBuffer::setPixelRaw(const int x, const int y, const Pixel px)
+{
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+    ++revision_;
+    if (isTiled())
     {
-        for (int x = 0; x < width_; ++x)
+        const int tx = x / kTileSize;
+        const int ty = y / kTileSize;
+        if (!isTileAllocated(tx, ty) && px == toPixel(background_))
+            return;
+        tileForWrite(tx, ty)[tileOffset(x, y)] = px;
+        return;
+    }
+
+    pixels_[static_cast<std::size_t>(y) * static_cast<std::size_t>(width_) +
+            static_cast<std::size_t>(x)] = px;
+}
+
+std::span<ImageBuffer::Pixel> ImageBuffer::span(const int x, const int y, const int count)
+{
+    assert(x >= 0 && y >= 0 && y < height_ && count >= 0 && count <= runLength(x, count));
+    ++revision_;
+    if (!isTiled())
+        return row(y).subspan(static_cast<std::size_t>(x), static_cast<std::size_t>(count));
+    auto& tile = tileForWrite(x / kTileSize, y / kTileSize);
+    return {tile.data() + tileOffset(x, y), static_cast<std::size_t>(count)};
+}
+
+std::span<const ImageBuffer::Pixel> ImageBuffer::span(const int x, const int y,
+                                                      const int count) const
+{
+    assert(x >= 0 && y >= 0 && y < height_ && count >= 0 && count <= runLength(x, count));
+    if (!isTiled())
+        return row(y).subspan(static_cast<std::size_t>(x), static_cast<std::size_t>(count));
+    const auto& tile =
+        tiles_[static_cast<std::size_t>(y / kTileSize) * static_cast<std::size_t>(tileCols_) +
+               static_cast<std::size_t>(x / kTileSize)];
+    if (tile.empty())
+        return {blankRow_.data(), static_cast<std::size_t>(count)};
+    return {tile.data() + tileOffset(x, y), static_cast<std::size_t>(count)};
+}
+
+int ImageBuffer::tileColumns() const noexcept
+{
+    return isTiled() ? tileCols_ : (width_ + kTileSize - 1) / kTileSize;
+}
+
+int ImageBuffer::tileRows() const noexcept
+{
+    return isTiled() ? tileRows_ : (height_ + kTileSize - 1) / kTileSize;
+}
+
+common::Rect ImageBuffer::tileRect(int tx, int ty) const noexcept
+{
+    const int x0 = tx * kTileSize;
+    const int y0 = ty * kTileSize;
+    return common::Rect{x0, y0, std::min(kTileSize, width_ - x0),
+                        std::min(kTileSize, height_ - y0)};
+}
+
+bool ImageBuffer::isTileAllocated(int tx, int ty) const noexcept
+{
+    if (tx < 0 || ty < 0 || tx >= tileColumns() || ty >= tileRows())
+        return false;
+    if (!isTiled())
+        return true;
+    return !tiles_[static_cast<std::size_t>(ty) * static_cast<std::size_t>(tileCols_) +
+                   static_cast<std::size_t>(tx)]
+                .empty();
+}
+
+std::size_t ImageBuffer::allocatedTileCount() const noexcept
+{
+    if (!isTiled())
+        return static_cast<std::size_t>(tileColumns()) * static_cast<std::size_t>(tileRows());
+    return static_cast<std::size_t>(
+        std::count_if(tiles_.begin(), tiles_.end(), [](const auto& t) { return !t.empty(); }));
+}
+
+uint32_t ImageBuffer::background() const noexcept
+{
+    return background_;
+}
+
+const std::vector<std::uint8_t>& ImageBuffer::opaqueTiles() const
+{
+    if (opaqueTilesRevision_ == revision_)
+        return opaqueTiles_;
+
+    const int cols = tileColumns();
+    const int rows = tileRows();
+    opaqueTiles_.assign(static_cast<std::size_t>(cols) * static_cast<std::size_t>(rows), 0);
+    for (int ty = 0; ty < rows; ++ty)
+    {
+        for (int tx = 0; tx < cols; ++tx)
         {
-            const int offset = y * stride_ + x * 4;
-            rgbaPixels_[offset + 0] = r;
-            rgbaPixels_[offset + 1] = g;
-            rgbaPixels_[offset + 2] = b;
-            rgbaPixels_[offset + 3] = a;
+            bool opaque = true;
+            if (isTiled() && !isTileAllocated(tx, ty))
+            {
+                opaque = (background_ & 0xFFu) == 0xFFu;
+            }
+            else
+            {
+                const common::Rect r = tileRect(tx, ty);
+                for (int y = r.y; opaque && y < r.y + r.h; ++y)
+                    for (const Pixel px : span(r.x, y, r.w))
+                        if ((px & kAlphaPixel) != kAlphaPixel)
+                        {
+                            opaque = false;
+                            break;
+                        }
+            }
+            opaqueTiles_[static_cast<std::size_t>(ty) * static_cast<std::size_t>(cols) +
+                         static_cast<std::size_t>(tx)] = opaque ? 1 : 0;
         }
     }
+    opaqueTilesRevision_ = revision_;
+    return opaqueTiles_;
 }
 
-uint32_t ImageBuffer::getPixel(const int x, const int y) const
+ImageBuffer ImageBuffer::toLinear() const
 {
-    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
-    const int offset = y * stride_ + x * 4;
+    if (!isTiled())
+        return *this;
 
-    const uint8_t r = rgbaPixels_[offset + 0];
-    const uint8_t g = rgbaPixels_[offset + 1];
-    const uint8_t b = rgbaPixels_[offset + 2];
-    const uint8_t a = rgbaPixels_[offset + 3];
+    ImageBuffer out(width_, height_);
+    out.fill(background_);
+    forEachAllocatedTile(common::Rect{0, 0, width_, height_},
+                         [&](const common::Rect& r)
+                         {
+                             for (int y = r.y; y < r.y + r.h; ++y)
+                             {
+                                 const auto src = span(r.x, y, r.w);
+                                 std::copy(src.begin(), src.end(), out.row(y).begin() + r.x);
+                             }
+                         });
+    return out;
+}
 
-    return (static_cast<uint32_t>(r) << 24) | (static_cast<uint32_t>(g) << 16) |
-           (static_cast<uint32_t>(b) << 8) | static_cast<uint32_t>(a);
+ImageBuffer::Pixel ImageBuffer::tiledPixel(const int x, const int y) const
+{
+    const auto& tile =
+        tiles_[static_cast<std::size_t>(y / kTileSize) * static_cast<std::size_t>(tileCols_) +
+               static_cast<std::size_t>(x / kTileSize)];
+    if (tile.empty())
+        return toPixel(background_);
+    return tile[tileOffset(x, y)];
 }
 
-void ImageBuffer::setPixel(const int x, const int y, const uint32_t rgba)
+std::vector<ImageBuffer::Pixel>& ImageBuffer::tileForWrite(int tx, int ty)
 {
-    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
-    const int offset = y * stride_ + x * 4;
-
-    const auto r = static_cast<uint8_t>((rgba >> 24) & 0xFF);
-    const auto g = static_cast<uint8_t>((rgba >> 16) & 0xFF);
-    const auto b = static_cast<uint8_t>((rgba >> 8) & 0xFF);
-    const auto a = static_cast<uint8_t>(rgba & 0xFF);
-
-    rgbaPixels_[offset + 0] = r;
-    rgbaPixels_[offset + 1] = g;
-    rgbaPixels_[offset + 2] = b;
-    rgbaPixels_[offset + 3] = a;
-}
\ No newline at end of file
+    auto& tile = tiles_[static_cast<std::size_t>(ty) * static_cast<std::size_t>(tileCols_) +
+                        static_cast<std::size_t>(tx)];
+    if (tile.empty())
+        tile.assign(kTilePixels, toPixel(background_));
+    return tile;
+}
@@ -69,6 +69,15 @@ void Layer::setOpacity(const float opacity)
         opacity_ = opacity;
 }
 
+core::BlendMode Layer::blendMode() const noexcept
+{
+    return blendMode_;
+}
+void Layer::setBlendMode(const core::BlendMode mode)
+{
+    blendMode_ = mode;
+}
+
 const std::shared_ptr<ImageBuffer>& Layer::image() const noexcept
 {
     return image_;
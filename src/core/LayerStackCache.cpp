@@ -0,0 +1,190 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include "core/LayerStackCache.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "core/Compositor.hpp"
+#include "core/Document.hpp"
+#include "core/ImageBuffer.hpp"
+#include "core/Layer.hpp"
+
+namespace
+{
+bool contributes(const Layer& layer)
+{
+    return layer.visible() && layer.image() && layer.opacity() > 0.0f;
+}
+
+// Composite of doc layers [first, last) at document size, nullptr when none of them shows.
+std::shared_ptr<Layer> flatten(const Document& doc, std::size_t first, std::size_t last)
+{
+    std::vector<std::shared_ptr<Layer>> layers;
+    for (std::size_t i = first; i < last; ++i)
+    {
+        auto layer = doc.layerAt(i);
+        if (layer && contributes(*layer))
+            layers.push_back(std::move(layer));
+    }
+    if (layers.empty())
+        return nullptr;
+
+    auto img = std::make_shared<ImageBuffer>(doc.width(), doc.height());
+    Compositor::composeLayers(layers, 0, 0, *img);
+    return std::make_shared<Layer>(0, "", std::move(img));
+}
+}  // namespace
+
+LayerStackCache::LayerStackCache() = default;
+LayerStackCache::~LayerStackCache() = default;
+
+LayerStackCache::StackKey LayerStackCache::stackKey(const Document& doc, std::size_t active)
+{
+    StackKey key;
+    key.width = doc.width();
+    key.height = doc.height();
+    key.active = active;
+    key.layers.reserve(doc.layerCount());
+    for (std::size_t i = 0; i < doc.layerCount(); ++i)
+    {
+        const auto layer = doc.layerAt(i);
+        LayerKey k;
+        k.layer = layer.get();
+        if (layer && i != active)
+        {
+            k.visible = layer->visible();
+            k.opacity = layer->opacity();
+            k.blendMode = layer->blendMode();
+            k.offsetX = layer->offsetX();
+            k.offsetY = layer->offsetY();
+            if (layer->image())
+            {
+                k.imageId = layer->image()->id();
+                k.imageRevision = layer->image()->revision();
+            }
+        }
+        key.layers.push_back(k);
+    }
+    return key;
+}
+
+void LayerStackCache::build(const Document& doc, std::size_t active)
+{
+    key_ = stackKey(doc, active);
+    below_ = flatten(doc, 0, std::min(active, doc.layerCount()));
+    above_ = flatten(doc, active + 1, doc.layerCount());
+    aboveIsExact_ = true;
+    for (std::size_t i = active + 1; i < doc.layerCount(); ++i)
+    {
+        const auto layer = doc.layerAt(i);
+        if (layer && contributes(*layer) && layer->blendMode() != core::BlendMode::Normal)
+            aboveIsExact_ = false;
+    }
+    built_ = true;
+    candidate_ = StackKey{};
+}
+
+bool LayerStackCache::isValid(const Document& doc, std::size_t active) const
+{
+    return built_ && active < doc.layerCount() && key_ == stackKey(doc, active);
+}
+
+bool LayerStackCache::prepare(const Document& doc, std::size_t active)
+{
+    if (active >= doc.layerCount())
+        return false;
+
+    StackKey key = stackKey(doc, active);
+    if (built_ && key == key_)
+        return true;
+    if (key == candidate_)
+    {
+        build(doc, active);
+        return true;
+    }
+    candidate_ = std::move(key);
+    return false;
+}
+
+void LayerStackCache::clear() noexcept
+{
+    key_ = StackKey{};
+    candidate_ = StackKey{};
+    built_ = false;
+    aboveIsExact_ = true;
+    below_.reset();
+    above_.reset();
+}
+
+const ImageBuffer* LayerStackCache::below() const noexcept
+{
+    return below_ ? below_->image().get() : nullptr;
+}
+
+const ImageBuffer* LayerStackCache::above() const noexcept
+{
+    return above_ ? above_->image().get() : nullptr;
+}
+
+bool LayerStackCache::aboveIsExact() const noexcept
+{
+    return aboveIsExact_;
+}
+
+std::vector<std::shared_ptr<Layer>> LayerStackCache::stackLayers(
+    const Document& doc, std::optional<common::Point> activeOffset) const
+{
+    std::vector<std::shared_ptr<Layer>> layers;
+    layers.reserve(3);
+    if (below_)
+        layers.push_back(below_);
+    if (key_.active < doc.layerCount())
+    {
+        auto active = doc.layerAt(key_.active);
+        if (active && activeOffset)
+        {
+            // same pixels and settings, elsewhere; the document layer is left alone
+            auto moved = std::make_shared<Layer>(active->id(), active->name(), active->image(),
+                                                 active->visible(), active->locked(),
+                                                 active->opacity());
+            moved->setBlendMode(active->blendMode());
+            moved->setOffset(activeOffset->x, activeOffset->y);
+            active = std::move(moved);
+        }
+        layers.push_back(std::move(active));
+    }
+    if (aboveIsExact_)
+    {
+        if (above_)
+            layers.push_back(above_);
+    }
+    else
+    {
+        for (std::size_t i = key_.active + 1; i < doc.layerCount(); ++i)
+            layers.push_back(doc.layerAt(i));
+    }
+    return layers;
+}
+
+void LayerStackCache::composeROI(const Document& doc, int x, int y, int w, int h,
+                                 ImageBuffer& out) const
+{
+    if (w <= 0 || h <= 0 || out.width() != w || out.height() != h)
+        return;
+    Compositor::composeLayers(stackLayers(doc), x, y, out);
+}
+
+void LayerStackCache::composeInto(const Document& doc, int x, int y,
+                                  const Compositor::PremultipliedTarget& target) const
+{
+    Compositor::composeLayersInto(stackLayers(doc), x, y, target);
+}
+
+void LayerStackCache::composeMovedInto(const Document& doc, common::Point activeOffset, int x,
+                                       int y, const Compositor::PremultipliedTarget& target) const
+{
+    Compositor::composeLayersInto(stackLayers(doc, activeOffset), x, y, target);
+}
@@ -7,100 +7,80 @@
 
 #include "core/Selection.hpp"
 
-#include <algorithm>
-#include <cassert>
 #include <cstdint>
+#include <memory>
 #include <optional>
 
-#include "core/ImageBuffer.hpp"
+#include "core/AlphaMask.hpp"
 
 uint8_t Selection::t_at(const int x, const int y) const
 {
-    if (!hasMask())
+    if (!spans_)
         return 0u;
-
-    if (x < 0 || y < 0 || x >= mask_->width() || y >= mask_->height())
-        return 0u;
-
-    const uint32_t px = mask_->getPixel(x, y);
-    return static_cast<uint8_t>(px & 0xFF);
+    return spans_->at(x, y);
 }
 
-void Selection::addRect(const Selection::Rect& rect, const std::shared_ptr<ImageBuffer>& reference)
+void Selection::addRect(const Selection::Rect& rect, const int maskWidth, const int maskHeight)
 {
-    if (!mask_)
+    if (!spans_)
     {
-        if (!reference)
+        if (maskWidth <= 0 || maskHeight <= 0)
             return;
-        mask_ = std::make_shared<ImageBuffer>(reference->width(), reference->height());
-        mask_->fill(0x00000000u);
-    }
-
-    const int x = rect.x;
-    const int y = rect.y;
-    const int x0 = std::max(0, x);
-    const int y0 = std::max(0, y);
-    const int x1 = std::min(mask_->width(), x + rect.w);
-    const int y1 = std::min(mask_->height(), y + rect.h);
-
-    for (int yy = y0; yy < y1; ++yy)
-    {
-        for (int xx = x0; xx < x1; ++xx)
-        {
-            mask_->setPixel(xx, yy, 0x000000FFu);
-        }
+        spans_.emplace(maskWidth, maskHeight);
     }
+    spans_->addRect(rect);
+    mask_.reset();
 }
 
 void Selection::subtractRect(const Selection::Rect& rect)
 {
-    if (!mask_)
+    if (!spans_)
         return;
+    spans_->subtractRect(rect);
+    mask_.reset();
+}
+
+void Selection::intersectRect(const Selection::Rect& rect)
+{
+    if (!spans_)
+        return;
+    spans_->intersectRect(rect);
+    mask_.reset();
+}
 
-    const int x = rect.x;
-    const int y = rect.y;
-    const int x0 = std::max(0, x);
-    const int y0 = std::max(0, y);
-    const int x1 = std::min(mask_->width(), x + rect.w);
-    const int y1 = std::min(mask_->height(), y + rect.h);
+void Selection::invert()
+{
+    if (!spans_)
+        return;
+    spans_->invert();
+    mask_.reset();
+}
 
-    for (int yy = y0; yy < y1; ++yy)
+void Selection::setMask(std::shared_ptr<AlphaMask> mask)
+{
+    if (!mask)
     {
-        for (int xx = x0; xx < x1; ++xx)
-        {
-            mask_->setPixel(xx, yy, 0x00000000u);
-        }
+        clear();
+        return;
     }
+    // The caller keeps its mask: the cache is rebuilt from the spans, never shared with it.
+    spans_ = SpanMask::fromMask(*mask);
+    mask_.reset();
 }
 
-std::optional<Selection::Rect> Selection::boundingRect() const
+const std::shared_ptr<AlphaMask>& Selection::mask() const
 {
-    if (!mask_)
-        return std::nullopt;
-
-    const int w = mask_->width();
-    const int h = mask_->height();
-
-    int minX = w, minY = h;
-    int maxX = -1, maxY = -1;
-
-    for (int y = 0; y < h; ++y)
+    if (spans_ && !mask_)
     {
-        for (int x = 0; x < w; ++x)
-        {
-            if (t_at(x, y) != 0)
-            {
-                minX = std::min(minX, x);
-                minY = std::min(minY, y);
-                maxX = std::max(maxX, x);
-                maxY = std::max(maxY, y);
-            }
-        }
+        mask_ = std::make_shared<AlphaMask>(spans_->width(), spans_->height());
+        spans_->rasterize(*mask_);
     }
+    return mask_;
+}
 
-    if (maxX < minX || maxY < minY)
+std::optional<Selection::Rect> Selection::boundingRect() const
+{
+    if (!spans_)
         return std::nullopt;
-
-    // Rect: x,y,w,h  (w/h inclusifs -> +1)
-    return Rect{minX, minY, (maxX - minX + 1), (maxY - minY + 1)};
+    return spans_->bounds();
 }
@@ -0,0 +1,186 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include "core/SpanMask.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#include "core/AlphaMask.hpp"
+
+SpanMask::SpanMask(const int width, const int height)
+    : width_(std::max(0, width)), rows_(static_cast<std::size_t>(std::max(0, height)))
+{
+}
+
+SpanMask SpanMask::fromMask(const AlphaMask& mask)
+{
+    SpanMask spans(mask.width(), mask.height());
+    for (int y = 0; y < mask.height(); ++y)
+    {
+        auto& row = spans.rows_[static_cast<std::size_t>(y)];
+        int x = 0;
+        while (x < mask.width())
+        {
+            const std::uint8_t c = mask.at(x, y);
+            int end = x + 1;
+            while (end < mask.width() && mask.at(end, y) == c)
+                ++end;
+            if (c != 0)
+                row.push_back({x, end, c});
+            x = end;
+        }
+    }
+    spans.bounds_ = mask.bounds();
+    return spans;
+}
+
+std::uint8_t SpanMask::at(const int x, const int y) const noexcept
+{
+    if (x < 0 || y < 0 || x >= width_ || y >= height())
+        return 0;
+    const auto spans = row(y);
+    // first span ending past x
+    const auto it = std::upper_bound(spans.begin(), spans.end(), x,
+                                     [](int px, const Span& s) { return px < s.x1; });
+    return it != spans.end() && it->x0 <= x ? it->coverage : 0;
+}
+
+bool SpanMask::empty() const noexcept
+{
+    return !bounds_.has_value();
+}
+
+void SpanMask::remeasureBounds()
+{
+    if (!bounds_)
+        return;
+    int minX = width_;
+    int minY = height();
+    int maxX = 0;
+    int maxY = 0;
+    for (int y = bounds_->y; y < bounds_->y + bounds_->h; ++y)
+    {
+        const auto spans = row(y);
+        if (spans.empty())
+            continue;
+        minX = std::min(minX, spans.front().x0);
+        maxX = std::max(maxX, spans.back().x1);
+        minY = std::min(minY, y);
+        maxY = y + 1;
+    }
+    if (maxX <= minX || maxY <= minY)
+        bounds_.reset();
+    else
+        bounds_ = common::Rect{minX, minY, maxX - minX, maxY - minY};
+}
+
+template <typename F>
+void SpanMask::applyRow(const int y, int x0, int x1, F&& f)
+{
+    auto& spans = rows_[static_cast<std::size_t>(y)];
+    std::vector<Span> out;
+    out.reserve(spans.size() + 2);
+    const auto push = [&](int a, int b, std::uint8_t c)
+    {
+        if (a >= b || c == 0)
+            return;
+        if (!out.empty() && out.back().x1 == a && out.back().coverage == c)
+            out.back().x1 = b;
+        else
+            out.push_back({a, b, c});
+    };
+
+    int x = x0;  // next pixel of [x0, x1) not emitted yet
+    for (const Span& s : spans)
+    {
+        if (s.x1 <= x0 || s.x0 >= x1)
+        {
+            if (s.x0 >= x1 && x < x1)
+            {
+                push(x, x1, f(std::uint8_t{0}));
+                x = x1;
+            }
+            push(s.x0, s.x1, s.coverage);
+            continue;
+        }
+        // the span overlaps [x0, x1): its outer parts keep their coverage
+        push(s.x0, x0, s.coverage);
+        push(x, s.x0, f(std::uint8_t{0}));
+        push(std::max(s.x0, x0), std::min(s.x1, x1), f(s.coverage));
+        x = std::min(s.x1, x1);
+        push(x1, s.x1, s.coverage);
+    }
+    push(x, x1, f(std::uint8_t{0}));
+    spans = std::move(out);
+}
+
+void SpanMask::addRect(const common::Rect& rect, const std::uint8_t coverage)
+{
+    const common::Rect r = common::intersect(rect, common::Rect{0, 0, width_, height()});
+    if (common::isEmpty(r) || coverage == 0)
+        return;
+    for (int y = r.y; y < r.y + r.h; ++y)
+        applyRow(y, r.x, r.x + r.w,
+                 [coverage](std::uint8_t c) { return std::max(c, coverage); });
+    bounds_ = bounds_ ? common::unite(*bounds_, r) : r;
+}
+
+void SpanMask::subtractRect(const common::Rect& rect)
+{
+    const common::Rect r = common::intersect(rect, common::Rect{0, 0, width_, height()});
+    const common::Rect hit = bounds_ ? common::intersect(r, *bounds_) : common::Rect{};
+    if (common::isEmpty(hit))
+        return;
+    for (int y = hit.y; y < hit.y + hit.h; ++y)
+        applyRow(y, hit.x, hit.x + hit.w, [](std::uint8_t) { return std::uint8_t{0}; });
+
+    // a hole strictly inside the bounds leaves every edge in place
+    const common::Rect& b = *bounds_;
+    if (r.x > b.x && r.y > b.y && r.x + r.w < b.x + b.w && r.y + r.h < b.y + b.h)
+        return;
+    remeasureBounds();
+}
+
+void SpanMask::intersectRect(const common::Rect& rect)
+{
+    if (!bounds_)
+        return;
+    const common::Rect r = common::intersect(rect, common::Rect{0, 0, width_, height()});
+    for (int y = bounds_->y; y < bounds_->y + bounds_->h; ++y)
+    {
+        auto& spans = rows_[static_cast<std::size_t>(y)];
+        if (y < r.y || y >= r.y + r.h)
+        {
+            spans.clear();
+            continue;
+        }
+        std::erase_if(spans, [&](const Span& s) { return s.x1 <= r.x || s.x0 >= r.x + r.w; });
+        if (!spans.empty())
+        {
+            spans.front().x0 = std::max(spans.front().x0, r.x);
+            spans.back().x1 = std::min(spans.back().x1, r.x + r.w);
+        }
+    }
+    remeasureBounds();
+}
+
+void SpanMask::invert()
+{
+    for (int y = 0; y < height(); ++y)
+        applyRow(y, 0, width_,
+                 [](std::uint8_t c) { return static_cast<std::uint8_t>(0xFFu - c); });
+    bounds_ = common::Rect{0, 0, width_, height()};
+    remeasureBounds();
+}
+
+void SpanMask::rasterize(AlphaMask& out) const
+{
+    assert(out.width() == width_ && out.height() == height());
+    out.fill(0);
+    for (int y = 0; y < height(); ++y)
+        for (const Span& s : row(y))
+            out.fillRect(common::Rect{s.x0, y, s.x1 - s.x0, 1}, s.coverage);
+}
@@ -0,0 +1,114 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include "core/ThreadPool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace core
+{
+ThreadPool::ThreadPool(const unsigned threadCount)
+{
+    const unsigned workers = std::max(1u, threadCount) - 1;
+    workers_.reserve(workers);
+    for (unsigned i = 0; i < workers; ++i)
+        workers_.emplace_back([this] { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+unsigned ThreadPool::size() const noexcept
+{
+    return static_cast<unsigned>(workers_.size()) + 1;
+}
+
+void ThreadPool::parallelFor(const int count, const std::function<void(int)>& fn)
+{
+    if (count <= 0)
+        return;
+    if (workers_.empty() || count == 1)
+    {
+        for (int i = 0; i < count; ++i)
+            fn(i);
+        return;
+    }
+
+    std::lock_guard call(callMutex_);
+    {
+        std::lock_guard lock(mutex_);
+        fn_ = &fn;
+        count_ = count;
+        next_ = 0;
+        pending_ = count;
+        error_ = nullptr;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    runTasks();
+
+    std::exception_ptr error;
+    {
+        std::unique_lock lock(mutex_);
+        done_.wait(lock, [this] { return pending_ == 0; });
+        fn_ = nullptr;
+        count_ = 0;
+        next_ = 0;
+        error = std::exchange(error_, nullptr);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void ThreadPool::workerLoop()
+{
+    std::size_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+        }
+        runTasks();
+    }
+}
+
+void ThreadPool::runTasks()
+{
+    std::unique_lock lock(mutex_);
+    while (next_ < count_)
+    {
+        const int index = next_++;
+        const auto* fn = fn_;
+        lock.unlock();
+        try
+        {
+            (*fn)(index);
+        }
+        catch (...)
+        {
+            lock.lock();
+            if (!error_)
+                error_ = std::current_exception();
+            lock.unlock();
+        }
+        lock.lock();
+        if (--pending_ == 0)
+            done_.notify_one();
+    }
+}
+}  // namespace core
@@ -2,9 +2,13 @@
 #include <stb_image_write.h>
 #include <zip.h>
 
+#include <algorithm>
+#include <optional>
 #include <string>
 
+#include "core/Compositor.hpp"
 #include "core/Document.hpp"
+#include "core/ImageBuffer.hpp"
 #include "core/Layer.hpp"
 #include "io/EpgFormat.hpp"
 #include "io/EpgJson.hpp"
@@ -17,6 +21,57 @@
 using json = nlohmann::json;
 using namespace io::epg;
 
+// The encoders and raw loops below need contiguous pixels: sparse (tiled) layers are
+// flattened into `scratch` first.
+static const ImageBuffer& linearPixels(const ImageBuffer& img,
+                                      std::optional<ImageBuffer>& scratch)
+{
+    if (!img.isTiled())
+        return img;
+    scratch = img.toLinear();
+    return *scratch;
+}
+
+// Manifest <-> Layer blend modes; modes unknown to the compositor load as Normal.
+static BlendMode toManifestBlendMode(const core::BlendMode mode)
+{
+    switch (mode)
+    {
+        case core::BlendMode::Multiply:
+            return BlendMode::Multiply;
+        case core::BlendMode::Screen:
+            return BlendMode::Screen;
+        case core::BlendMode::Overlay:
+            return BlendMode::Overlay;
+        case core::BlendMode::Darken:
+            return BlendMode::Darken;
+        case core::BlendMode::Lighten:
+            return BlendMode::Lighten;
+        case core::BlendMode::Normal:
+        default:
+            return BlendMode::Normal;
+    }
+}
+
+static core::BlendMode fromManifestBlendMode(const BlendMode mode)
+{
+    switch (mode)
+    {
+        case BlendMode::Multiply:
+            return core::BlendMode::Multiply;
+        case BlendMode::Screen:
+            return core::BlendMode::Screen;
+        case BlendMode::Overlay:
+            return core::BlendMode::Overlay;
+        case BlendMode::Darken:
+            return core::BlendMode::Darken;
+        case BlendMode::Lighten:
+            return core::BlendMode::Lighten;
+        default:
+            return core::BlendMode::Normal;
+    }
+}
+
 // ----------------- ZIP helpers --------------------------------------------
 
 std::vector<unsigned char> ZipEpgStorage::readFileFromZip(zip_t* zip,
@@ -195,7 +250,7 @@ ZipEpgStorage::Manifest ZipEpgStorage::createManifestFromDocument(const Document
         L.visible = doc.layerAt(i)->visible();
         L.locked = doc.layerAt(i)->locked();
         L.opacity = doc.layerAt(i)->opacity();
-        L.blendMode = BlendMode::Normal;
+        L.blendMode = toManifestBlendMode(doc.layerAt(i)->blendMode());
         L.path = "layers/" + layerId + ".png";
         L.sha256 = "";
         L.transform = Transform{};
@@ -245,6 +300,7 @@ std::unique_ptr<Document> ZipEpgStorage::createDocumentFromManifest(const Manife
                                                  lm.locked, lm.opacity);
             // restore saved offset (bounds.x, bounds.y)
             layer->setOffset(lm.bounds.x, lm.bounds.y);
+            layer->setBlendMode(fromManifestBlendMode(lm.blendMode));
 
             doc->addLayer(layer);
         }
@@ -301,7 +357,8 @@ void ZipEpgStorage::writeLayersToZip(ZipHandle& zipHandle, Manifest& m, const Do
         if (!layerPtr->image())
             throw std::runtime_error("Layer " + layerPtr->name() + " n'a pas de pixels");
 
-        const ImageBuffer& img = *layerPtr->image();
+        std::optional<ImageBuffer> flat;
+        const ImageBuffer& img = linearPixels(*layerPtr->image(), flat);
 
         int stride = img.strideBytes();
         if (stride == 0)
@@ -396,69 +453,27 @@ std::vector<unsigned char> ZipEpgStorage::composePreviewRGBA(const Document& doc
     int const w = std::max(1, static_cast<int>(static_cast<float>(docW) * scale));
     int const h = std::max(1, static_cast<int>(static_cast<float>(docH) * scale));
 
+    // Downsampled from the export composite, so the thumbnail matches the canvas (blend modes,
+    // opacity, offsets).
+    const std::vector<unsigned char> flat = composeFlattenedRGBA(doc);
     std::vector<unsigned char> preview(static_cast<size_t>(w) * static_cast<size_t>(h) * 4u, 0);
 
-    for (size_t i = 0; i < doc.layerCount(); ++i)
+    for (int py = 0; py < h; ++py)
     {
-        auto layerPtr = doc.layerAt(i);
-        if (!layerPtr || !layerPtr->visible() || !layerPtr->image())
-            continue;
-
-        const ImageBuffer& img = *layerPtr->image();
-        const float layerOpacity = layerPtr->opacity();
-
-        for (int py = 0; py < h; ++py)
+        // map preview y to document y
+        const int docY =
+            std::min(docH - 1, std::max(0, static_cast<int>(static_cast<float>(py) / scale)));
+        for (int px = 0; px < w; ++px)
         {
-            // map preview y to document y
-            const int docY =
-                std::min(docH - 1, std::max(0, static_cast<int>(static_cast<float>(py) / scale)));
-            for (int px = 0; px < w; ++px)
-            {
-                const int docX = std::min(
-                    docW - 1, std::max(0, static_cast<int>(static_cast<float>(px) / scale)));
-
-                // map document coordinate to layer-local coordinate
-                const int lx = docX - layerPtr->offsetX();
-                const int ly = docY - layerPtr->offsetY();
-                if (lx < 0 || lx >= img.width() || ly < 0 || ly >= img.height())
-                    continue;  // transparent outside layer bounds
-
-                const int dstIdx = (py * w + px) * 4;
-                const int srcIdx = ly * img.strideBytes() + lx * 4;
-
-                const unsigned char sr = img.data()[srcIdx + 0];
-                const unsigned char sg = img.data()[srcIdx + 1];
-                const unsigned char sb = img.data()[srcIdx + 2];
-                const unsigned char sa = img.data()[srcIdx + 3];
-
-                const float srcAlphaNorm = (static_cast<float>(sa) / 255.0f) * layerOpacity;
-
-                if (srcAlphaNorm <= 0.0001f)
-                    continue;
-
-                const float dstAlphaNorm = static_cast<float>(preview[dstIdx + 3]) / 255.0f;
-                const float outAlpha = srcAlphaNorm + dstAlphaNorm * (1.0f - srcAlphaNorm);
-
-                if (outAlpha > 0.0001f)
-                {
-                    for (int c = 0; c < 3; ++c)
-                    {
-                        const float srcVal =
-                            (c == 0 ? static_cast<float>(sr)
-                                    : (c == 1 ? static_cast<float>(sg) : static_cast<float>(sb)));
-                        const auto dstVal = static_cast<float>(preview[dstIdx + c]);
-
-                        const float numerator =
-                            srcVal * srcAlphaNorm + dstVal * dstAlphaNorm * (1.0f - srcAlphaNorm);
-                        const float outVal = numerator / outAlpha;
-
-                        preview[dstIdx + c] = static_cast<unsigned char>(
-                            std::round(std::min(255.0f, std::max(0.0f, outVal))));
-                    }
-                    preview[dstIdx + 3] =
-                        static_cast<unsigned char>(std::round(std::min(1.0f, outAlpha) * 255.0f));
-                }
-            }
+            const int docX =
+                std::min(docW - 1, std::max(0, static_cast<int>(static_cast<float>(px) / scale)));
+
+            const size_t dstIdx = (static_cast<size_t>(py) * static_cast<size_t>(w) +
+                                   static_cast<size_t>(px)) * 4u;
+            const size_t srcIdx = (static_cast<size_t>(docY) * static_cast<size_t>(docW) +
+                                   static_cast<size_t>(docX)) * 4u;
+            std::copy_n(flat.begin() + static_cast<std::ptrdiff_t>(srcIdx), 4,
+                        preview.begin() + static_cast<std::ptrdiff_t>(dstIdx));
         }
     }
 
@@ -577,37 +592,11 @@ std::vector<unsigned char> ZipEpgStorage::composeFlattenedRGBA(const Document& d
     if (docW <= 0 || docH <= 0)
         return {};
 
-    std::vector<unsigned char> out(docW * docH * 4u, 0);
-    for (size_t i = 0; i < doc.layerCount(); ++i)
-    {
-        auto layerPtr = doc.layerAt(i);
-        if (!layerPtr || !layerPtr->visible() || !layerPtr->image())
-            continue;
-        const ImageBuffer& img = *layerPtr->image();
+    // Same composite as the canvas (offsets, opacity, blend modes); the linear buffer already
+    // stores R,G,B,A bytes row after row.
+    ImageBuffer flat(doc.width(), doc.height());
+    Compositor::compose(doc, flat);
 
-        for (int y = 0; y < static_cast<int>(docH) && y < img.height(); ++y)
-        {
-            for (int x = 0; x < static_cast<int>(docW) && x < img.width(); ++x)
-            {
-                size_t const dstIdx = (y * docW + x) * 4;
-                size_t const srcIdx = static_cast<size_t>(y * img.width() + x) * 4;
-
-                float const alpha =
-                    (static_cast<float>(img.data()[srcIdx + 3]) / 255.0f) * layerPtr->opacity();
-
-                for (int c = 0; c < 3; ++c)
-                {
-                    auto const src = static_cast<float>(img.data()[srcIdx + c]);
-                    auto const dst = static_cast<float>(out[dstIdx + c]);
-                    out[dstIdx + c] =
-                        static_cast<unsigned char>(src * alpha + dst * (1.0f - alpha));
-                }
-
-                out[dstIdx + 3] = std::max<unsigned char>(
-                    out[dstIdx + 3], static_cast<unsigned char>(alpha * 255.0f));
-            }
-        }
-    }
-
-    return out;
+    const unsigned char* pixels = flat.data();
+    return {pixels, pixels + docW * docH * 4u};
 }
@@ -14,6 +14,10 @@
 
 namespace
 {
+// Stroke samples are batched per display frame (~60 Hz): high-rate mice and tablets report
+// several per frame and each batch repaints once.
+constexpr int kStrokeFrameMs = 16;
+
 static double clampScale(double s)
 {
     return std::clamp(s, 0.10, 8.0);
@@ -58,6 +62,20 @@ CanvasWidget::CanvasWidget(QWidget* parent) : QWidget(parent)
 {
     setMouseTracking(true);
     setFocusPolicy(Qt::StrongFocus);
+
+    strokeFrameTimer_.setSingleShot(true);
+    strokeFrameTimer_.setInterval(kStrokeFrameMs);
+    connect(&strokeFrameTimer_, &QTimer::timeout, this, &CanvasWidget::flushStrokeSamples);
+}
+
+void CanvasWidget::flushStrokeSamples()
+{
+    strokeFrameTimer_.stop();
+    if (pendingStroke_.empty())
+        return;
+    const std::vector<common::Point> samples = std::move(pendingStroke_);
+    pendingStroke_.clear();
+    emit moveStroke(samples);
 }
 
 void CanvasWidget::setImage(const QImage& img)
@@ -66,6 +84,16 @@ void CanvasWidget::setImage(const QImage& img)
     update();
 }
 
+void CanvasWidget::imageUpdated(const common::Rect& docArea)
+{
+    if (common::isEmpty(docArea))
+        return;
+    // +1 px: the scaled image edges are rounded
+    const QPoint a = docToScreen(common::Point{docArea.x, docArea.y});
+    const QPoint b = docToScreen(common::Point{docArea.x + docArea.w, docArea.y + docArea.h});
+    update(QRect(a, b).normalized().adjusted(-1, -1, 1, 1));
+}
+
 void CanvasWidget::clear()
 {
     img_ = QImage();
@@ -121,9 +149,11 @@ void CanvasWidget::setMoveLayerEnable(bool enable)
         draggingLayer_ = false;
 }
 
-void CanvasWidget::setDragLayerPreview(const QImage& layerImg, int x, int y)
+void CanvasWidget::setDragLayerPreview(const QImage& layerImg, int x, int y,
+                                       const QImage& aboveImg)
 {
     dragLayerImg_ = layerImg;
+    dragAboveImg_ = aboveImg;
     dragLayerPos_ = QPoint(x, y);
     dragLayerPreviewOn_ = true;
     update();
@@ -140,6 +170,7 @@ void CanvasWidget::clearDragLayerPreview()
 {
     dragLayerPreviewOn_ = false;
     dragLayerImg_ = QImage();
+    dragAboveImg_ = QImage();
     update();
 }
 
@@ -236,9 +267,11 @@ void CanvasWidget::paintEvent(QPaintEvent*)
     // base image
     p.drawImage(0, 0, img_);
 
-    // drag preview (drawn on top)
+    // drag preview, then the layers that stay above it
     if (dragLayerPreviewOn_ && !dragLayerImg_.isNull())
         p.drawImage(dragLayerPos_.x(), dragLayerPos_.y(), dragLayerImg_);
+    if (dragLayerPreviewOn_ && !dragAboveImg_.isNull())
+        p.drawImage(0, 0, dragAboveImg_);
 
     // overlays
     if (layerOverlay_)
@@ -274,66 +307,6 @@ void CanvasWidget::paintEvent(QPaintEvent*)
         p.setBrush(Qt::NoBrush);
         p.drawRect(selScreen_);
     }
-    if (!previewPoints_.empty())
-    {
-        p.save();
-        p.setRenderHint(QPainter::Antialiasing, true);
-
-        const bool erasing = eraserEnabled_;
-        const int toolSize = erasing ? eraserSize_ : pencilSize_;
-
-        const double s = scale_;
-        const double half = (static_cast<double>(toolSize) * 0.5) * s;
-
-        QColor c = erasing ? QColor(255, 255, 255, static_cast<int>(eraserOpacity_ * 180.0))
-                           : pencilColor_;
-
-        // Dessin "gomme": rempli clair + contour (sinon on ne voit rien)
-        if (erasing)
-        {
-            QPen outline(QColor(0, 0, 0, 80));
-            outline.setWidthF(std::max(1.0, s));
-            outline.setCapStyle(Qt::RoundCap);
-            outline.setJoinStyle(Qt::RoundJoin);
-            p.setPen(outline);
-            p.setBrush(QBrush(c));
-        }
-        else
-        {
-            p.setPen(Qt::NoPen);
-            p.setBrush(QBrush(c));
-        }
-
-        for (const auto& pt : previewPoints_)
-        {
-            QPoint sp = docToScreen(pt);
-            QRectF r(sp.x() - half, sp.y() - half, half * 2.0, half * 2.0);
-            p.drawEllipse(r);
-        }
-
-        // lignes
-        if (previewPoints_.size() >= 2)
-        {
-            QPen linePen(erasing ? QColor(255, 255, 255, static_cast<int>(eraserOpacity_ * 180.0))
-                                 : c);
-            linePen.setWidthF(std::max(1.0, s * static_cast<double>(toolSize)));
-            linePen.setCapStyle(Qt::RoundCap);
-            linePen.setJoinStyle(Qt::RoundJoin);
-            if (erasing)
-                linePen.setColor(QColor(255, 255, 255, static_cast<int>(eraserOpacity_ * 180.0)));
-
-            p.setPen(linePen);
-            p.setBrush(Qt::NoBrush);
-            for (size_t i = 1; i < previewPoints_.size(); ++i)
-            {
-                QPoint a = docToScreen(previewPoints_[i - 1]);
-                QPoint b = docToScreen(previewPoints_[i]);
-                p.drawLine(a, b);
-            }
-        }
-
-        p.restore();
-    }
 }
 
 void CanvasWidget::wheelEvent(QWheelEvent* e)
@@ -418,10 +391,8 @@ void CanvasWidget::mousePressEvent(QMouseEvent* e)
     if (pencilEnabled_ || eraserEnabled_)
     {
         drawing_ = true;
-        previewPoints_.clear();
-        previewPoints_.push_back(pDoc);
+        pendingStroke_.clear();
         emit beginStroke(pDoc);
-        update();
         e->accept();
         return;
     }
@@ -466,10 +437,9 @@ void CanvasWidget::mouseMoveEvent(QMouseEvent* e)
 
     if (drawing_ && (e->buttons() & Qt::LeftButton))
     {
-        common::Point pDoc = screenToDoc(cur);
-        previewPoints_.push_back(pDoc);
-        emit moveStroke(pDoc);
-        update();
+        pendingStroke_.push_back(screenToDoc(cur));
+        if (!strokeFrameTimer_.isActive())
+            strokeFrameTimer_.start();
         e->accept();
         return;
     }
@@ -527,9 +497,8 @@ void CanvasWidget::mouseReleaseEvent(QMouseEvent* e)
         if (drawing_)
         {
             drawing_ = false;
+            flushStrokeSamples();
             emit endStroke();
-            previewPoints_.clear();
-            update();
             e->accept();
             return;
         }
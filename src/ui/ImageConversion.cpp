@@ -1,12 +1,14 @@
 #include "ui/ImageConversion.hpp"
 
-#include <QRgb>
-
 #include <algorithm>
+#include <cstring>
 
 namespace ImageConversion
 {
 
+// QImage::Format_RGBA8888 stores R,G,B,A bytes in memory, exactly like ImageBuffer::Pixel, so both
+// directions are plain row copies; Qt's own (vectorised) converters handle any other format.
+
 ImageBuffer qImageToImageBuffer(const QImage& image, int width, int height)
 {
     ImageBuffer buf(width, height);
@@ -15,22 +17,16 @@ ImageBuffer qImageToImageBuffer(const QImage& image, int width, int height)
     // Note: The buffer is already initialized to transparent by the constructor
     const int copyW = std::min(width, image.width());
     const int copyH = std::min(height, image.height());
+    if (copyW <= 0 || copyH <= 0)
+        return buf;
+
+    const QImage src = image.format() == QImage::Format_RGBA8888
+                           ? image
+                           : image.convertToFormat(QImage::Format_RGBA8888);
 
     for (int y = 0; y < copyH; ++y)
-    {
-        for (int x = 0; x < copyW; ++x)
-        {
-            const QRgb p = image.pixel(x, y);
-            const uint8_t r = qRed(p);
-            const uint8_t g = qGreen(p);
-            const uint8_t b = qBlue(p);
-            const uint8_t a = qAlpha(p);
-            const uint32_t rgba = (static_cast<uint32_t>(r) << 24) |
-                                  (static_cast<uint32_t>(g) << 16) |
-                                  (static_cast<uint32_t>(b) << 8) | static_cast<uint32_t>(a);
-            buf.setPixel(x, y, rgba);
-        }
-    }
+        std::memcpy(buf.row(y).data(), src.constScanLine(y),
+                    static_cast<std::size_t>(copyW) * sizeof(ImageBuffer::Pixel));
 
     return buf;
 }
@@ -39,22 +35,20 @@ ImageBuffer qImageToImageBuffer(const QImage& image, int width, int height)
 
 QImage ImageConversion::imageBufferToQImage(const ImageBuffer& buf, QImage::Format fmt)
 {
-    QImage img(buf.width(), buf.height(), fmt);
-    // Initialize to transparent just in case
-    img.fill(Qt::transparent);
+    QImage img(buf.width(), buf.height(), QImage::Format_RGBA8888);
 
     for (int y = 0; y < buf.height(); ++y)
     {
-        for (int x = 0; x < buf.width(); ++x)
+        auto* dst = reinterpret_cast<ImageBuffer::Pixel*>(img.scanLine(y));
+        for (int x = 0; x < buf.width();)
         {
-            const uint32_t rgba = buf.getPixel(x, y);
-            const uint8_t r = static_cast<uint8_t>((rgba >> 24) & 0xFF);
-            const uint8_t g = static_cast<uint8_t>((rgba >> 16) & 0xFF);
-            const uint8_t b = static_cast<uint8_t>((rgba >> 8) & 0xFF);
-            const uint8_t a = static_cast<uint8_t>(rgba & 0xFF);
-            img.setPixel(x, y, qRgba(r, g, b, a));
+            const auto src = buf.span(x, y, buf.runLength(x, buf.width() - x));
+            std::copy(src.begin(), src.end(), dst + x);
+            x += static_cast<int>(src.size());
         }
     }
 
+    if (fmt != QImage::Format_RGBA8888)
+        img.convertTo(fmt);
     return img;
 }
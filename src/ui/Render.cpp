@@ -4,17 +4,77 @@
 
 #include "ui/Render.hpp"
 
+#include <cstdint>
+
 #include "core/Compositor.hpp"
-#include "core/ImageBuffer.hpp"
-#include "ui/ImageConversion.hpp"
+
+namespace
+{
+// Pixels of `area` in a Format_ARGB32_Premultiplied image, as the compositor writes them.
+Compositor::PremultipliedTarget frameTarget(QImage& img, const common::Rect& area)
+{
+    const std::ptrdiff_t stride = img.bytesPerLine() / 4;
+    auto* bits = reinterpret_cast<std::uint32_t*>(img.bits());
+    return Compositor::PremultipliedTarget{bits + area.y * stride + area.x, area.w, area.h,
+                                           stride};
+}
+}  // namespace
+
+Renderer::Renderer() = default;
+Renderer::~Renderer() = default;
 
 QImage Renderer::render(const Document& doc)
 {
-    ImageBuffer out(doc.width(), doc.height());
-    out.fill(0u);
+    QImage img(doc.width(), doc.height(), kFormat);
+    if (img.isNull())
+        return img;
+
+    Compositor::composeInto(doc, 0, 0, frameTarget(img, common::Rect{0, 0, doc.width(),
+                                                                     doc.height()}));
+    return img;
+}
+
+common::Rect Renderer::update(const Document& doc, std::optional<common::Rect> dirty,
+                              QImage& target, std::optional<std::size_t> activeLayer)
+{
+    const common::Rect docRect{0, 0, doc.width(), doc.height()};
+    if (common::isEmpty(docRect))
+        return common::Rect{};
+
+    const bool sameSize = target.width() == docRect.w && target.height() == docRect.h &&
+                          target.format() == kFormat;
+    if (!valid_ || !dirty || !sameSize)
+    {
+        if (!sameSize)
+            target = QImage(docRect.w, docRect.h, kFormat);
+
+        Compositor::composeInto(doc, 0, 0, frameTarget(target, docRect));
+        valid_ = true;
+        return docRect;
+    }
 
-    Compositor comp;
-    comp.compose(doc, out);
+    const common::Rect r = common::intersect(*dirty, docRect);
+    if (common::isEmpty(r))
+        return common::Rect{};
+
+    if (activeLayer && stack_.prepare(doc, *activeLayer))
+        stack_.composeInto(doc, r.x, r.y, frameTarget(target, r));
+    else
+        Compositor::composeInto(doc, r.x, r.y, frameTarget(target, r));
+    return r;
+}
+
+common::Rect Renderer::updateMovedLayer(const Document& doc, std::size_t active,
+                                        common::Point offset, const common::Rect& area,
+                                        QImage& target)
+{
+    const common::Rect r = common::intersect(area, common::Rect{0, 0, doc.width(), doc.height()});
+    if (common::isEmpty(r) || target.width() != doc.width() || target.height() != doc.height() ||
+        target.format() != kFormat)
+        return common::Rect{};
 
-    return ImageConversion::imageBufferToQImage(out, QImage::Format_ARGB32);
+    if (!stack_.isValid(doc, active))
+        stack_.build(doc, active);
+    stack_.composeMovedInto(doc, offset, r.x, r.y, frameTarget(target, r));
+    return r;
 }
@@ -4,6 +4,7 @@
 #include <QCheckBox>
 #include <QColor>
 #include <QColorDialog>
+#include <QComboBox>
 #include <QContextMenuEvent>
 #include <QDialog>
 #include <QDialogButtonBox>
@@ -35,6 +36,7 @@
 #include "app/commands/CommandUtils.hpp"
 #include "common/Geometry.hpp"
 #include "core/Document.hpp"
+#include "core/ImageBuffer.hpp"
 #include "core/Layer.hpp"
 #include "ui/CanvasWidget.hpp"
 #include "ui/ImageConversion.hpp"
@@ -88,9 +90,16 @@ MainWindow::MainWindow(app::AppService& svc, QWidget* parent) : QMainWindow(pare
                                           (static_cast<uint32_t>(m_toolColor.green()) << 16) |
                                           (static_cast<uint32_t>(m_toolColor.blue()) << 8) |
                                           static_cast<uint32_t>(m_toolColor.alpha());
+                core::FillCriteria criteria;
+                if (m_bucketToleranceSpin)
+                    criteria.tolerance = m_bucketToleranceSpin->value();
+                if (m_bucketMetricCombo && m_bucketMetricCombo->currentIndex() == 1)
+                    criteria.metric = core::ColorMetric::Euclidean;
                 try
                 {
-                    app().bucketFill(p, newColor);
+                    app().bucketFill(p, newColor, criteria,
+                                     m_bucketSampleMergedCheck &&
+                                         m_bucketSampleMergedCheck->isChecked());
                 }
                 catch (std::exception& e)
                 {
@@ -116,6 +125,13 @@ MainWindow::MainWindow(app::AppService& svc, QWidget* parent) : QMainWindow(pare
                 params.opacity = (m_eraseOpacitySpin)
                                      ? (static_cast<float>(m_eraseOpacitySpin->value()) / 100.F)
                                      : 1.F;
+                params.hardness = (m_eraseHardnessSpin)
+                                      ? (static_cast<float>(m_eraseHardnessSpin->value()) / 100.F)
+                                      : 1.F;
+                params.spacing = (m_eraseSpacingSpin) ? m_eraseSpacingSpin->value() : 0;
+                if (m_eraseSmoothingCombo)
+                    params.smoothing =
+                        static_cast<app::StrokeSmoothing>(m_eraseSmoothingCombo->currentIndex());
             }
             else
             {
@@ -123,6 +139,13 @@ MainWindow::MainWindow(app::AppService& svc, QWidget* parent) : QMainWindow(pare
                 params.opacity = (m_pencilOpacitySpin)
                                      ? (static_cast<float>(m_pencilOpacitySpin->value()) / 100.F)
                                      : 1.F;
+                params.hardness = (m_pencilHardnessSpin)
+                                      ? (static_cast<float>(m_pencilHardnessSpin->value()) / 100.F)
+                                      : 1.F;
+                params.spacing = (m_pencilSpacingSpin) ? m_pencilSpacingSpin->value() : 0;
+                if (m_pencilSmoothingCombo)
+                    params.smoothing =
+                        static_cast<app::StrokeSmoothing>(m_pencilSmoothingCombo->currentIndex());
                 params.color = (static_cast<uint32_t>(m_toolColor.red()) << 24) |
                                (static_cast<uint32_t>(m_toolColor.green()) << 16) |
                                (static_cast<uint32_t>(m_toolColor.blue()) << 8) |
@@ -131,6 +154,7 @@ MainWindow::MainWindow(app::AppService& svc, QWidget* parent) : QMainWindow(pare
             try
             {
                 app().beginStroke(params, p);
+                refreshCanvas();
             }
             catch (const std::exception& e)
             {
@@ -141,7 +165,7 @@ MainWindow::MainWindow(app::AppService& svc, QWidget* parent) : QMainWindow(pare
         });
 
     connect(canvas_, &CanvasWidget::moveStroke, this,
-            [this](common::Point p)
+            [this](const std::vector<common::Point>& samples)
             {
                 const bool pencilOn = (m_pencilAct && m_pencilAct->isChecked());
                 const bool eraserOn = (m_eraseAct && m_eraseAct->isChecked());
@@ -149,7 +173,8 @@ MainWindow::MainWindow(app::AppService& svc, QWidget* parent) : QMainWindow(pare
                     return;
                 try
                 {
-                    app().moveStroke(p);
+                    app().moveStroke(samples);
+                    refreshCanvas();
                 }
                 catch (std::exception& e)
                 {
@@ -206,15 +231,40 @@ MainWindow::MainWindow(app::AppService& svc, QWidget* parent) : QMainWindow(pare
             m_dragLayerImage = ImageConversion::imageBufferToQImage(
                 *layer->image(), QImage::Format_ARGB32_Premultiplied);
 
-            // base render without this layer (once)
-            const bool oldVis = layer->visible();
-            layer->setVisible(false);
-            m_dragBaseImage = Renderer::render(app().document());
-            layer->setVisible(oldVis);
+            // below / above composites around this layer (once, kept for the commit too)
+            auto& stack = m_renderer.layerStack();
+            if (!stack.isValid(app().document(), idx))
+                stack.build(app().document(), idx);
+
+            // blend modes: the layer cannot be drawn source-over between flattened images,
+            // recomposite the touched area at each step instead
+            m_dragPreviewFlattened =
+                stack.aboveIsExact() && layer->blendMode() == core::BlendMode::Normal;
+            if (!m_dragPreviewFlattened)
+            {
+                m_dragLastRect = common::Rect{m_dragStartOffset.x, m_dragStartOffset.y,
+                                              layer->image()->width(), layer->image()->height()};
+                canvas_->setLayerRectOverlay(m_dragLastRect);
+                return;
+            }
+
+            if (const ImageBuffer* below = stack.below())
+                m_dragBaseImage = ImageConversion::imageBufferToQImage(*below, Renderer::kFormat);
+            else
+            {
+                m_dragBaseImage = QImage(app().document().width(), app().document().height(),
+                                         Renderer::kFormat);
+                m_dragBaseImage.fill(Qt::transparent);
+            }
+            m_dragAboveImage = QImage();
+            if (const ImageBuffer* above = stack.above())
+                m_dragAboveImage = ImageConversion::imageBufferToQImage(
+                    *above, QImage::Format_ARGB32_Premultiplied);
 
             canvas_->setImage(m_dragBaseImage);
+            m_renderer.invalidate();
             canvas_->setDragLayerPreview(m_dragLayerImage, m_dragStartOffset.x,
-                                         m_dragStartOffset.y);
+                                         m_dragStartOffset.y, m_dragAboveImage);
 
             // update yellow overlay to match preview
             canvas_->setLayerRectOverlay(common::Rect{m_dragStartOffset.x, m_dragStartOffset.y,
@@ -232,6 +282,17 @@ MainWindow::MainWindow(app::AppService& svc, QWidget* parent) : QMainWindow(pare
                 const int newX = m_dragStartOffset.x + delta.x;
                 const int newY = m_dragStartOffset.y + delta.y;
 
+                if (!m_dragPreviewFlattened)
+                {
+                    const common::Rect moved{newX, newY, m_dragLastRect.w, m_dragLastRect.h};
+                    canvas_->imageUpdated(m_renderer.updateMovedLayer(
+                        app().document(), m_dragLayerIdx, common::Point{newX, newY},
+                        common::unite(m_dragLastRect, moved), canvas_->image()));
+                    m_dragLastRect = moved;
+                    canvas_->setLayerRectOverlay(moved);
+                    return;
+                }
+
                 // no render here
                 canvas_->setDragLayerPos(newX, newY);
                 canvas_->setLayerRectOverlay(
@@ -255,6 +316,7 @@ MainWindow::MainWindow(app::AppService& svc, QWidget* parent) : QMainWindow(pare
                 // clear caches
                 m_dragBaseImage = QImage();
                 m_dragLayerImage = QImage();
+                m_dragAboveImage = QImage();
 
                 // undoable commit
                 app().moveLayer(m_dragLayerIdx, newX, newY);
@@ -1130,6 +1192,16 @@ void MainWindow::syncStrokeToolState()
     canvas_->setEraserEnable(eraserOn);
 }
 
+// Recomposites the area invalidated since the last refresh only.
+void MainWindow::refreshCanvas()
+{
+    if (!canvas_ || !app().hasDocument())
+        return;
+    const auto dirty = app().takeInvalidatedRect();
+    canvas_->imageUpdated(
+        m_renderer.update(app().document(), dirty, canvas_->image(), app().activeLayer()));
+}
+
 void MainWindow::refreshUIAfterDocChange()
 {
     if (m_dragLayerActive)
@@ -1202,8 +1274,7 @@ void MainWindow::refreshUIAfterDocChange()
         return;
     }
 
-    if (canvas_)
-        canvas_->setImage(Renderer::render(app().document()));
+    refreshCanvas();
 
     {
         QSignalBlocker blocker(m_layersList);
@@ -1578,6 +1649,8 @@ void MainWindow::createActions()
             [this](bool on)
             {
                 m_bucketMode = on;
+                if (m_bucketDock)
+                    m_bucketDock->setVisible(on);
                 if (on && m_selectToggleAct)
                 {
                     m_selectToggleAct->setChecked(false);
@@ -2052,10 +2125,63 @@ void MainWindow::createToolBar()
     m_pencilOpacitySpin->setRange(1, 100);
     m_pencilOpacitySpin->setValue(100);
 
+    auto* hardnessLblPen = new QLabel(tr("Dureté"), pencilWidget);
+    m_pencilHardnessSpin = new QSpinBox(pencilWidget);
+    m_pencilHardnessSpin->setRange(0, 100);
+    m_pencilHardnessSpin->setValue(100);
+    m_pencilHardnessSpin->setToolTip(tr("100 = bord net, moins = bord adouci"));
+
+    m_pencilSmoothingCombo = new QComboBox(pencilWidget);
+    m_pencilSmoothingCombo->addItem(tr("Sans lissage"));   // app::StrokeSmoothing::None
+    m_pencilSmoothingCombo->addItem(tr("Courbe"));         // app::StrokeSmoothing::CatmullRom
+    m_pencilSmoothingCombo->addItem(tr("Stabilisateur"));  // app::StrokeSmoothing::Stabilizer
+
+    auto* spacingLblPen = new QLabel(tr("Espacement"), pencilWidget);
+    m_pencilSpacingSpin = new QSpinBox(pencilWidget);
+    m_pencilSpacingSpin->setRange(0, 500);
+    m_pencilSpacingSpin->setValue(0);
+    m_pencilSpacingSpin->setSuffix(tr(" %"));
+    m_pencilSpacingSpin->setToolTip(tr("Écart entre les touches, en % de la taille (0 = continu)"));
+
     bv->addWidget(sizeLblPen);
     bv->addWidget(m_pencilSizeSpin);
     bv->addWidget(opacityLblPen);
     bv->addWidget(m_pencilOpacitySpin);
+    bv->addWidget(hardnessLblPen);
+    bv->addWidget(m_pencilHardnessSpin);
+    bv->addWidget(spacingLblPen);
+    bv->addWidget(m_pencilSpacingSpin);
+    bv->addWidget(m_pencilSmoothingCombo);
+
+    // Bucket properties dock
+    m_bucketDock = new QDockWidget(tr("Pot de peinture"), this);
+    auto* bucketWidget = new QWidget(m_bucketDock);
+    auto* bucketLayout = new QHBoxLayout(bucketWidget);
+    bucketLayout->setContentsMargins(6, 6, 6, 6);
+
+    auto* toleranceLbl = new QLabel(tr("Seuil"), bucketWidget);
+    m_bucketToleranceSpin = new QSpinBox(bucketWidget);
+    m_bucketToleranceSpin->setRange(0, 255);
+    m_bucketToleranceSpin->setValue(0);
+    m_bucketToleranceSpin->setToolTip(tr("Écart de couleur accepté (0 = couleur identique)"));
+
+    m_bucketMetricCombo = new QComboBox(bucketWidget);
+    m_bucketMetricCombo->addItem(tr("Par canal"));    // core::ColorMetric::MaxChannel
+    m_bucketMetricCombo->addItem(tr("Euclidienne"));  // core::ColorMetric::Euclidean
+
+    m_bucketSampleMergedCheck = new QCheckBox(tr("Fusion des calques"), bucketWidget);
+    m_bucketSampleMergedCheck->setToolTip(
+        tr("Détecter la zone sur l'image visible plutôt que sur le calque actif"));
+
+    bucketLayout->addWidget(toleranceLbl);
+    bucketLayout->addWidget(m_bucketToleranceSpin);
+    bucketLayout->addWidget(m_bucketMetricCombo);
+    bucketLayout->addWidget(m_bucketSampleMergedCheck);
+
+    bucketWidget->setLayout(bucketLayout);
+    m_bucketDock->setWidget(bucketWidget);
+    addDockWidget(Qt::TopDockWidgetArea, m_bucketDock);
+    m_bucketDock->setVisible(false);
 
     m_eraseDock = new QDockWidget(tr("Gomme"), this);
     auto* eraseWidget = new QWidget(m_eraseDock);
@@ -2072,10 +2198,33 @@ void MainWindow::createToolBar()
     m_eraseOpacitySpin->setRange(1, 100);
     m_eraseOpacitySpin->setValue(100);
 
+    auto* hardnessLblEr = new QLabel(tr("Dureté"), eraseWidget);
+    m_eraseHardnessSpin = new QSpinBox(eraseWidget);
+    m_eraseHardnessSpin->setRange(0, 100);
+    m_eraseHardnessSpin->setValue(100);
+    m_eraseHardnessSpin->setToolTip(tr("100 = bord net, moins = bord adouci"));
+
+    m_eraseSmoothingCombo = new QComboBox(eraseWidget);
+    m_eraseSmoothingCombo->addItem(tr("Sans lissage"));   // app::StrokeSmoothing::None
+    m_eraseSmoothingCombo->addItem(tr("Courbe"));         // app::StrokeSmoothing::CatmullRom
+    m_eraseSmoothingCombo->addItem(tr("Stabilisateur"));  // app::StrokeSmoothing::Stabilizer
+
+    auto* spacingLblEr = new QLabel(tr("Espacement"), eraseWidget);
+    m_eraseSpacingSpin = new QSpinBox(eraseWidget);
+    m_eraseSpacingSpin->setRange(0, 500);
+    m_eraseSpacingSpin->setValue(0);
+    m_eraseSpacingSpin->setSuffix(tr(" %"));
+    m_eraseSpacingSpin->setToolTip(tr("Écart entre les touches, en % de la taille (0 = continu)"));
+
     layout->addWidget(sizeLblEr);
     layout->addWidget(m_eraseSizeSpin);
     layout->addWidget(opacityLblEr);
     layout->addWidget(m_eraseOpacitySpin);
+    layout->addWidget(hardnessLblEr);
+    layout->addWidget(m_eraseHardnessSpin);
+    layout->addWidget(spacingLblEr);
+    layout->addWidget(m_eraseSpacingSpin);
+    layout->addWidget(m_eraseSmoothingCombo);
     layout->addSpacing(12);
 
     if (canvas_)
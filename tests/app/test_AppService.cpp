@@ -10,6 +10,7 @@
 #include "AppServiceUtilsForTest.hpp"
 #include "common/Colors.hpp"
 #include "common/Geometry.hpp"
+#include "core/AlphaMask.hpp"
 #include "core/Document.hpp"
 #include "core/ImageBuffer.hpp"
 #include "core/Layer.hpp"
@@ -7,6 +7,7 @@
 #include "AppServiceUtilsForTest.hpp"
 #include "common/Colors.hpp"
 #include "common/Geometry.hpp"
+#include "core/AlphaMask.hpp"
 #include "core/ImageBuffer.hpp"
 #include "core/Layer.hpp"
 
@@ -288,7 +289,7 @@ TEST(AppService_BucketFill, WithSelection_ButMaskEmpty_IsNoOpAndNoHistory)
     // (À faire via Document directement.)
     {
         auto& sel = app->document().selection();
-        auto emptyMask = std::make_shared<ImageBuffer>(app->document().width(), app->document().height());
+        auto emptyMask = std::make_shared<AlphaMask>(app->document().width(), app->document().height());
         emptyMask->fill(0u);
         sel.setMask(emptyMask);
     }
@@ -388,3 +389,106 @@ TEST(AppService_BucketFill, WithSelection_RespectsConnectivityInsideMask)
     EXPECT_EQ(img->getPixel(4, 1), SOURCE);
     EXPECT_EQ(img->getPixel(4, 2), SOURCE);
 }
+
+TEST(AppService_BucketFill, UndoAcrossSeveralTilesRestoresEveryPixel)
+{
+    const auto app = makeApp();
+    app->newDocument(app::Size{150, 100}, 72.f, common::colors::Transparent);
+
+    app::LayerSpec spec{};
+    spec.locked = false;
+    spec.color = common::colors::Transparent;
+    app->addLayer(spec);
+    app->setActiveLayer(1);
+
+    auto img = app->document().layerAt(1)->image();
+    ASSERT_NE(img, nullptr);
+
+    // diagonal walls: the region is irregular and crosses tile edges
+    for (int y = 0; y < 100; ++y)
+        for (int x = 0; x < 150; ++x)
+            if ((x + 2 * y) % 37 == 0 && x % 5 != 0)
+                img->setPixel(x, y, 0xFF0000FFu);
+    const ImageBuffer before = *img;
+
+    app->bucketFill(common::Point{1, 1}, 0x00FF00FFu);
+    EXPECT_EQ(img->getPixel(1, 1), 0x00FF00FFu);
+    EXPECT_EQ(img->getPixel(140, 90), 0x00FF00FFu);
+
+    app->undo();
+    for (int y = 0; y < 100; ++y)
+        for (int x = 0; x < 150; ++x)
+            ASSERT_EQ(img->getPixel(x, y), before.getPixel(x, y)) << x << "," << y;
+}
+
+TEST(AppService_BucketFill, SampleMerged_UsesLineArtFromOtherLayers)
+{
+    const auto app = makeApp();
+    app->newDocument(app::Size{8, 8}, 72.f);
+
+    // line art on its own layer: a vertical black line at x = 3
+    app::LayerSpec lines{};
+    lines.color = common::colors::Transparent;
+    app->addLayer(lines);
+    auto lineImg = app->document().layerAt(1)->image();
+    for (int y = 0; y < 8; ++y)
+        lineImg->setPixel(3, y, 0x000000FFu);
+
+    // empty paint layer above, shifted right by one pixel
+    app::LayerSpec paint{};
+    paint.color = common::colors::Transparent;
+    paint.width = 7;
+    paint.height = 8;
+    paint.offsetX = 1;
+    app->addLayer(paint);
+    app->setActiveLayer(2);
+    auto img = app->document().layerAt(2)->image();
+
+    const std::uint32_t FILL = 0xFF0000FFu;
+    app->bucketFill(common::Point{1, 1}, FILL, {}, true);
+
+    // doc x 1..2 (local 0..1) filled, the line and everything right of it untouched
+    for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 7; ++x)
+            EXPECT_EQ(img->getPixel(x, y), x < 2 ? FILL : common::colors::Transparent)
+                << x << "," << y;
+    for (int y = 0; y < 8; ++y)
+        EXPECT_EQ(lineImg->getPixel(3, y), 0x000000FFu);
+
+    app->undo();
+    for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 7; ++x)
+            EXPECT_EQ(img->getPixel(x, y), common::colors::Transparent);
+
+    // without sample merged the whole (uniform) paint layer is filled
+    app->bucketFill(common::Point{1, 1}, FILL);
+    EXPECT_EQ(img->getPixel(6, 7), FILL);
+}
+
+TEST(AppService_BucketFill, WithSelection_OffsetLayerIsClippedInDocumentCoords)
+{
+    const auto app = makeApp();
+    app->newDocument(app::Size{10, 10}, 72.f, common::colors::Transparent);
+
+    app::LayerSpec spec{};
+    spec.width = 6;
+    spec.height = 6;
+    spec.offsetX = 3;
+    spec.offsetY = 2;
+    spec.color = 0x11223344u;
+    app->addLayer(spec);
+    app->setActiveLayer(1);
+    auto img = app->document().layerAt(1)->image();
+
+    // document rect (5..7, 4..5) = layer rect (2..4, 2..3)
+    app->setSelectionRect(Selection::Rect{5, 4, 3, 2});
+    const std::uint32_t FILL = 0xAABBCCDDu;
+    app->bucketFill(common::Point{6, 4}, FILL);
+
+    for (int y = 0; y < 6; ++y)
+        for (int x = 0; x < 6; ++x)
+        {
+            const bool selected = x >= 2 && x < 5 && y >= 2 && y < 4;
+            EXPECT_EQ(img->getPixel(x, y), selected ? FILL : 0x11223344u) << x << "," << y;
+        }
+}
@@ -68,6 +68,24 @@ TEST(AppService_DuplicateLayer, DeepCopyNotShared)
     EXPECT_EQ(dup->image()->getPixel(0,0), 0xFF112233u);
 }
 
+TEST(AppService_DuplicateLayer, CopyKeepsBlendMode)
+{
+    auto svc = makeApp();
+    svc->newDocument({8, 8}, 72.f);
+
+    app::LayerSpec spec{};
+    spec.name="Multiply"; spec.visible=true; spec.locked=false; spec.opacity=1.f; spec.color=0u;
+    svc->addLayer(spec);
+    svc->document().layerAt(1)->setBlendMode(core::BlendMode::Multiply);
+
+    svc->duplicateLayer(1);
+
+    ASSERT_EQ(svc->document().layerCount(), 3u);
+    auto dup = svc->document().layerAt(2);
+    ASSERT_NE(dup, nullptr);
+    EXPECT_EQ(dup->blendMode(), core::BlendMode::Multiply);
+}
+
 TEST(AppService_DuplicateLayer, LockedLayerCopyIsLocked)
 {
     auto svc = makeApp();
@@ -0,0 +1,108 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include <gtest/gtest.h>
+
+#include "app/AppService.hpp"
+#include "AppServiceUtilsForTest.hpp"
+#include "app/ToolParams.hpp"
+#include "common/Colors.hpp"
+#include "core/Layer.hpp"
+
+static void expectRect(const std::optional<common::Rect>& r, int x, int y, int w, int h)
+{
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->x, x);
+    EXPECT_EQ(r->y, y);
+    EXPECT_EQ(r->w, w);
+    EXPECT_EQ(r->h, h);
+}
+
+static std::unique_ptr<app::AppService> makeAppWithLayer()
+{
+    auto svc = makeApp();
+    svc->newDocument({100, 80}, 72.f, common::colors::White);
+
+    app::LayerSpec spec;
+    spec.name = "L1";
+    spec.width = 10;
+    spec.height = 20;
+    spec.offsetX = 5;
+    spec.offsetY = 7;
+    spec.color = common::colors::Transparent;
+    svc->addLayer(spec);
+
+    (void)svc->takeInvalidatedRect();
+    return svc;
+}
+
+TEST(AppService_Invalidation, NewDocumentInvalidatesEverything)
+{
+    auto svc = makeApp();
+    svc->newDocument({100, 80}, 72.f, common::colors::White);
+    EXPECT_FALSE(svc->takeInvalidatedRect().has_value());
+
+    // taken: nothing left
+    const auto again = svc->takeInvalidatedRect();
+    ASSERT_TRUE(again.has_value());
+    EXPECT_TRUE(common::isEmpty(*again));
+}
+
+TEST(AppService_Invalidation, LayerPropertyChangesInvalidateLayerBounds)
+{
+    auto svc = makeAppWithLayer();
+    const std::size_t idx = svc->activeLayer();
+
+    svc->setLayerOpacity(idx, 0.5f);
+    expectRect(svc->takeInvalidatedRect(), 5, 7, 10, 20);
+
+    svc->setLayerVisible(idx, false);
+    expectRect(svc->takeInvalidatedRect(), 5, 7, 10, 20);
+
+    svc->setLayerName(idx, "renamed");
+    const auto none = svc->takeInvalidatedRect();
+    ASSERT_TRUE(none.has_value());
+    EXPECT_TRUE(common::isEmpty(*none));
+}
+
+TEST(AppService_Invalidation, MoveInvalidatesOldAndNewPosition)
+{
+    auto svc = makeAppWithLayer();
+    const std::size_t idx = svc->activeLayer();
+
+    svc->moveLayer(idx, 50, 40);
+    expectRect(svc->takeInvalidatedRect(), 5, 7, 55, 53);
+
+    svc->undo();
+    expectRect(svc->takeInvalidatedRect(), 5, 7, 55, 53);
+}
+
+TEST(AppService_Invalidation, StrokeInvalidatesOnlyTouchedPixels)
+{
+    auto svc = makeAppWithLayer();
+
+    app::ToolParams params;
+    params.tool = app::ToolKind::Pencil;
+    params.size = 1;
+    params.color = RGBA(255, 0, 0, 255);
+
+    svc->beginStroke(params, common::Point{8, 10});
+    svc->moveStroke(common::Point{11, 12});
+    svc->endStroke();
+    expectRect(svc->takeInvalidatedRect(), 8, 10, 4, 3);
+
+    svc->undo();
+    expectRect(svc->takeInvalidatedRect(), 8, 10, 4, 3);
+}
+
+TEST(AppService_Invalidation, RectsAccumulateUntilTaken)
+{
+    auto svc = makeAppWithLayer();
+
+    svc->bucketFill(common::Point{6, 8}, RGBA(0, 0, 255, 255));
+    svc->setSelectionRect(common::Rect{0, 0, 3, 3});
+    svc->setLayerOpacity(0, 0.5f);
+
+    expectRect(svc->takeInvalidatedRect(), 0, 0, 100, 80);
+}
@@ -4,6 +4,9 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cmath>
+
 #include "AppServiceUtilsForTest.hpp"
 #include "app/ToolParams.hpp"
 #include "common/Colors.hpp"
@@ -328,3 +331,222 @@ TEST(StrokeBehavior_API, MoveStroke_WithoutBegin_NoOp)
     EXPECT_FALSE(app->canUndo());
 }
 
+
+TEST(StrokeBehavior_Live, SegmentsArePaintedDuringTheDrag)
+{
+    const auto app = makeApp();
+    app->newDocument(app::Size{20, 10}, 72.f);
+
+    app::LayerSpec spec{};
+    spec.color = common::colors::Transparent;
+    spec.offsetX = 2;
+    app->addLayer(spec);
+    app->setActiveLayer(1);
+    auto img = app->document().layerAt(1)->image();
+    ASSERT_NE(img, nullptr);
+
+    app::ToolParams tp{};
+    tp.tool = app::ToolKind::Pencil;
+    tp.color = RGBA(0x11, 0x22, 0x33, 0xFF);
+    tp.opacity = 1.f;
+    tp.size = 1;
+
+    (void)app->takeInvalidatedRect();
+    app->beginStroke(tp, common::Point{4, 3});
+    EXPECT_EQ(img->getPixel(2, 3), RGBA(0x11, 0x22, 0x33, 0xFF));
+    auto dirty = app->takeInvalidatedRect();
+    ASSERT_TRUE(dirty.has_value());
+    EXPECT_EQ(dirty->x, 4);
+    EXPECT_EQ(dirty->y, 3);
+    EXPECT_EQ(dirty->w, 1);
+    EXPECT_EQ(dirty->h, 1);
+
+    // only the new segment is reported
+    app->moveStroke(common::Point{8, 3});
+    for (int x = 2; x <= 6; ++x)
+        EXPECT_EQ(img->getPixel(x, 3), RGBA(0x11, 0x22, 0x33, 0xFF)) << x;
+    dirty = app->takeInvalidatedRect();
+    ASSERT_TRUE(dirty.has_value());
+    EXPECT_EQ(dirty->x, 5);
+    EXPECT_EQ(dirty->w, 4);
+
+    // going back over painted pixels changes nothing
+    app->moveStroke(common::Point{4, 3});
+    dirty = app->takeInvalidatedRect();
+    ASSERT_TRUE(dirty.has_value());
+    EXPECT_TRUE(common::isEmpty(*dirty));
+
+    app->endStroke();
+    for (int x = 2; x <= 6; ++x)
+        EXPECT_EQ(img->getPixel(x, 3), RGBA(0x11, 0x22, 0x33, 0xFF)) << x;
+    dirty = app->takeInvalidatedRect();
+    ASSERT_TRUE(dirty.has_value());
+    EXPECT_EQ(dirty->x, 4);
+    EXPECT_EQ(dirty->w, 5);
+
+    app->undo();
+    for (int x = 0; x < 20; ++x)
+        EXPECT_EQ(img->getPixel(x, 3), common::colors::Transparent) << x;
+    app->redo();
+    for (int x = 2; x <= 6; ++x)
+        EXPECT_EQ(img->getPixel(x, 3), RGBA(0x11, 0x22, 0x33, 0xFF)) << x;
+}
+
+TEST(StrokeBehavior_History, WideStrokeAcrossTilesUndoesAndRedoesExactly)
+{
+    const auto app = makeApp();
+    app->newDocument(app::Size{200, 150}, 72.f, common::colors::White);
+
+    app::LayerSpec spec{};
+    spec.color = RGBA(0x40, 0x80, 0xC0, 0x80);
+    spec.offsetX = -7;
+    spec.offsetY = 5;
+    app->addLayer(spec);
+    app->setActiveLayer(1);
+    auto img = app->document().layerAt(1)->image();
+    ASSERT_NE(img, nullptr);
+    const ImageBuffer original = *img;
+
+    app::ToolParams tp{};
+    tp.tool = app::ToolKind::Pencil;
+    tp.color = RGBA(0x11, 0x22, 0x33, 0xFF);
+    tp.opacity = 0.5f;
+    tp.size = 41;
+
+    app->beginStroke(tp, common::Point{10, 20});
+    app->moveStroke(common::Point{150, 90});
+    app->moveStroke(common::Point{60, 130});
+    app->moveStroke(common::Point{70, 10});
+    app->endStroke();
+    const ImageBuffer painted = *img;
+
+    // opacity 0.5 over the layer color: the touched pixels were blended exactly once
+    // (17, 15) is the layer pixel under the first point
+    const std::uint32_t blended = painted.getPixel(17, 15);
+    ASSERT_NE(blended, original.getPixel(17, 15));
+    int changed = 0;
+    for (int y = 0; y < img->height(); ++y)
+        for (int x = 0; x < img->width(); ++x)
+            if (painted.getPixel(x, y) != original.getPixel(x, y))
+            {
+                ++changed;
+                ASSERT_EQ(painted.getPixel(x, y), blended) << x << "," << y;
+            }
+    EXPECT_GT(changed, 64 * 64);
+
+    app->undo();
+    for (int y = 0; y < img->height(); ++y)
+        for (int x = 0; x < img->width(); ++x)
+            ASSERT_EQ(img->getPixel(x, y), original.getPixel(x, y)) << x << "," << y;
+
+    app->redo();
+    for (int y = 0; y < img->height(); ++y)
+        for (int x = 0; x < img->width(); ++x)
+            ASSERT_EQ(img->getPixel(x, y), painted.getPixel(x, y)) << x << "," << y;
+}
+
+TEST(StrokeBehavior_Geometry, SoftBrushBlendsItsEdgeAndDoesNotBuildUp)
+{
+    const auto app = makeApp();
+    app->newDocument(app::Size{40, 20}, 72.f, common::colors::White);
+
+    app::LayerSpec spec{};
+    spec.color = RGBA(0xFF, 0xFF, 0xFF, 0xFF);
+    app->addLayer(spec);
+    app->setActiveLayer(1);
+    auto img = app->document().layerAt(1)->image();
+    ASSERT_NE(img, nullptr);
+
+    app::ToolParams tp{};
+    tp.tool = app::ToolKind::Pencil;
+    tp.color = RGBA(0x00, 0x00, 0x00, 0xFF);
+    tp.opacity = 1.f;
+    tp.size = 10;
+    tp.hardness = 0.f;
+
+    // many overlapping dabs along a horizontal line
+    app->beginStroke(tp, common::Point{10, 10});
+    app->moveStroke(common::Point{30, 10});
+    app->endStroke();
+
+    const auto red = [&](int x, int y) { return (img->getPixel(x, y) >> 24) & 0xFFu; };
+    EXPECT_EQ(red(20, 10), 0u);
+    // the falloff across the line: darker towards the middle, untouched far away
+    EXPECT_LT(red(20, 11), red(20, 13));
+    EXPECT_LT(red(20, 13), 0xFFu);
+    EXPECT_EQ(red(20, 1), 0xFFu);
+    // every dab along the line gave (20, 13) the same coverage: no build-up
+    EXPECT_EQ(red(20, 13), red(25, 13));
+}
+
+TEST(StrokeBehavior_Geometry, SpacedDabsCarryTheirDistanceAcrossSegments)
+{
+    const auto app = makeApp();
+    app->newDocument(app::Size{20, 3}, 72.f);
+
+    app::LayerSpec spec{};
+    spec.color = common::colors::Transparent;
+    app->addLayer(spec);
+    app->setActiveLayer(1);
+    auto img = app->document().layerAt(1)->image();
+    ASSERT_NE(img, nullptr);
+
+    app::ToolParams tp{};
+    tp.tool = app::ToolKind::Pencil;
+    tp.color = RGBA(0x11, 0x22, 0x33, 0xFF);
+    tp.size = 1;
+    tp.spacing = 500;  // one dab every 5 px
+
+    app->beginStroke(tp, common::Point{0, 1});
+    app->moveStroke(common::Point{7, 1});
+    app->moveStroke(common::Point{17, 1});
+    app->endStroke();
+
+    for (int x = 0; x < 20; ++x)
+        EXPECT_EQ(img->getPixel(x, 1),
+                  x % 5 == 0 && x <= 15 ? RGBA(0x11, 0x22, 0x33, 0xFF) : common::colors::Transparent)
+            << x;
+}
+
+TEST(StrokeBehavior_Geometry, UnspacedStrokeCoversTheSweptCapsule)
+{
+    const auto app = makeApp();
+    app->newDocument(app::Size{60, 50}, 72.f);
+
+    app::LayerSpec spec{};
+    spec.color = common::colors::Transparent;
+    app->addLayer(spec);
+    app->setActiveLayer(1);
+    auto img = app->document().layerAt(1)->image();
+    ASSERT_NE(img, nullptr);
+
+    app::ToolParams tp{};
+    tp.tool = app::ToolKind::Pencil;
+    tp.size = 9;
+
+    const common::Point a{8, 10};
+    const common::Point b{47, 33};
+    app->beginStroke(tp, a);
+    app->moveStroke(b);
+    app->endStroke();
+
+    const double r = 4.5;
+    for (int y = 0; y < 50; ++y)
+        for (int x = 0; x < 60; ++x)
+        {
+            const double dx = b.x - a.x;
+            const double dy = b.y - a.y;
+            const double t =
+                std::clamp(((x - a.x) * dx + (y - a.y) * dy) / (dx * dx + dy * dy), 0.0, 1.0);
+            const double d = std::hypot(x - a.x - t * dx, y - a.y - t * dy);
+            const bool painted = img->getPixel(x, y) != common::colors::Transparent;
+            if (d < r - 1e-6)
+            {
+                EXPECT_TRUE(painted) << x << "," << y;
+            }
+            else if (d > r + 1e-6)
+            {
+                EXPECT_FALSE(painted) << x << "," << y;
+            }
+        }
+}
@@ -0,0 +1,113 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "AppServiceUtilsForTest.hpp"
+#include "app/StrokeSmoother.hpp"
+#include "common/Colors.hpp"
+#include "core/ImageBuffer.hpp"
+#include "core/Layer.hpp"
+
+namespace
+{
+bool samePoint(common::Point a, common::Point b)
+{
+    return a.x == b.x && a.y == b.y;
+}
+}  // namespace
+
+TEST(StrokeSmoother, NonePassesSamplesThroughWithoutDuplicates)
+{
+    app::StrokeSmoother smoother{app::StrokeSmoothing::None, common::Point{1, 1}};
+    const std::vector<common::Point> samples{{1, 1}, {2, 1}, {2, 1}, {5, 3}};
+    std::vector<common::Point> out;
+    smoother.push(samples, out);
+    smoother.finish(out);
+
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_TRUE(samePoint(out[0], common::Point{2, 1}));
+    EXPECT_TRUE(samePoint(out[1], common::Point{5, 3}));
+}
+
+TEST(StrokeSmoother, CatmullRomGoesThroughEverySampleOneBehind)
+{
+    app::StrokeSmoother smoother{app::StrokeSmoothing::CatmullRom, common::Point{0, 0}};
+    const std::vector<common::Point> samples{{20, 0}, {40, 20}, {40, 50}, {10, 60}};
+    std::vector<common::Point> out;
+
+    smoother.push(std::span(samples).first(1), out);
+    EXPECT_TRUE(out.empty());  // the first segment needs the next sample
+    smoother.push(std::span(samples).subspan(1), out);
+    ASSERT_FALSE(out.empty());
+    EXPECT_TRUE(samePoint(out.back(), samples[2]));
+    smoother.finish(out);
+    EXPECT_TRUE(samePoint(out.back(), samples[3]));
+
+    // every sample is on the curve, in order, and the curve has no gaps wider than a few px
+    std::size_t next = 0;
+    common::Point prev{0, 0};
+    for (const common::Point& p : out)
+    {
+        EXPECT_LE(std::hypot(p.x - prev.x, p.y - prev.y), 4.0);
+        if (next < samples.size() && samePoint(p, samples[next]))
+            ++next;
+        prev = p;
+    }
+    EXPECT_EQ(next, samples.size());
+}
+
+TEST(StrokeSmoother, StabilizerIgnoresJitterAndCatchesUpAtTheEnd)
+{
+    app::StrokeSmoother smoother{app::StrokeSmoothing::Stabilizer, common::Point{50, 50}, 8.0};
+    std::vector<common::Point> out;
+
+    const std::vector<common::Point> jitter{{53, 48}, {47, 52}, {55, 55}, {50, 44}};
+    smoother.push(jitter, out);
+    EXPECT_TRUE(out.empty());
+
+    const std::vector<common::Point> move{{80, 50}};
+    smoother.push(move, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_NEAR(out[0].x, 72, 1);  // 8 px behind the pointer
+    EXPECT_NEAR(out[0].y, 50, 2);
+
+    smoother.finish(out);
+    EXPECT_TRUE(samePoint(out.back(), common::Point{80, 50}));
+}
+
+TEST(StrokeSmoother, BatchedSamplesPaintLikeSingleMoves)
+{
+    const auto paint = [](bool batched)
+    {
+        const auto app = makeApp();
+        app->newDocument(app::Size{40, 40}, 72.f);
+        app::LayerSpec spec{};
+        spec.color = common::colors::Transparent;
+        app->addLayer(spec);
+        app->setActiveLayer(1);
+
+        app::ToolParams tp{};
+        tp.size = 3;
+        const std::vector<common::Point> samples{{12, 5}, {20, 18}, {8, 30}, {30, 33}};
+        app->beginStroke(tp, common::Point{3, 3});
+        if (batched)
+            app->moveStroke(samples);
+        else
+            for (const common::Point& p : samples)
+                app->moveStroke(p);
+        app->endStroke();
+        return ImageBuffer{*app->document().layerAt(1)->image()};
+    };
+
+    const ImageBuffer single = paint(false);
+    const ImageBuffer batch = paint(true);
+    for (int y = 0; y < 40; ++y)
+        for (int x = 0; x < 40; ++x)
+            ASSERT_EQ(batch.getPixel(x, y), single.getPixel(x, y)) << x << "," << y;
+}
@@ -0,0 +1,87 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+
+#include "core/AlphaMask.hpp"
+
+TEST(AlphaMaskTest, NewMaskIsEmpty)
+{
+    const AlphaMask mask{5, 3};
+
+    EXPECT_EQ(mask.width(), 5);
+    EXPECT_EQ(mask.height(), 3);
+    EXPECT_EQ(mask.storage(), AlphaMask::Storage::A8);
+    for (int y = 0; y < 3; ++y)
+        for (int x = 0; x < 5; ++x)
+            EXPECT_EQ(mask.at(x, y), 0u);
+    EXPECT_FALSE(mask.bounds().has_value());
+}
+
+TEST(AlphaMaskTest, A8KeepsValuesAndBitsStoresCoverage)
+{
+    AlphaMask a8{4, 1};
+    AlphaMask bits{4, 1, AlphaMask::Storage::Bits};
+    a8.set(1, 0, 0x40);
+    bits.set(1, 0, 0x40);
+
+    EXPECT_EQ(a8.at(1, 0), 0x40u);
+    EXPECT_EQ(a8.row(0)[1], 0x40u);
+    EXPECT_EQ(bits.at(1, 0), 0xFFu);
+
+    bits.set(1, 0, 0);
+    EXPECT_EQ(bits.at(1, 0), 0u);
+}
+
+TEST(AlphaMaskTest, FillRectIsClippedAndBoundsFollow)
+{
+    for (const auto storage : {AlphaMask::Storage::A8, AlphaMask::Storage::Bits})
+    {
+        AlphaMask mask{150, 20, storage};
+        mask.fillRect(common::Rect{60, -5, 100, 10}, 0xFF);
+        mask.fillRect(common::Rect{100, 0, 10, 2}, 0);
+
+        EXPECT_EQ(mask.at(59, 0), 0u);
+        EXPECT_EQ(mask.at(60, 0), 0xFFu);
+        EXPECT_EQ(mask.at(149, 4), 0xFFu);
+        EXPECT_EQ(mask.at(149, 5), 0u);
+        EXPECT_EQ(mask.at(105, 1), 0u);
+        EXPECT_EQ(mask.at(105, 2), 0xFFu);
+
+        const auto b = mask.bounds();
+        ASSERT_TRUE(b.has_value());
+        EXPECT_EQ(b->x, 60);
+        EXPECT_EQ(b->y, 0);
+        EXPECT_EQ(b->w, 90);
+        EXPECT_EQ(b->h, 5);
+    }
+}
+
+TEST(AlphaMaskTest, CoverageBitsMatchPerPixelValues)
+{
+    for (const auto storage : {AlphaMask::Storage::A8, AlphaMask::Storage::Bits})
+    {
+        AlphaMask mask{200, 3, storage};
+        std::mt19937 rng(9);
+        std::uniform_int_distribution<int> dist(0, 3);
+        for (int y = 0; y < 3; ++y)
+            for (int x = 0; x < 200; ++x)
+                mask.set(x, y, static_cast<std::uint8_t>(dist(rng) * 80));
+
+        // windows straddling words and the mask edges
+        for (const int x : {-70, -3, 0, 1, 37, 63, 64, 130, 150, 190})
+            for (const int n : {1, 17, 63, 64})
+            {
+                std::uint64_t want = 0;
+                for (int i = 0; i < n; ++i)
+                    if (x + i >= 0 && x + i < 200 && mask.at(x + i, 1) != 0)
+                        want |= std::uint64_t{1} << i;
+                EXPECT_EQ(mask.coverageBits(x, 1, n), want) << x << " " << n;
+            }
+        EXPECT_EQ(mask.coverageBits(0, -1, 64), 0u);
+        EXPECT_EQ(mask.coverageBits(0, 3, 64), 0u);
+    }
+}
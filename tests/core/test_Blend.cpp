@@ -0,0 +1,249 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "core/Blend.hpp"
+#include "core/ImageBuffer.hpp"
+
+using Pixel = ImageBuffer::Pixel;
+
+// Float "src over dst" the compositor used before the kernels (packed 0xRRGGBBAA).
+static std::uint32_t referenceOver(std::uint32_t src, std::uint32_t dst, float opacity)
+{
+    const auto ch = [](std::uint32_t px, int shift)
+    { return static_cast<float>((px >> shift) & 0xFFu) / 255.0f; };
+    const float effA = ch(src, 0) * std::clamp(opacity, 0.0f, 1.0f);
+    const float dstA = ch(dst, 0);
+    const float outA = effA + dstA * (1.0f - effA);
+    if (outA <= 0.0f)
+        return 0u;
+    const auto toByte = [](float v)
+    { return static_cast<std::uint32_t>(std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f)); };
+    std::uint32_t out = toByte(outA);
+    for (int shift = 8; shift <= 24; shift += 8)
+        out |= toByte((ch(src, shift) * effA + ch(dst, shift) * dstA * (1.0f - effA)) / outA)
+               << shift;
+    return out;
+}
+
+static std::vector<core::SimdLevel> availableLevels()
+{
+    std::vector<core::SimdLevel> levels;
+    for (auto level : {core::SimdLevel::Scalar, core::SimdLevel::Sse2, core::SimdLevel::Avx2,
+                       core::SimdLevel::Avx512})
+        if (core::sourceOverKernel(level) != nullptr)
+            levels.push_back(level);
+    return levels;
+}
+
+TEST(Blend, ScalarKernelIsAlwaysAvailable)
+{
+    EXPECT_NE(core::sourceOverKernel(core::SimdLevel::Scalar), nullptr);
+    EXPECT_NE(core::sourceOverKernel(core::detectedSimdLevel()), nullptr);
+}
+
+TEST(Blend, EveryKernelMatchesFloatReferenceWithinOneLsb)
+{
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<std::uint32_t> any;
+    std::uniform_int_distribution<int> pick(0, 3);
+
+    // mix of transparent / opaque / random alphas so every fast path is hit inside the runs
+    constexpr std::size_t kCount = 1003;
+    std::vector<std::uint32_t> src(kCount);
+    std::vector<std::uint32_t> dst(kCount);
+    for (std::size_t i = 0; i < kCount; ++i)
+    {
+        src[i] = any(rng);
+        dst[i] = any(rng);
+        if (pick(rng) == 0)
+            src[i] &= 0xFFFFFF00u;
+        if (pick(rng) == 0)
+            src[i] |= 0xFFu;
+        if (pick(rng) == 0)
+            dst[i] &= 0xFFFFFF00u;
+    }
+
+    for (const float opacity : {1.0f, 0.5f, 0.01f, 0.0f})
+    {
+        for (const auto level : availableLevels())
+        {
+            std::vector<Pixel> s(kCount);
+            std::vector<Pixel> d(kCount);
+            std::transform(src.begin(), src.end(), s.begin(), ImageBuffer::toPixel);
+            std::transform(dst.begin(), dst.end(), d.begin(), ImageBuffer::toPixel);
+
+            core::sourceOverKernel(level)(s.data(), d.data(), kCount, opacity);
+
+            for (std::size_t i = 0; i < kCount; ++i)
+            {
+                const std::uint32_t want = referenceOver(src[i], dst[i], opacity);
+                const std::uint32_t got = ImageBuffer::toRgba(d[i]);
+                for (int shift = 0; shift <= 24; shift += 8)
+                {
+                    const int a = static_cast<int>((want >> shift) & 0xFFu);
+                    const int b = static_cast<int>((got >> shift) & 0xFFu);
+                    ASSERT_LE(std::abs(a - b), 1)
+                        << "level " << static_cast<int>(level) << " opacity " << opacity
+                        << " pixel " << i << " src " << std::hex << src[i] << " dst " << dst[i];
+                }
+            }
+        }
+    }
+}
+
+TEST(Blend, OpaqueSourceAtFullOpacityIsCopied)
+{
+    for (const auto level : availableLevels())
+    {
+        std::vector<Pixel> s(19, ImageBuffer::toPixel(0x10203FFFu));
+        std::vector<Pixel> d(19, ImageBuffer::toPixel(0xA0B0C080u));
+        core::sourceOverKernel(level)(s.data(), d.data(), s.size(), 1.0f);
+        for (const Pixel px : d)
+            EXPECT_EQ(ImageBuffer::toRgba(px), 0x10203FFFu);
+    }
+}
+
+TEST(Blend, TransparentSourceKeepsDestination)
+{
+    for (const auto level : availableLevels())
+    {
+        std::vector<Pixel> s(21, ImageBuffer::toPixel(0xFFFFFF00u));
+        std::vector<Pixel> d(21, ImageBuffer::toPixel(0x11223344u));
+        core::sourceOverKernel(level)(s.data(), d.data(), s.size(), 0.7f);
+        for (const Pixel px : d)
+            EXPECT_EQ(ImageBuffer::toRgba(px), 0x11223344u);
+    }
+}
+
+// W3C separable blend then "over", in floats (packed 0xRRGGBBAA).
+static std::uint32_t referenceMode(core::BlendMode mode, std::uint32_t src, std::uint32_t dst,
+                                   float opacity)
+{
+    const auto ch = [](std::uint32_t px, int shift)
+    { return static_cast<float>((px >> shift) & 0xFFu) / 255.0f; };
+    const float as = ch(src, 0) * std::clamp(opacity, 0.0f, 1.0f);
+    const float ab = ch(dst, 0);
+    const float ao = as + ab * (1.0f - as);
+    if (ao <= 0.0f)
+        return 0u;
+    const auto toByte = [](float v)
+    { return static_cast<std::uint32_t>(std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f)); };
+    std::uint32_t out = toByte(ao);
+    for (int shift = 8; shift <= 24; shift += 8)
+    {
+        const float cs = ch(src, shift);
+        const float cb = ch(dst, shift);
+        float b = cs;
+        switch (mode)
+        {
+            case core::BlendMode::Multiply:
+                b = cb * cs;
+                break;
+            case core::BlendMode::Screen:
+                b = cb + cs - cb * cs;
+                break;
+            case core::BlendMode::Overlay:
+                b = cb <= 0.5f ? 2.0f * cb * cs : 1.0f - 2.0f * (1.0f - cb) * (1.0f - cs);
+                break;
+            case core::BlendMode::Darken:
+                b = std::min(cb, cs);
+                break;
+            case core::BlendMode::Lighten:
+                b = std::max(cb, cs);
+                break;
+            default:
+                break;
+        }
+        const float mixed = (1.0f - ab) * cs + ab * b;
+        out |= toByte((as * mixed + ab * cb * (1.0f - as)) / ao) << shift;
+    }
+    return out;
+}
+
+TEST(Blend, BlendModesMatchFloatReferenceWithinOneLsb)
+{
+    std::mt19937 rng(99);
+    std::uniform_int_distribution<std::uint32_t> any;
+    constexpr std::size_t kCount = 517;
+    std::vector<std::uint32_t> src(kCount);
+    std::vector<std::uint32_t> dst(kCount);
+    for (std::size_t i = 0; i < kCount; ++i)
+    {
+        src[i] = any(rng);
+        dst[i] = any(rng);
+        if (i % 7 == 0)
+            src[i] &= 0xFFFFFF00u;
+        if (i % 5 == 0)
+            dst[i] &= 0xFFFFFF00u;
+        if (i % 3 == 0)
+            dst[i] |= 0xFFu;
+    }
+
+    for (const auto mode : {core::BlendMode::Normal, core::BlendMode::Multiply,
+                            core::BlendMode::Screen, core::BlendMode::Overlay,
+                            core::BlendMode::Darken, core::BlendMode::Lighten})
+    {
+        for (const float opacity : {1.0f, 0.6f, 0.0f})
+        {
+            std::vector<Pixel> s(kCount);
+            std::vector<Pixel> d(kCount);
+            std::transform(src.begin(), src.end(), s.begin(), ImageBuffer::toPixel);
+            std::transform(dst.begin(), dst.end(), d.begin(), ImageBuffer::toPixel);
+
+            core::blendRow(mode, s, d, opacity);
+
+            for (std::size_t i = 0; i < kCount; ++i)
+            {
+                const std::uint32_t want = referenceMode(mode, src[i], dst[i], opacity);
+                const std::uint32_t got = ImageBuffer::toRgba(d[i]);
+                for (int shift = 0; shift <= 24; shift += 8)
+                {
+                    const int a = static_cast<int>((want >> shift) & 0xFFu);
+                    const int b = static_cast<int>((got >> shift) & 0xFFu);
+                    ASSERT_LE(std::abs(a - b), 1)
+                        << "mode " << static_cast<int>(mode) << " opacity " << opacity
+                        << " pixel " << i << " src " << std::hex << src[i] << " dst " << dst[i];
+                }
+            }
+        }
+    }
+}
+
+TEST(Blend, MultiplyByWhiteAndScreenByBlackKeepDestination)
+{
+    std::vector<Pixel> d(9, ImageBuffer::toPixel(0x4080C0FFu));
+    const std::vector<Pixel> white(9, ImageBuffer::toPixel(0xFFFFFFFFu));
+    const std::vector<Pixel> black(9, ImageBuffer::toPixel(0x000000FFu));
+
+    core::blendRow(core::BlendMode::Multiply, white, d, 1.0f);
+    core::blendRow(core::BlendMode::Screen, black, d, 1.0f);
+    for (const Pixel px : d)
+        EXPECT_EQ(ImageBuffer::toRgba(px), 0x4080C0FFu);
+
+    core::blendRow(core::BlendMode::Multiply, black, d, 1.0f);
+    for (const Pixel px : d)
+        EXPECT_EQ(ImageBuffer::toRgba(px), 0x000000FFu);
+}
+
+TEST(Blend, PremultipliedArgbRowRoundsLikeQt)
+{
+    const std::vector<Pixel> src = {ImageBuffer::toPixel(0x10203FFFu),
+                                    ImageBuffer::toPixel(0xFF804000u),
+                                    ImageBuffer::toPixel(0xFF800180u)};
+    std::vector<std::uint32_t> dst(src.size());
+    core::premultiplyToArgb32Row(src, dst.data());
+
+    EXPECT_EQ(dst[0], 0xFF10203Fu);
+    EXPECT_EQ(dst[1], 0x00000000u);
+    // 255 * 128 / 255 = 128, 128 * 128 / 255 = 64.25 -> 64, 1 * 128 / 255 = 0.5 -> 1
+    EXPECT_EQ(dst[2], 0x80804001u);
+}
@@ -0,0 +1,103 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "core/BrushTip.hpp"
+
+TEST(BrushTipTest, HardTipIsTheAliasedDisc)
+{
+    for (const int diameter : {1, 2, 5, 8, 31})
+    {
+        const core::BrushTip tip{diameter, 1.f};
+        const double r = diameter * 0.5;
+        EXPECT_EQ(tip.radius(), static_cast<int>(std::ceil(r)));
+        for (int dy = 0; dy < tip.size(); ++dy)
+        {
+            const auto row = tip.row(dy);
+            for (int dx = 0; dx < tip.size(); ++dx)
+            {
+                const double x = dx - tip.radius();
+                const double y = dy - tip.radius();
+                const bool inside = x * x + y * y <= r * r;
+                ASSERT_EQ(row[static_cast<std::size_t>(dx)], inside ? 255u : 0u)
+                    << diameter << ": " << dx << "," << dy;
+                if (inside)
+                {
+                    EXPECT_GE(dx, tip.rowBegin(dy));
+                    EXPECT_LT(dx, tip.rowEnd(dy));
+                }
+            }
+        }
+    }
+}
+
+TEST(BrushTipTest, SoftTipFallsOffFromAFullCenter)
+{
+    const core::BrushTip tip{20, 0.25f};
+    const int c = tip.radius();
+    EXPECT_EQ(tip.row(c)[static_cast<std::size_t>(c)], 255u);
+
+    // symmetric, and never increasing away from the center along a row
+    for (int dy = 0; dy < tip.size(); ++dy)
+    {
+        const auto row = tip.row(dy);
+        for (int dx = 0; dx < tip.size(); ++dx)
+        {
+            EXPECT_EQ(row[static_cast<std::size_t>(dx)],
+                      row[static_cast<std::size_t>(tip.size() - 1 - dx)]);
+            EXPECT_EQ(row[static_cast<std::size_t>(dx)],
+                      tip.row(tip.size() - 1 - dy)[static_cast<std::size_t>(dx)]);
+            if (dx > c)
+            {
+                EXPECT_LE(row[static_cast<std::size_t>(dx)], row[static_cast<std::size_t>(dx - 1)]);
+            }
+        }
+    }
+    // partial coverage on the edge
+    const auto mid = tip.row(c);
+    int partial = 0;
+    for (const std::uint8_t v : mid)
+        partial += v > 0 && v < 255 ? 1 : 0;
+    EXPECT_GT(partial, 4);
+}
+
+TEST(BrushTipTest, GetSharesTipsPerSizeAndHardness)
+{
+    const auto a = core::BrushTip::get(12, 0.5f);
+    EXPECT_EQ(core::BrushTip::get(12, 0.501f), a);
+    EXPECT_NE(core::BrushTip::get(12, 0.6f), a);
+    EXPECT_NE(core::BrushTip::get(13, 0.5f), a);
+}
+
+TEST(BrushTipTest, RaiseCoverageMatchesScalarMax)
+{
+    std::mt19937 rng{7};
+    std::uniform_int_distribution<int> byte{0, 255};
+    for (int n = 1; n <= 64; ++n)
+    {
+        std::array<std::uint8_t, 64> dst{};
+        std::array<std::uint8_t, 64> src{};
+        for (int i = 0; i < 64; ++i)
+        {
+            dst[static_cast<std::size_t>(i)] = static_cast<std::uint8_t>(byte(rng));
+            src[static_cast<std::size_t>(i)] = static_cast<std::uint8_t>(byte(rng));
+        }
+        auto want = dst;
+        std::uint64_t wantBits = 0;
+        for (int i = 0; i < n; ++i)
+            if (src[static_cast<std::size_t>(i)] > want[static_cast<std::size_t>(i)])
+            {
+                want[static_cast<std::size_t>(i)] = src[static_cast<std::size_t>(i)];
+                wantBits |= std::uint64_t{1} << i;
+            }
+
+        EXPECT_EQ(core::raiseCoverage(dst.data(), src.data(), n), wantBits) << n;
+        EXPECT_EQ(dst, want) << n;
+    }
+}
@@ -1,8 +1,18 @@
+#include "core/AlphaMask.hpp"
 #include "core/BucketFill.hpp"
 #include "core/ImageBuffer.hpp"
+#include "core/Selection.hpp"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 using namespace core;
 
 TEST(FloodFillTest, SimpleFillRegion)
@@ -34,10 +44,10 @@ TEST(FloodFillTest, RespectMask)
     const uint32_t C = 0x00FF00FFu;
     buf.fill(A);
 
-    ImageBuffer mask{3, 3};
-    mask.fill(0x00000000u);
+    AlphaMask mask{3, 3};
+    mask.fill(0);
     // only center selected
-    mask.setPixel(1, 1, 0x000000FFu);
+    mask.set(1, 1, 0xFF);
 
     // change center to C
     buf.setPixel(1, 1, C);
@@ -87,8 +97,8 @@ TEST(FloodFillTest, FloodFillWithinMask_ClickOutsideMask_NoOp)
     buf.fill(A);
     buf.setPixel(1, 1, B);
 
-    ImageBuffer mask{3, 3};
-    mask.fill(0x00000000u); // rien sélectionné
+    AlphaMask mask{3, 3};
+    mask.fill(0); // rien sélectionné
 
     floodFillWithinMask(buf, mask, 1, 1, Color{A}); // start pixel not allowed
 
@@ -110,13 +120,13 @@ TEST(FloodFillTest, FloodFillWithinMask_FillsOnlyInsideMask)
             buf.setPixel(x, y, B);
 
     // mask = only a cross inside that region
-    ImageBuffer mask{5, 5};
-    mask.fill(0u);
-    mask.setPixel(2, 1, 0x000000FFu);
-    mask.setPixel(2, 2, 0x000000FFu);
-    mask.setPixel(2, 3, 0x000000FFu);
-    mask.setPixel(1, 2, 0x000000FFu);
-    mask.setPixel(3, 2, 0x000000FFu);
+    AlphaMask mask{5, 5};
+    mask.fill(0);
+    mask.set(2, 1, 0xFF);
+    mask.set(2, 2, 0xFF);
+    mask.set(2, 3, 0xFF);
+    mask.set(1, 2, 0xFF);
+    mask.set(3, 2, 0xFF);
 
     floodFillWithinMask(buf, mask, 2, 2, Color{C});
 
@@ -133,3 +143,393 @@ TEST(FloodFillTest, FloodFillWithinMask_FillsOnlyInsideMask)
     EXPECT_EQ(buf.getPixel(1, 3), B);
     EXPECT_EQ(buf.getPixel(3, 3), B);
 }
+
+static bool referenceMatch(uint32_t a, uint32_t b, const FillCriteria& criteria)
+{
+    int maxDiff = 0;
+    int sumSq = 0;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        const int d = std::abs(static_cast<int>((a >> shift) & 0xFFu) -
+                               static_cast<int>((b >> shift) & 0xFFu));
+        maxDiff = std::max(maxDiff, d);
+        sumSq += d * d;
+    }
+    if (criteria.metric == ColorMetric::Euclidean)
+        return std::sqrt(static_cast<double>(sumSq)) <= criteria.tolerance;
+    return maxDiff <= criteria.tolerance;
+}
+
+// Pixel-by-pixel 4-connected fill, the behavior the scanline version must keep.
+static std::vector<uint8_t> referenceRegion(const ImageBuffer& buf, const AlphaMask* mask,
+                                            int sx, int sy, const FillCriteria& criteria = {})
+{
+    const int w = buf.width();
+    const int h = buf.height();
+    std::vector<uint8_t> region(static_cast<size_t>(w) * static_cast<size_t>(h), 0);
+    const uint32_t target = buf.getPixel(sx, sy);
+    std::vector<std::pair<int, int>> stack{{sx, sy}};
+    while (!stack.empty())
+    {
+        auto [x, y] = stack.back();
+        stack.pop_back();
+        if (x < 0 || y < 0 || x >= w || y >= h)
+            continue;
+        uint8_t& seen = region[static_cast<size_t>(y) * static_cast<size_t>(w) + x];
+        if (seen || !referenceMatch(buf.getPixel(x, y), target, criteria) ||
+            (mask && mask->at(x, y) == 0))
+            continue;
+        seen = 1;
+        stack.insert(stack.end(), {{x + 1, y}, {x - 1, y}, {x, y + 1}, {x, y - 1}});
+    }
+    return region;
+}
+
+TEST(FloodFillTest, ScanlineFillMatchesPixelFillOnNoise)
+{
+    const uint32_t A = 0x000000FFu;
+    const uint32_t B = 0xFF0000FFu;
+    const uint32_t C = 0x00FF00FFu;
+    for (const auto storage : {ImageBuffer::Storage::Linear, ImageBuffer::Storage::Tiled})
+    {
+        // wider than two tiles so runs cross tile edges in the tiled case
+        ImageBuffer buf{150, 70, storage};
+        // bit-packed masks alongside the tiled buffers
+        AlphaMask mask{150, 70,
+                       storage == ImageBuffer::Storage::Tiled ? AlphaMask::Storage::Bits
+                                                              : AlphaMask::Storage::A8};
+        buf.fill(A);
+        mask.fill(0xFF);
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<int> dist(0, 99);
+        for (int y = 0; y < 70; ++y)
+            for (int x = 0; x < 150; ++x)
+            {
+                if (dist(rng) < 35)
+                    buf.setPixel(x, y, B);
+                if (dist(rng) < 10)
+                    mask.set(x, y, 0);
+            }
+        mask.set(75, 35, 0xFF);
+        buf.setPixel(75, 35, A);
+
+        const AlphaMask* const masks[] = {nullptr, &mask};
+        for (const AlphaMask* m : masks)
+        {
+            const auto want = referenceRegion(buf, m, 75, 35);
+
+            const auto region = m ? floodFillWithinMaskCollect(buf, *m, 75, 35, Color{C})
+                                  : floodFillCollect(buf, 75, 35, Color{C});
+            EXPECT_EQ(region.color.value, C);
+            std::vector<uint8_t> got(want.size(), 0);
+            size_t count = 0;
+            for (int y = 0; y < 70; ++y)
+                for (int x = 0; x < 150; ++x)
+                    if (region.contains(x, y))
+                    {
+                        got[static_cast<size_t>(y) * 150 + x] = 1;
+                        ++count;
+                    }
+            EXPECT_EQ(count, region.count);
+            EXPECT_EQ(got, want);
+
+            ImageBuffer filled = buf;
+            if (m)
+                floodFillWithinMask(filled, *m, 75, 35, Color{C});
+            else
+                floodFill(filled, 75, 35, Color{C});
+            for (int y = 0; y < 70; ++y)
+                for (int x = 0; x < 150; ++x)
+                    ASSERT_EQ(filled.getPixel(x, y),
+                              want[static_cast<size_t>(y) * 150 + x] ? C : buf.getPixel(x, y))
+                        << x << "," << y;
+        }
+    }
+}
+
+TEST(FloodFillTest, CollectRegionRunsAndFill)
+{
+    // 130 px wide region so runs span several 64-bit words
+    ImageBuffer buf{140, 4};
+    const uint32_t A = 0x000000FFu;
+    const uint32_t B = 0xFF0000FFu;
+    const uint32_t C = 0x00FF00FFu;
+    buf.fill(B);
+    for (int x = 5; x < 135; ++x)
+        buf.setPixel(x, 1, A);
+    buf.setPixel(70, 2, A);
+    buf.setPixel(70, 1, B);
+
+    const auto region = floodFillCollect(buf, 5, 1, Color{C});
+    EXPECT_EQ(region.bounds.x, 5);
+    EXPECT_EQ(region.bounds.y, 1);
+    EXPECT_EQ(region.bounds.w, 65);
+    EXPECT_EQ(region.bounds.h, 1);
+    EXPECT_EQ(region.count, 65u);
+
+    const auto other = floodFillCollect(buf, 134, 1, Color{C});
+    std::vector<std::tuple<int, int, int>> runs;
+    other.forEachRun([&](int x0, int x1, int y) { runs.emplace_back(x0, x1, y); });
+    ASSERT_EQ(runs.size(), 1u);
+    EXPECT_EQ(runs[0], std::make_tuple(71, 135, 1));
+
+    ImageBuffer filled = buf;
+    fillRegion(filled, region);
+    EXPECT_EQ(filled.getPixel(5, 1), C);
+    EXPECT_EQ(filled.getPixel(69, 1), C);
+    EXPECT_EQ(filled.getPixel(70, 1), B);
+    EXPECT_EQ(filled.getPixel(71, 1), A);
+    EXPECT_EQ(filled.getPixel(70, 2), A);
+}
+
+TEST(FloodFillTest, ParallelLabelingMatchesSerialFill)
+{
+    const uint32_t A = 0x000000FFu;
+    const uint32_t B = 0xFF0000FFu;
+    const uint32_t C = 0x00FF00FFu;
+    // several label tiles per axis, with ragged last tiles
+    ImageBuffer buf{700, 530};
+    buf.fill(A);
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> dist(0, 99);
+    for (int y = 0; y < 530; ++y)
+        for (int x = 0; x < 700; ++x)
+            if (dist(rng) < 30)
+                buf.setPixel(x, y, B);
+    // a comb whose teeth are only joined far from the seed, across tile borders
+    for (int y = 0; y < 520; ++y)
+        for (int x = 0; x < 700; x += 90)
+            buf.setPixel(x, y, B);
+    buf.setPixel(5, 5, A);
+    AlphaMask mask{700, 530};
+    mask.fill(0xFF);
+    for (int y = 0; y < 400; ++y)
+        for (int x = 300; x < 340; ++x)
+            mask.set(x, y, 0);
+
+    const auto serial = floodFillCollect(buf, 5, 5, Color{C});
+    const auto serialMasked = floodFillWithinMaskCollect(buf, mask, 5, 5, Color{C});
+    ASSERT_GT(serial.count, static_cast<size_t>(700 * 530 / 4));
+    ASSERT_GT(serialMasked.count, static_cast<size_t>(700 * 530 / 4));
+
+    setParallelFillThreshold(0);
+    const auto parallel = floodFillCollect(buf, 5, 5, Color{C});
+    const auto parallelMasked = floodFillWithinMaskCollect(buf, mask, 5, 5, Color{C});
+    ImageBuffer filled = buf;
+    floodFill(filled, 5, 5, Color{C});
+    setParallelFillThreshold(size_t{1} << 20);
+
+    EXPECT_EQ(parallel.count, serial.count);
+    EXPECT_EQ(parallel.bits, serial.bits);
+    EXPECT_EQ(parallel.bounds.x, serial.bounds.x);
+    EXPECT_EQ(parallel.bounds.y, serial.bounds.y);
+    EXPECT_EQ(parallel.bounds.w, serial.bounds.w);
+    EXPECT_EQ(parallel.bounds.h, serial.bounds.h);
+    EXPECT_EQ(parallelMasked.count, serialMasked.count);
+    EXPECT_EQ(parallelMasked.bits, serialMasked.bits);
+
+    ImageBuffer serialFilled = buf;
+    fillRegion(serialFilled, serial);
+    for (int y = 0; y < 530; ++y)
+        for (int x = 0; x < 700; ++x)
+            ASSERT_EQ(filled.getPixel(x, y), serialFilled.getPixel(x, y)) << x << "," << y;
+}
+
+TEST(FloodFillTest, ToleranceMatchesReferenceForBothMetrics)
+{
+    // channels scattered around a base color so every distance is represented
+    ImageBuffer buf{133, 61};
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> jitter(-40, 40);
+    const auto channel = [&](int base)
+    { return static_cast<uint32_t>(std::clamp(base + jitter(rng), 0, 255)); };
+    for (int y = 0; y < 61; ++y)
+        for (int x = 0; x < 133; ++x)
+            buf.setPixel(x, y,
+                         channel(120) << 24 | channel(60) << 16 | channel(200) << 8 | channel(230));
+    buf.setPixel(60, 30, 0x783CC8E6u);
+    AlphaMask mask{133, 61};
+    mask.fill(0xFF);
+    for (int x = 0; x < 133; ++x)
+        mask.set(x, 10, 0);
+
+    const uint32_t C = 0x00FF00FFu;
+    for (const auto metric : {ColorMetric::MaxChannel, ColorMetric::Euclidean})
+        for (const int tolerance : {0, 12, 25, 40, 255})
+        {
+            const FillCriteria criteria{tolerance, metric};
+            const auto want = referenceRegion(buf, &mask, 60, 30, criteria);
+
+            const auto region = floodFillWithinMaskCollect(buf, mask, 60, 30, Color{C}, criteria);
+            std::vector<uint8_t> got(want.size(), 0);
+            for (int y = 0; y < 61; ++y)
+                for (int x = 0; x < 133; ++x)
+                    got[static_cast<size_t>(y) * 133 + x] = region.contains(x, y) ? 1 : 0;
+            EXPECT_EQ(got, want) << "tolerance " << tolerance << " metric "
+                                 << static_cast<int>(metric);
+
+            ImageBuffer filled = buf;
+            floodFillWithinMask(filled, mask, 60, 30, Color{C}, criteria);
+            for (int y = 0; y < 61; ++y)
+                for (int x = 0; x < 133; ++x)
+                    ASSERT_EQ(filled.getPixel(x, y),
+                              want[static_cast<size_t>(y) * 133 + x] ? C : buf.getPixel(x, y));
+        }
+}
+
+TEST(FloodFillTest, ToleranceFillsNeighboursOfSeedAlreadyAtNewColor)
+{
+    ImageBuffer buf{4, 1};
+    buf.fill(0x101010FFu);
+    buf.setPixel(1, 0, 0x121212FFu);
+    buf.setPixel(3, 0, 0x909090FFu);
+
+    floodFill(buf, 0, 0, Color{0x101010FFu}, FillCriteria{4, ColorMetric::MaxChannel});
+
+    EXPECT_EQ(buf.getPixel(1, 0), 0x101010FFu);
+    EXPECT_EQ(buf.getPixel(3, 0), 0x909090FFu);
+}
+
+TEST(FloodFillTest, RepeatedFillsOnDifferentImagesMatchReference)
+{
+    // the visited set is reused between fills: nothing may leak from one image to the next
+    const uint32_t A = 0x000000FFu;
+    const uint32_t B = 0xFF0000FFu;
+    const uint32_t C = 0x00FF00FFu;
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> dist(0, 99);
+    for (const auto& [w, h] : {std::pair{200, 150}, std::pair{70, 300}, std::pair{200, 150},
+                               std::pair{129, 65}})
+    {
+        ImageBuffer buf{w, h};
+        buf.fill(A);
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+                if (dist(rng) < 35)
+                    buf.setPixel(x, y, B);
+        buf.setPixel(w / 2, h / 2, A);
+
+        const auto want = referenceRegion(buf, nullptr, w / 2, h / 2);
+        const auto region = floodFillCollect(buf, w / 2, h / 2, Color{C});
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+                ASSERT_EQ(region.contains(x, y) ? 1 : 0,
+                          want[static_cast<size_t>(y) * static_cast<size_t>(w) + x])
+                    << w << "x" << h << " at " << x << "," << y;
+    }
+}
+
+TEST(FloodFillTest, LazyCollectLoadsOnlyReachedTiles)
+{
+    const uint32_t A = 0x000000FFu;
+    const uint32_t B = 0xFF0000FFu;
+    const uint32_t C = 0x00FF00FFu;
+    // a wall at x = 100 keeps the region inside the first two tile columns
+    ImageBuffer source{300, 200};
+    source.fill(A);
+    for (int y = 0; y < 200; ++y)
+        source.setPixel(100, y, B);
+    for (int x = 10; x < 90; ++x)
+        source.setPixel(x, 70, B);
+
+    ImageBuffer lazy{300, 200, ImageBuffer::Storage::Tiled};
+    std::vector<std::pair<int, int>> loaded;
+    const auto load = [&](int tx, int ty)
+    {
+        loaded.emplace_back(tx, ty);
+        const common::Rect r = lazy.tileRect(tx, ty);
+        for (int y = r.y; y < r.y + r.h; ++y)
+            for (int x = r.x; x < r.x + r.w; ++x)
+                lazy.setPixel(x, y, source.getPixel(x, y));
+    };
+
+    const auto want = floodFillCollect(source, 5, 5, Color{C});
+    const auto got = floodFillCollectLazy(lazy, load, nullptr, 5, 5, Color{C});
+    EXPECT_EQ(got.count, want.count);
+    EXPECT_EQ(got.bits, want.bits);
+    EXPECT_EQ(got.bounds.w, want.bounds.w);
+
+    // columns 0 and 1 (the wall lives in column 1), never column 2, each tile once
+    std::sort(loaded.begin(), loaded.end());
+    EXPECT_EQ(std::adjacent_find(loaded.begin(), loaded.end()), loaded.end());
+    for (const auto& [tx, ty] : loaded)
+        EXPECT_LT(tx, 2);
+    EXPECT_EQ(loaded.size(), 8u);
+}
+
+TEST(FloodFillTest, LazyCollectOfALargeRegionLoadsOnlyReachedTiles)
+{
+    const uint32_t A = 0x000000FFu;
+    const uint32_t B = 0xFF0000FFu;
+    const uint32_t C = 0x00FF00FFu;
+    // 10 x 4 tiles; a wall at x = 460 leaves ~70% of the document to the fill, well past the
+    // point where a non-lazy collect would switch to parallel labeling
+    ImageBuffer source{640, 256};
+    source.fill(A);
+    for (int y = 0; y < 256; ++y)
+        source.setPixel(460, y, B);
+
+    ImageBuffer lazy{640, 256, ImageBuffer::Storage::Tiled};
+    std::vector<std::pair<int, int>> loaded;
+    const auto load = [&](int tx, int ty)
+    {
+        loaded.emplace_back(tx, ty);
+        const common::Rect r = lazy.tileRect(tx, ty);
+        for (int y = r.y; y < r.y + r.h; ++y)
+            for (int x = r.x; x < r.x + r.w; ++x)
+                lazy.setPixel(x, y, source.getPixel(x, y));
+    };
+
+    const auto want = floodFillCollect(source, 5, 5, Color{C});
+    const auto got = floodFillCollectLazy(lazy, load, nullptr, 5, 5, Color{C});
+    EXPECT_EQ(got.count, 460u * 256u);
+    EXPECT_EQ(got.count, want.count);
+    EXPECT_EQ(got.bits, want.bits);
+
+    // columns 0 to 7 (the wall lives in column 7), never the last two, each tile once
+    std::sort(loaded.begin(), loaded.end());
+    EXPECT_EQ(std::adjacent_find(loaded.begin(), loaded.end()), loaded.end());
+    for (const auto& [tx, ty] : loaded)
+        EXPECT_LT(tx, 8);
+    EXPECT_EQ(loaded.size(), 32u);
+}
+
+TEST(FloodFillTest, WithinMaskReadsTheMaskAtAnOffset)
+{
+    const uint32_t A = 0x000000FFu;
+    const uint32_t C = 0x00FF00FFu;
+    // a 4x2 buffer sitting at (3, 1) in a 10x5 mask that covers x < 5
+    ImageBuffer buf{4, 2};
+    buf.fill(A);
+    AlphaMask mask{10, 5};
+    mask.fillRect(common::Rect{0, 0, 5, 5}, 0xFF);
+
+    floodFillWithinMask(buf, mask, 0, 0, Color{C}, {}, common::Point{3, 1});
+    for (int y = 0; y < 2; ++y)
+        for (int x = 0; x < 4; ++x)
+            EXPECT_EQ(buf.getPixel(x, y), x < 2 ? C : A) << x << "," << y;
+
+    // off the mask is not covered
+    const auto region = floodFillWithinMaskCollect(buf, mask, 3, 0, Color{A}, {},
+                                                   common::Point{8, 4});
+    EXPECT_TRUE(region.empty());
+}
+
+TEST(FloodFillTest, WithinSelectionMatchesWithinMask)
+{
+    const uint32_t A = 0x000000FFu;
+    const uint32_t C = 0x00FF00FFu;
+    ImageBuffer buf{100, 50};
+    buf.fill(A);
+    Selection sel;
+    sel.addRect(common::Rect{10, 5, 150, 30}, 200, 80);
+    sel.subtractRect(common::Rect{60, 0, 4, 22});
+
+    const common::Point offset{20, 10};
+    const SelectionView view = sel.view(offset, 100, 50);
+    const auto want = floodFillWithinMaskCollect(buf, *sel.mask(), 5, 5, Color{C}, {}, offset);
+    const auto got = floodFillWithinSelectionCollect(buf, view, 5, 5, Color{C});
+    EXPECT_GT(want.count, 0u);
+    EXPECT_EQ(got.count, want.count);
+    EXPECT_EQ(got.bits, want.bits);
+}
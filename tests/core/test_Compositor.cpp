@@ -2,8 +2,11 @@
 // Created by apolline on 09/01/2026.
 //
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <memory>
+#include <vector>
 
+#include "core/Blend.hpp"
 #include "core/Compositor.hpp"
 #include "core/Document.hpp"
 #include "core/Layer.hpp"
@@ -197,3 +200,180 @@ TEST(Compositor, OffsetLayer_IsCompositedAtCorrectDocPosition)
     EXPECT_EQ(out.getPixel(0, 0), 0x000000FFu);
 }
 
+
+TEST(Compositor, TiledLayerMatchesLinearLayer)
+{
+    auto compose = [](ImageBuffer::Storage storage)
+    {
+        Document doc(150, 90, 72.f);
+        auto bgImg = std::make_shared<ImageBuffer>(150, 90);
+        bgImg->fill(rgba(0x20, 0x40, 0x60, 0xFF));
+        doc.addLayer(std::make_shared<Layer>(0, "bg", bgImg));
+
+        auto img = std::make_shared<ImageBuffer>(120, 80, storage);
+        img->setPixel(3, 3, rgba(0xFF, 0x00, 0x00, 0x80));
+        img->setPixel(100, 70, rgba(0x00, 0xFF, 0x00, 0xFF));
+        auto layer = std::make_shared<Layer>(1, "L1", img, true, false, 0.5f);
+        layer->setOffset(20, 5);
+        doc.addLayer(layer);
+
+        ImageBuffer out(150, 90);
+        Compositor::compose(doc, out);
+        return out;
+    };
+
+    const ImageBuffer linear = compose(ImageBuffer::Storage::Linear);
+    const ImageBuffer tiled = compose(ImageBuffer::Storage::Tiled);
+    for (int y = 0; y < 90; ++y)
+        for (int x = 0; x < 150; ++x)
+            ASSERT_EQ(tiled.getPixel(x, y), linear.getPixel(x, y)) << x << "," << y;
+}
+
+TEST(Compositor, OutputDoesNotDependOnThreadCount)
+{
+    Document doc(301, 257, 72.f);
+    std::uint32_t seed = 12345u;
+    for (std::uint64_t id = 0; id < 6; ++id)
+    {
+        auto img = std::make_shared<ImageBuffer>(200, 190);
+        for (int y = 0; y < img->height(); ++y)
+            for (int x = 0; x < img->width(); ++x)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                img->setPixel(x, y, seed);
+            }
+        auto layer = std::make_shared<Layer>(id, "L", img, true, false, 0.3f + 0.1f * id);
+        layer->setOffset(static_cast<int>(id) * 23 - 20, static_cast<int>(id) * 17 - 10);
+        doc.addLayer(layer);
+    }
+
+    auto render = [&](unsigned threads)
+    {
+        Compositor::setThreadCount(threads);
+        ImageBuffer out(301, 257);
+        Compositor::compose(doc, out);
+        return out;
+    };
+
+    const ImageBuffer reference = render(1);
+    for (const unsigned threads : {2u, 3u, 8u})
+    {
+        const ImageBuffer out = render(threads);
+        EXPECT_EQ(Compositor::threadCount(), threads);
+        ASSERT_TRUE(std::equal(reference.data(), reference.data() + 301 * 257 * 4, out.data()))
+            << threads << " threads";
+    }
+
+    Compositor::setThreadCount(4);
+    ImageBuffer roi(50, 120);
+    Compositor::composeROI(doc, 40, 60, 50, 120, roi);
+    for (int y = 0; y < 120; ++y)
+        for (int x = 0; x < 50; ++x)
+            ASSERT_EQ(roi.getPixel(x, y), reference.getPixel(x + 40, y + 60)) << x << "," << y;
+
+    Compositor::setThreadCount(0);
+}
+
+TEST(Compositor, LayerBlendModeIsApplied)
+{
+    Document doc(2, 1);
+    doc.addLayer(makeSolidLayer(0, "bg", 2, 1, rgba(200, 100, 50, 255)));
+    auto top = makeSolidLayer(1, "multiply", 1, 1, rgba(128, 255, 0, 255));
+    top->setBlendMode(core::BlendMode::Multiply);
+    doc.addLayer(top);
+
+    ImageBuffer out(2, 1);
+    Compositor::compose(doc, out);
+
+    EXPECT_EQ(out.getPixel(0, 0), rgba(100, 100, 0, 255));
+    EXPECT_EQ(out.getPixel(1, 0), rgba(200, 100, 50, 255));
+}
+
+TEST(Compositor, OpaqueLayerCullingKeepsOutputIdentical)
+{
+    Document doc(200, 150);
+    std::uint32_t seed = 7u;
+    const auto randomLayer = [&](std::uint64_t id, int w, int h)
+    {
+        auto img = std::make_shared<ImageBuffer>(w, h);
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                img->setPixel(x, y, seed);
+            }
+        return std::make_shared<Layer>(id, "L", img);
+    };
+
+    doc.addLayer(randomLayer(0, 200, 150));
+    doc.addLayer(randomLayer(1, 120, 90));
+    auto photo = makeSolidLayer(2, "photo", 130, 100, rgba(90, 60, 30, 255));
+    photo->image()->setPixel(70, 40, rgba(255, 255, 255, 10));  // one hole in the cover
+    photo->setOffset(20, 30);
+    doc.addLayer(photo);
+    auto glaze = randomLayer(3, 60, 60);
+    glaze->setOffset(100, 50);
+    glaze->setOpacity(0.5f);
+    doc.addLayer(glaze);
+
+    ImageBuffer out(200, 150);
+    Compositor::compose(doc, out);
+
+    // reference: every layer blended pixel by pixel, nothing skipped
+    ImageBuffer ref(200, 150);
+    for (std::size_t i = 0; i < doc.layerCount(); ++i)
+    {
+        const auto layer = doc.layerAt(i);
+        const auto& img = *layer->image();
+        for (int y = 0; y < img.height(); ++y)
+            for (int x = 0; x < img.width(); ++x)
+            {
+                const int dx = x + layer->offsetX();
+                const int dy = y + layer->offsetY();
+                if (dx < 0 || dy < 0 || dx >= 200 || dy >= 150)
+                    continue;
+                const ImageBuffer::Pixel src = img.pixel(x, y);
+                ImageBuffer::Pixel dst = ref.pixel(dx, dy);
+                core::blendRow(layer->blendMode(), {&src, 1}, {&dst, 1}, layer->opacity());
+                ref.setPixelRaw(dx, dy, dst);
+            }
+    }
+
+    for (int y = 0; y < 150; ++y)
+        for (int x = 0; x < 200; ++x)
+            ASSERT_EQ(out.getPixel(x, y), ref.getPixel(x, y)) << x << "," << y;
+}
+
+TEST(Compositor, ComposeIntoWritesPremultipliedFramebuffer)
+{
+    Document doc(70, 40);
+    doc.addLayer(makeSolidLayer(0, "bg", 70, 40, rgba(10, 20, 30, 128)));
+    auto top = makeSolidLayer(1, "top", 20, 20, rgba(200, 100, 50, 255));
+    top->setOffset(30, 10);
+    doc.addLayer(top);
+
+    ImageBuffer straight(70, 40);
+    Compositor::compose(doc, straight);
+
+    // framebuffer with a larger stride, only the 50x30 area at (5, 4) is written
+    constexpr std::ptrdiff_t kStride = 80;
+    std::vector<std::uint32_t> frame(static_cast<std::size_t>(kStride) * 40, 0xDEADBEEFu);
+    Compositor::composeInto(doc, 5, 4,
+                            Compositor::PremultipliedTarget{frame.data() + 4 * kStride + 5, 50,
+                                                            30, kStride});
+
+    for (int y = 0; y < 40; ++y)
+        for (int x = 0; x < 70; ++x)
+        {
+            const std::uint32_t got = frame[static_cast<std::size_t>(y * kStride + x)];
+            if (x < 5 || x >= 55 || y < 4 || y >= 34)
+            {
+                ASSERT_EQ(got, 0xDEADBEEFu) << x << "," << y;
+                continue;
+            }
+            std::uint32_t want = 0;
+            const ImageBuffer::Pixel px = straight.pixel(x, y);
+            core::premultiplyToArgb32Row({&px, 1}, &want);
+            ASSERT_EQ(got, want) << x << "," << y;
+        }
+}
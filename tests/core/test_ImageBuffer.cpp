@@ -2,6 +2,11 @@
 // Created by apolline on 17/11/2025.
 //
 #include <gtest/gtest.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include "core/ImageBuffer.hpp"
 
 TEST(ImageBufferTest, HasCorrectDimensions)
@@ -73,4 +78,183 @@ TEST(ImageBufferTest, DataPointerIsNotNullAndConsistent)
 
     EXPECT_NE(p1, nullptr);
     EXPECT_EQ(p1, p2);
-}
\ No newline at end of file
+}
+TEST(ImageBufferTest, TiledBufferStartsWithoutStorage)
+{
+    const ImageBuffer buffer{200, 130, ImageBuffer::Storage::Tiled};
+
+    EXPECT_TRUE(buffer.isTiled());
+    EXPECT_EQ(buffer.tileColumns(), 4);
+    EXPECT_EQ(buffer.tileRows(), 3);
+    EXPECT_EQ(buffer.allocatedTileCount(), 0u);
+    EXPECT_EQ(buffer.data(), nullptr);
+    EXPECT_EQ(buffer.getPixel(199, 129), 0u);
+}
+
+TEST(ImageBufferTest, TiledSetPixelOnlyAllocatesTouchedTile)
+{
+    ImageBuffer buffer{200, 130, ImageBuffer::Storage::Tiled};
+    constexpr uint32_t color = 0x11223344u;
+
+    buffer.setPixel(70, 10, color);
+    buffer.setPixel(5, 5, 0u);  // same as background: nothing to store
+
+    EXPECT_EQ(buffer.allocatedTileCount(), 1u);
+    EXPECT_TRUE(buffer.isTileAllocated(1, 0));
+    EXPECT_FALSE(buffer.isTileAllocated(0, 0));
+    EXPECT_EQ(buffer.getPixel(70, 10), color);
+    EXPECT_EQ(buffer.getPixel(71, 10), 0u);
+}
+
+TEST(ImageBufferTest, TiledFillReleasesTilesAndBecomesBackground)
+{
+    ImageBuffer buffer{100, 100, ImageBuffer::Storage::Tiled};
+    buffer.setPixel(99, 99, 0xFFFFFFFFu);
+    constexpr uint32_t red = 0xFF0000FFu;
+
+    buffer.fill(red);
+
+    EXPECT_EQ(buffer.allocatedTileCount(), 0u);
+    EXPECT_EQ(buffer.background(), red);
+    EXPECT_EQ(buffer.getPixel(99, 99), red);
+
+    buffer.setPixel(0, 0, 0u);
+    EXPECT_EQ(buffer.getPixel(1, 0), red);
+}
+
+TEST(ImageBufferTest, ForEachAllocatedTileVisitsOnlyAllocatedAreas)
+{
+    ImageBuffer buffer{256, 256, ImageBuffer::Storage::Tiled};
+    buffer.setPixel(10, 10, 0x000000FFu);
+    buffer.setPixel(200, 130, 0x000000FFu);
+
+    std::vector<common::Rect> visited;
+    buffer.forEachAllocatedTile(common::Rect{0, 0, 256, 256},
+                                [&](const common::Rect& r) { visited.push_back(r); });
+    ASSERT_EQ(visited.size(), 2u);
+    EXPECT_EQ(visited[0].x, 0);
+    EXPECT_EQ(visited[0].w, 64);
+    EXPECT_EQ(visited[1].x, 192);
+    EXPECT_EQ(visited[1].y, 128);
+
+    // areas are clipped to the query
+    visited.clear();
+    buffer.forEachAllocatedTile(common::Rect{5, 5, 10, 10},
+                                [&](const common::Rect& r) { visited.push_back(r); });
+    ASSERT_EQ(visited.size(), 1u);
+    EXPECT_EQ(visited[0].x, 5);
+    EXPECT_EQ(visited[0].w, 10);
+}
+
+TEST(ImageBufferTest, TiledToLinearKeepsPixels)
+{
+    ImageBuffer tiled{70, 3, ImageBuffer::Storage::Tiled};
+    tiled.fill(0x000000FFu);
+    tiled.setPixel(69, 2, 0x12345678u);
+
+    const ImageBuffer linear = tiled.toLinear();
+
+    EXPECT_FALSE(linear.isTiled());
+    ASSERT_NE(linear.data(), nullptr);
+    EXPECT_EQ(linear.getPixel(0, 0), 0x000000FFu);
+    EXPECT_EQ(linear.getPixel(69, 2), 0x12345678u);
+}
+
+TEST(ImageBufferTest, PixelKeepsRgbaByteOrderInMemory)
+{
+    ImageBuffer buffer{2, 1};
+    buffer.setPixel(1, 0, 0x11223344u);
+
+    const uint8_t* bytes = buffer.data();
+    EXPECT_EQ(bytes[4], 0x11);
+    EXPECT_EQ(bytes[5], 0x22);
+    EXPECT_EQ(bytes[6], 0x33);
+    EXPECT_EQ(bytes[7], 0x44);
+
+    EXPECT_EQ(buffer.pixel(1, 0), ImageBuffer::toPixel(0x11223344u));
+    EXPECT_EQ(ImageBuffer::toRgba(buffer.row(0)[1]), 0x11223344u);
+}
+
+TEST(ImageBufferTest, RowWritesAreVisibleThroughGetPixel)
+{
+    ImageBuffer buffer{4, 2};
+    auto row = buffer.row(1);
+    std::fill(row.begin(), row.end(), ImageBuffer::toPixel(0xAABBCCDDu));
+
+    EXPECT_EQ(buffer.getPixel(0, 0), 0u);
+    EXPECT_EQ(buffer.getPixel(3, 1), 0xAABBCCDDu);
+}
+
+TEST(ImageBufferTest, RunLengthStopsAtTileEdgeWhenTiled)
+{
+    const ImageBuffer linear{100, 1};
+    const ImageBuffer tiled{100, 1, ImageBuffer::Storage::Tiled};
+
+    EXPECT_EQ(linear.runLength(10, 1000), 90);
+    EXPECT_EQ(linear.runLength(10, 5), 5);
+    EXPECT_EQ(tiled.runLength(10, 1000), 54);
+    EXPECT_EQ(tiled.runLength(64, 1000), 36);
+}
+
+TEST(ImageBufferTest, TiledSpansReadBackgroundAndAllocateOnWrite)
+{
+    ImageBuffer tiled{128, 2, ImageBuffer::Storage::Tiled};
+    tiled.fill(0x000000FFu);
+
+    const auto blank = std::as_const(tiled).span(64, 1, 64);
+    EXPECT_EQ(blank.size(), 64u);
+    EXPECT_EQ(ImageBuffer::toRgba(blank[10]), 0x000000FFu);
+    EXPECT_EQ(tiled.allocatedTileCount(), 0u);
+
+    auto run = tiled.span(70, 1, 4);
+    run[0] = ImageBuffer::toPixel(0xFF0000FFu);
+    EXPECT_TRUE(tiled.isTileAllocated(1, 0));
+    EXPECT_FALSE(tiled.isTileAllocated(0, 0));
+    EXPECT_EQ(tiled.getPixel(70, 1), 0xFF0000FFu);
+    EXPECT_EQ(tiled.getPixel(71, 1), 0x000000FFu);
+}
+
+TEST(ImageBufferTest, WritesBumpRevisionAndCopiesGetNewId)
+{
+    ImageBuffer img(4, 4);
+    const auto rev = img.revision();
+
+    (void)std::as_const(img).getPixel(1, 1);
+    (void)std::as_const(img).span(0, 0, 4);
+    EXPECT_EQ(img.revision(), rev);
+
+    img.setPixel(1, 1, 0x11223344u);
+    EXPECT_GT(img.revision(), rev);
+
+    const ImageBuffer copy = img;
+    EXPECT_NE(copy.id(), img.id());
+
+    ImageBuffer other(2, 2);
+    const auto otherId = other.id();
+    other = img;
+    EXPECT_NE(other.id(), otherId);
+    EXPECT_NE(other.id(), img.id());
+}
+
+TEST(ImageBufferTest, OpaqueTilesFollowWrites)
+{
+    ImageBuffer img(100, 70);
+    img.fill(0x102030FFu);
+    const auto& opaque = img.opaqueTiles();
+    ASSERT_EQ(opaque.size(), 4u);
+    EXPECT_EQ(std::count(opaque.begin(), opaque.end(), 1), 4);
+
+    img.setPixel(70, 5, 0x10203080u);
+    const auto& after = img.opaqueTiles();
+    EXPECT_EQ(after[0], 1);
+    EXPECT_EQ(after[1], 0);
+
+    ImageBuffer tiled(100, 70, ImageBuffer::Storage::Tiled);
+    tiled.fill(0x000000FFu);
+    tiled.setPixel(3, 66, 0u);
+    const auto& t = tiled.opaqueTiles();
+    EXPECT_EQ(t[0], 1);
+    EXPECT_EQ(t[1], 1);
+    EXPECT_EQ(t[2], 0);
+    EXPECT_EQ(t[3], 1);
+}
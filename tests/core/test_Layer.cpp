@@ -126,6 +126,15 @@ TEST(LayerTest, OpacityValuesAreClampedBetweenZeroAndOne)
     EXPECT_FLOAT_EQ(layer.opacity(), 1.0f);
 }
 
+TEST(LayerTest, BlendModeDefaultsToNormalAndIsMutable)
+{
+    Layer layer{3, "blend-test", make_shared<ImageBuffer>(2, 2)};
+    EXPECT_EQ(layer.blendMode(), core::BlendMode::Normal);
+
+    layer.setBlendMode(core::BlendMode::Overlay);
+    EXPECT_EQ(layer.blendMode(), core::BlendMode::Overlay);
+}
+
 TEST(LayerTest, ImageSharedPtrIsKeptAndCanBeShared)
 {
     constexpr std::uint64_t id1 = 10;
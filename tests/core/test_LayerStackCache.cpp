@@ -0,0 +1,171 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "core/Compositor.hpp"
+#include "core/Document.hpp"
+#include "core/ImageBuffer.hpp"
+#include "core/Layer.hpp"
+#include "core/LayerStackCache.hpp"
+
+static std::shared_ptr<Layer> addLayer(Document& doc, std::uint64_t id, int w, int h,
+                                       std::uint32_t color)
+{
+    auto img = std::make_shared<ImageBuffer>(w, h);
+    img->fill(color);
+    auto layer = std::make_shared<Layer>(id, "L", img);
+    doc.addLayer(layer);
+    return layer;
+}
+
+// 5 layers, partly transparent, the middle one (index 2) being the active one.
+static Document makeStack()
+{
+    Document doc(48, 40);
+    addLayer(doc, 0, 48, 40, 0x204060FFu);
+    addLayer(doc, 1, 20, 20, 0xC0302080u)->setOffset(3, 4);
+    addLayer(doc, 2, 24, 16, 0x30C040B0u)->setOffset(10, 12);
+    addLayer(doc, 3, 30, 10, 0x8080F060u)->setOffset(8, 20);
+    auto top = addLayer(doc, 4, 12, 12, 0xFFFF00FFu);
+    top->setOffset(30, 2);
+    top->setOpacity(0.4f);
+    return doc;
+}
+
+static int maxChannelDiff(const ImageBuffer& a, const ImageBuffer& b)
+{
+    int diff = 0;
+    for (int y = 0; y < a.height(); ++y)
+        for (int x = 0; x < a.width(); ++x)
+            for (int shift = 0; shift <= 24; shift += 8)
+            {
+                const int ca = static_cast<int>((a.getPixel(x, y) >> shift) & 0xFFu);
+                const int cb = static_cast<int>((b.getPixel(x, y) >> shift) & 0xFFu);
+                diff = std::max(diff, std::abs(ca - cb));
+            }
+    return diff;
+}
+
+TEST(LayerStackCache, TopActiveLayerMatchesCompositorExactly)
+{
+    Document doc = makeStack();
+    LayerStackCache cache;
+    cache.build(doc, doc.layerCount() - 1);
+    EXPECT_NE(cache.below(), nullptr);
+    EXPECT_EQ(cache.above(), nullptr);
+
+    ImageBuffer want(20, 18);
+    ImageBuffer got(20, 18);
+    Compositor::composeROI(doc, 25, 0, 20, 18, want);
+    cache.composeROI(doc, 25, 0, 20, 18, got);
+    EXPECT_EQ(maxChannelDiff(want, got), 0);
+}
+
+TEST(LayerStackCache, MiddleActiveLayerMatchesCompositorWithinRounding)
+{
+    Document doc = makeStack();
+    LayerStackCache cache;
+    cache.build(doc, 2);
+    ASSERT_NE(cache.above(), nullptr);
+
+    // the active layer keeps changing: the cache stays valid and follows it
+    doc.layerAt(2)->setOffset(14, 9);
+    doc.layerAt(2)->setOpacity(0.7f);
+    doc.layerAt(2)->image()->setPixel(0, 0, 0x000000FFu);
+    ASSERT_TRUE(cache.isValid(doc, 2));
+
+    ImageBuffer want(48, 40);
+    ImageBuffer got(48, 40);
+    Compositor::compose(doc, want);
+    cache.composeROI(doc, 0, 0, 48, 40, got);
+    EXPECT_LE(maxChannelDiff(want, got), 2);
+}
+
+TEST(LayerStackCache, ChangesOutsideActiveLayerInvalidate)
+{
+    Document doc = makeStack();
+    LayerStackCache cache;
+    cache.build(doc, 2);
+    EXPECT_TRUE(cache.isValid(doc, 2));
+    EXPECT_FALSE(cache.isValid(doc, 3));
+
+    doc.layerAt(1)->image()->setPixel(2, 2, 0u);
+    EXPECT_FALSE(cache.isValid(doc, 2));
+
+    cache.build(doc, 2);
+    doc.layerAt(4)->setVisible(false);
+    EXPECT_FALSE(cache.isValid(doc, 2));
+
+    cache.build(doc, 2);
+    doc.reorderLayer(4, 3);
+    EXPECT_FALSE(cache.isValid(doc, 2));
+}
+
+TEST(LayerStackCache, PrepareRebuildsOnSecondCallWithSameStack)
+{
+    Document doc = makeStack();
+    LayerStackCache cache;
+
+    EXPECT_FALSE(cache.prepare(doc, 2));
+    EXPECT_TRUE(cache.prepare(doc, 2));
+    EXPECT_TRUE(cache.isValid(doc, 2));
+
+    // one-off change below: no rebuild yet
+    doc.layerAt(0)->setOpacity(0.5f);
+    EXPECT_FALSE(cache.prepare(doc, 2));
+    EXPECT_FALSE(cache.isValid(doc, 2));
+    EXPECT_TRUE(cache.prepare(doc, 2));
+}
+
+TEST(LayerStackCache, BlendModesAboveAreNotFlattened)
+{
+    Document doc = makeStack();
+    doc.layerAt(3)->setBlendMode(core::BlendMode::Multiply);
+
+    LayerStackCache cache;
+    cache.build(doc, 2);
+    EXPECT_FALSE(cache.aboveIsExact());
+
+    ImageBuffer want(48, 40);
+    ImageBuffer got(48, 40);
+    Compositor::compose(doc, want);
+    cache.composeROI(doc, 0, 0, 48, 40, got);
+    EXPECT_EQ(maxChannelDiff(want, got), 0);
+
+    doc.layerAt(3)->setBlendMode(core::BlendMode::Screen);
+    EXPECT_FALSE(cache.isValid(doc, 2));
+}
+
+TEST(LayerStackCache, MovedActiveLayerUnderBlendModeMatchesMovedComposite)
+{
+    Document doc = makeStack();
+    doc.layerAt(3)->setBlendMode(core::BlendMode::Multiply);
+
+    for (const core::BlendMode activeMode : {core::BlendMode::Normal, core::BlendMode::Multiply})
+    {
+        doc.layerAt(2)->setBlendMode(activeMode);
+        doc.layerAt(2)->setOffset(10, 12);
+        LayerStackCache cache;
+        cache.build(doc, 2);
+        ASSERT_FALSE(cache.aboveIsExact());
+
+        std::vector<std::uint32_t> got(48 * 40);
+        cache.composeMovedInto(doc, common::Point{17, 20}, 0, 0,
+                               Compositor::PremultipliedTarget{got.data(), 48, 40, 48});
+        // the document layer did not move
+        EXPECT_EQ(doc.layerAt(2)->offsetX(), 10);
+        EXPECT_EQ(doc.layerAt(2)->offsetY(), 12);
+
+        doc.layerAt(2)->setOffset(17, 20);
+        std::vector<std::uint32_t> want(48 * 40);
+        Compositor::composeInto(doc, 0, 0, Compositor::PremultipliedTarget{want.data(), 48, 40, 48});
+        EXPECT_EQ(got, want);
+    }
+}
@@ -0,0 +1,232 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+
+#include "core/AlphaMask.hpp"
+#include "core/Selection.hpp"
+#include "core/SpanMask.hpp"
+
+static void expectSameCoverage(const SpanMask& spans, const AlphaMask& want)
+{
+    AlphaMask raster{want.width(), want.height()};
+    spans.rasterize(raster);
+    for (int y = 0; y < want.height(); ++y)
+        for (int x = 0; x < want.width(); ++x)
+        {
+            ASSERT_EQ(spans.at(x, y), want.at(x, y)) << x << "," << y;
+            ASSERT_EQ(raster.at(x, y), want.at(x, y)) << x << "," << y;
+        }
+    const auto a = spans.bounds();
+    const auto b = want.bounds();
+    ASSERT_EQ(a.has_value(), b.has_value());
+    if (a)
+    {
+        EXPECT_EQ(a->x, b->x);
+        EXPECT_EQ(a->y, b->y);
+        EXPECT_EQ(a->w, b->w);
+        EXPECT_EQ(a->h, b->h);
+    }
+    for (int y = 0; y < spans.height(); ++y)
+    {
+        const auto row = spans.row(y);
+        for (std::size_t i = 0; i < row.size(); ++i)
+        {
+            EXPECT_LT(row[i].x0, row[i].x1);
+            EXPECT_NE(row[i].coverage, 0u);
+            // sorted, and merged when touching with the same coverage
+            if (i > 0)
+            {
+                EXPECT_LE(row[i - 1].x1, row[i].x0);
+                EXPECT_TRUE(row[i - 1].x1 < row[i].x0 || row[i - 1].coverage != row[i].coverage);
+            }
+        }
+    }
+}
+
+TEST(SpanMaskTest, RectEditsMatchPerPixelReference)
+{
+    SpanMask spans{90, 40};
+    AlphaMask want{90, 40};
+    std::mt19937 rng(4);
+    std::uniform_int_distribution<int> pos(-20, 100);
+    std::uniform_int_distribution<int> op(0, 9);
+    std::uniform_int_distribution<int> cov(1, 255);
+
+    for (int step = 0; step < 200; ++step)
+    {
+        const common::Rect r{pos(rng), pos(rng) / 2, pos(rng) / 2 + 10, pos(rng) / 4 + 5};
+        const common::Rect clip = common::intersect(r, common::Rect{0, 0, 90, 40});
+        const int kind = op(rng);
+        if (kind < 5)
+        {
+            const auto c = static_cast<std::uint8_t>(kind == 0 ? cov(rng) : 0xFF);
+            spans.addRect(r, c);
+            for (int y = clip.y; y < clip.y + clip.h; ++y)
+                for (int x = clip.x; x < clip.x + clip.w; ++x)
+                    want.set(x, y, std::max(want.at(x, y), c));
+        }
+        else if (kind < 8)
+        {
+            spans.subtractRect(r);
+            want.fillRect(r, 0);
+        }
+        else if (kind == 8)
+        {
+            spans.intersectRect(r);
+            for (int y = 0; y < 40; ++y)
+                for (int x = 0; x < 90; ++x)
+                    if (x < clip.x || x >= clip.x + clip.w || y < clip.y || y >= clip.y + clip.h)
+                        want.set(x, y, 0);
+        }
+        else
+        {
+            spans.invert();
+            for (int y = 0; y < 40; ++y)
+                for (int x = 0; x < 90; ++x)
+                    want.set(x, y, static_cast<std::uint8_t>(0xFF - want.at(x, y)));
+        }
+        expectSameCoverage(spans, want);
+    }
+}
+
+TEST(SpanMaskTest, FromMaskKeepsCoverage)
+{
+    AlphaMask mask{70, 3};
+    mask.fillRect(common::Rect{5, 0, 20, 3}, 0xFF);
+    mask.fillRect(common::Rect{10, 1, 5, 1}, 0x80);
+    mask.set(69, 2, 0x10);
+
+    const SpanMask spans = SpanMask::fromMask(mask);
+    expectSameCoverage(spans, mask);
+    EXPECT_EQ(spans.row(1).size(), 3u);
+}
+
+TEST(SelectionTest, MaskIsRasterizedOnDemandAndDroppedByEdits)
+{
+    Selection sel;
+    sel.addRect(common::Rect{2, 2, 3, 3});
+    EXPECT_FALSE(sel.hasMask());  // no size, nothing created
+
+    sel.addRect(common::Rect{2, 2, 3, 3}, 10, 8);
+    ASSERT_TRUE(sel.hasMask());
+    EXPECT_EQ(sel.t_at(2, 2), 0xFFu);
+    EXPECT_EQ(sel.t_at(5, 2), 0u);
+
+    const auto first = sel.mask();
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first->at(4, 4), 0xFFu);
+    EXPECT_EQ(sel.mask(), first);  // cached until the next edit
+
+    sel.invert();
+    EXPECT_EQ(sel.t_at(2, 2), 0u);
+    EXPECT_EQ(sel.t_at(0, 0), 0xFFu);
+    ASSERT_NE(sel.mask(), first);
+    EXPECT_EQ(sel.mask()->at(0, 0), 0xFFu);
+    EXPECT_EQ(first->at(0, 0), 0u);
+
+    sel.intersectRect(common::Rect{0, 0, 2, 2});
+    const auto b = sel.boundingRect();
+    ASSERT_TRUE(b.has_value());
+    EXPECT_EQ(b->w, 2);
+    EXPECT_EQ(b->h, 2);
+
+    sel.clear();
+    EXPECT_FALSE(sel.hasMask());
+    EXPECT_EQ(sel.mask(), nullptr);
+}
+
+TEST(SelectionTest, SetMaskIgnoresLaterWritesToCallerMask)
+{
+    auto source = std::make_shared<AlphaMask>(10, 8);
+    for (int y = 2; y < 5; ++y)
+        for (int x = 2; x < 5; ++x)
+            source->set(x, y, 0xFFu);
+
+    Selection sel;
+    sel.setMask(source);
+    source->set(7, 6, 0xFFu);
+    source->set(2, 2, 0u);
+
+    const auto mask = sel.mask();
+    ASSERT_NE(mask, nullptr);
+    EXPECT_NE(mask, source);
+    for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 10; ++x)
+            EXPECT_EQ(mask->at(x, y), sel.t_at(x, y)) << x << "," << y;
+    EXPECT_EQ(sel.t_at(2, 2), 0xFFu);
+    EXPECT_EQ(sel.t_at(7, 6), 0u);
+    ASSERT_TRUE(sel.boundingRect().has_value());
+    EXPECT_EQ(sel.boundingRect()->w, 3);
+}
+
+TEST(SpanMaskTest, BoundsFollowEditsWithoutRescan)
+{
+    SpanMask spans{50, 50};
+    EXPECT_FALSE(spans.bounds().has_value());
+
+    spans.addRect(common::Rect{10, 10, 5, 5});
+    spans.addRect(common::Rect{30, 20, 5, 5});
+    ASSERT_TRUE(spans.bounds().has_value());
+    EXPECT_EQ(spans.bounds()->x, 10);
+    EXPECT_EQ(spans.bounds()->w, 25);
+    EXPECT_EQ(spans.bounds()->h, 15);
+
+    // a hole inside keeps them, removing a whole corner block shrinks them
+    spans.addRect(common::Rect{10, 10, 25, 15});
+    spans.subtractRect(common::Rect{15, 15, 5, 5});
+    EXPECT_EQ(spans.bounds()->w, 25);
+    spans.subtractRect(common::Rect{0, 0, 50, 12});
+    EXPECT_EQ(spans.bounds()->y, 12);
+    EXPECT_EQ(spans.bounds()->h, 13);
+
+    spans.subtractRect(common::Rect{0, 0, 50, 50});
+    EXPECT_FALSE(spans.bounds().has_value());
+    EXPECT_TRUE(spans.empty());
+}
+
+TEST(SelectionViewTest, LayerViewMatchesShiftedDocumentCoverage)
+{
+    Selection sel;
+    sel.addRect(common::Rect{5, 5, 100, 20}, 120, 40);
+    sel.subtractRect(common::Rect{40, 10, 7, 30});
+    sel.addRect(common::Rect{0, 30, 3, 2});
+
+    // layer of 90x30 at (-10, 3): partly outside the document
+    const common::Point offset{-10, 3};
+    const SelectionView view = sel.view(offset, 90, 30);
+    for (int y = 0; y < 30; ++y)
+    {
+        bool anySelected = false;
+        for (int x = 0; x < 90; x += 64)
+        {
+            const int n = std::min(64, 90 - x);
+            std::uint64_t want = 0;
+            for (int i = 0; i < n; ++i)
+                if (sel.t_at(x + i + offset.x, y + offset.y) != 0)
+                    want |= std::uint64_t{1} << i;
+            ASSERT_EQ(view.coverageBits(x, y, n), want) << x << "," << y;
+            anySelected = anySelected || want != 0;
+        }
+        EXPECT_EQ(view.rowEmpty(y), !anySelected) << y;
+
+        int covered = 0;
+        view.forEachSpan(y, 20, 60,
+                         [&](int x0, int x1, std::uint8_t c)
+                         {
+                             EXPECT_GE(x0, 20);
+                             EXPECT_LE(x1, 60);
+                             EXPECT_EQ(c, 0xFFu);
+                             covered += x1 - x0;
+                         });
+        int want = 0;
+        for (int x = 20; x < 60; ++x)
+            want += view.at(x, y) != 0 ? 1 : 0;
+        EXPECT_EQ(covered, want) << y;
+    }
+}
@@ -0,0 +1,49 @@
+//
+// Created by apolline on 16/10/2026.
+//
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "core/ThreadPool.hpp"
+
+TEST(ThreadPool, SizeCountsTheCallingThread)
+{
+    EXPECT_EQ(core::ThreadPool(1).size(), 1u);
+    EXPECT_EQ(core::ThreadPool(0).size(), 1u);
+    EXPECT_EQ(core::ThreadPool(4).size(), 4u);
+}
+
+TEST(ThreadPool, ParallelForRunsEveryIndexOnce)
+{
+    core::ThreadPool pool(4);
+    for (int round = 0; round < 20; ++round)
+    {
+        std::vector<std::atomic<int>> hits(97);
+        pool.parallelFor(97, [&](int i) { hits[static_cast<std::size_t>(i)]++; });
+        for (const auto& h : hits)
+            ASSERT_EQ(h.load(), 1);
+    }
+}
+
+TEST(ThreadPool, ExceptionIsRethrownToCaller)
+{
+    core::ThreadPool pool(3);
+    std::atomic<int> done{0};
+    EXPECT_THROW(pool.parallelFor(16,
+                                  [&](int i)
+                                  {
+                                      if (i == 5)
+                                          throw std::runtime_error("boom");
+                                      ++done;
+                                  }),
+                 std::runtime_error);
+    EXPECT_EQ(done.load(), 15);
+
+    // the pool is still usable afterwards
+    std::atomic<int> count{0};
+    pool.parallelFor(8, [&](int) { ++count; });
+    EXPECT_EQ(count.load(), 8);
+}
@@ -213,6 +213,36 @@ TEST_F(EpgTest, SaveAndOpenPreserveLayerProperties)
     removeTemp("epg_test_props.epg");
 }
 
+TEST_F(EpgTest, SaveAndOpenPreservesBlendModes)
+{
+    Document doc(4, 4);
+    const core::BlendMode modes[] = {core::BlendMode::Normal, core::BlendMode::Multiply,
+                                     core::BlendMode::Screen, core::BlendMode::Overlay,
+                                     core::BlendMode::Darken, core::BlendMode::Lighten};
+    for (std::size_t i = 0; i < std::size(modes); ++i)
+    {
+        auto layer =
+            make_shared<Layer>(i + 1, "L" + std::to_string(i), makeBuf(4, 4, 0x808080FFu));
+        layer->setBlendMode(modes[i]);
+        doc.addLayer(layer);
+    }
+
+    EXPECT_EQ(storage.createManifestFromDocument(doc).layers[1].blendMode,
+              io::epg::BlendMode::Multiply);
+
+    auto tmp = tmpPath("epg_test_blend.epg");
+    removeTemp("epg_test_blend.epg");
+    EXPECT_NO_THROW(storage.save(doc, tmp.string()));
+
+    auto res = storage.open(tmp.string());
+    ASSERT_TRUE(res.success) << res.errorMessage;
+    ASSERT_EQ(res.document->layerCount(), std::size(modes));
+    for (std::size_t i = 0; i < std::size(modes); ++i)
+        EXPECT_EQ(res.document->layerAt(i)->blendMode(), modes[i]);
+
+    removeTemp("epg_test_blend.epg");
+}
+
 TEST_F(EpgTest, exportImage_CompositionWithOpacity)
 {
     Document doc(4, 4, 72.0f);
@@ -241,15 +271,15 @@ TEST_F(EpgTest, exportImage_CompositionWithOpacity)
     ASSERT_EQ(h, doc.height());
     ASSERT_EQ(channels, 4);
 
-    // pixel at 0,0 -> composition result: (127,127,0,255)
+    // pixel at 0,0 -> composition result: (128,128,0,255)
     int idx = 0;
     unsigned char r = data[idx + 0];
     unsigned char g = data[idx + 1];
     unsigned char b = data[idx + 2];
     unsigned char a = data[idx + 3];
 
-    EXPECT_EQ(r, 127);
-    EXPECT_EQ(g, 127);
+    EXPECT_EQ(r, 128);
+    EXPECT_EQ(g, 128);
     EXPECT_EQ(b, 0);
     EXPECT_EQ(a, 255);
 
@@ -257,6 +287,40 @@ TEST_F(EpgTest, exportImage_CompositionWithOpacity)
     removeTemp("epg_comp_test.png");
 }
 
+TEST_F(EpgTest, exportImage_UsesLayerBlendModes)
+{
+    Document doc(4, 4, 72.0f);
+
+    auto l1 = make_shared<Layer>(1ULL, string("BG"), makeBuf(4, 4, 0xC86432FFu), true, false,
+                                 1.0f);
+    auto l2 = make_shared<Layer>(2ULL, string("Multiply"), makeBuf(4, 4, 0x808080FFu), true,
+                                 false, 1.0f);
+    l2->setBlendMode(core::BlendMode::Multiply);
+    doc.addLayer(l1);
+    doc.addLayer(l2);
+
+    auto tmp = tmpPath("epg_multiply_test.png");
+    std::string path = tmp.string();
+    removeTemp("epg_multiply_test.png");
+
+    EXPECT_NO_THROW(storage.exportImage(doc, path));
+
+    int w, h, channels;
+    unsigned char* data = stbi_load(path.c_str(), &w, &h, &channels, 4);
+    ASSERT_NE(data, nullptr);
+    ASSERT_EQ(w, doc.width());
+    ASSERT_EQ(h, doc.height());
+
+    // Multiply by ~0.5 (not a source-over of the grey layer): (100,50,25,255)
+    EXPECT_EQ(data[0], 100);
+    EXPECT_EQ(data[1], 50);
+    EXPECT_EQ(data[2], 25);
+    EXPECT_EQ(data[3], 255);
+
+    stbi_image_free(data);
+    removeTemp("epg_multiply_test.png");
+}
+
 TEST(EpgFormatMore, exportImage_ThrowsOnEmptyDocument)
 {
     const Document doc(4, 4, 72.0f);
@@ -325,6 +389,35 @@ TEST(EpgHelpers, ComposePreviewAndEncodeProducesPngSignature)
         EXPECT_EQ(png[i], expected[i]);
 }
 
+TEST(EpgHelpers, ComposePreviewUsesLayerBlendModes)
+{
+    Document doc(512, 256, 72.0f);
+
+    auto bottom = make_shared<ImageBuffer>(512, 256);
+    bottom->fill(0xC86432FFu);
+    auto top = make_shared<ImageBuffer>(512, 256);
+    top->fill(0x808080FFu);
+    doc.addLayer(make_shared<Layer>(1ULL, string("BG"), bottom, true, false, 1.0f));
+    auto multiply = make_shared<Layer>(2ULL, string("Multiply"), top, true, false, 1.0f);
+    multiply->setBlendMode(core::BlendMode::Multiply);
+    doc.addLayer(multiply);
+
+    ZipEpgStorage storage;
+    int w = 0, h = 0;
+    auto preview = storage.composePreviewRGBA(doc, w, h);
+    ASSERT_EQ(w, 256);
+    ASSERT_EQ(h, 128);
+    ASSERT_EQ(preview.size(), static_cast<size_t>(w) * static_cast<size_t>(h) * 4u);
+
+    // same pixels as the export composite, not a source-over of the grey layer
+    const auto flat = storage.composeFlattenedRGBA(doc);
+    EXPECT_EQ(preview[0], flat[0]);
+    EXPECT_EQ(preview[0], 100);
+    EXPECT_EQ(preview[1], 50);
+    EXPECT_EQ(preview[2], 25);
+    EXPECT_EQ(preview[3], 255);
+}
+
 TEST(EpgHelpers, WritePreviewToZipCreatesEntry)
 {
     Document doc(10, 10, 72.0f);
@@ -390,8 +483,8 @@ TEST(EpgHelpers, ComposeFlattenedRGBAMatchesExpectedComposition)
     unsigned char b = out[2];
     unsigned char a = out[3];
 
-    EXPECT_EQ(r, 127);
-    EXPECT_EQ(g, 127);
+    EXPECT_EQ(r, 128);
+    EXPECT_EQ(g, 128);
     EXPECT_EQ(b, 0);
     EXPECT_EQ(a, 255);
 }
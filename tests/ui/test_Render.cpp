@@ -0,0 +1,117 @@
+//
+// Created by apolline on 16/10/2026.
+//
+
+#include <QImage>
+
+#include <cstdlib>
+#include <memory>
+#include <optional>
+
+#include "core/Document.hpp"
+#include "core/ImageBuffer.hpp"
+#include "core/Layer.hpp"
+#include "ui/Render.hpp"
+
+#include <gtest/gtest.h>
+
+static std::shared_ptr<Layer> addSolidLayer(Document& doc, std::uint64_t id, int w, int h,
+                                            std::uint32_t color)
+{
+    auto img = std::make_shared<ImageBuffer>(w, h);
+    img->fill(color);
+    auto layer = std::make_shared<Layer>(id, "L", img);
+    doc.addLayer(layer);
+    return layer;
+}
+
+TEST(RendererTest, FirstUpdateRendersWholeDocument)
+{
+    Document doc(40, 30);
+    addSolidLayer(doc, 0, 40, 30, 0x336699FFu);
+
+    Renderer renderer;
+    QImage target;
+    const common::Rect r = renderer.update(doc, common::Rect{1, 1, 2, 2}, target);
+
+    EXPECT_EQ(r.w, 40);
+    EXPECT_EQ(r.h, 30);
+    EXPECT_EQ(target.format(), Renderer::kFormat);
+    EXPECT_EQ(target, Renderer::render(doc));
+}
+
+TEST(RendererTest, PartialUpdateMatchesFullRender)
+{
+    Document doc(40, 30);
+    addSolidLayer(doc, 0, 40, 30, 0x336699FFu);
+    auto top = addSolidLayer(doc, 1, 10, 10, 0xFF000080u);
+    top->setOffset(5, 5);
+
+    Renderer renderer;
+    QImage target;
+    renderer.update(doc, std::nullopt, target);
+    const uchar* bits = target.constBits();
+
+    // move the layer and only recomposite the old + new area
+    top->setOffset(20, 12);
+    const common::Rect r = renderer.update(doc, common::Rect{5, 5, 25, 17}, target);
+
+    EXPECT_EQ(r.x, 5);
+    EXPECT_EQ(r.y, 5);
+    EXPECT_EQ(r.w, 25);
+    EXPECT_EQ(r.h, 17);
+    EXPECT_EQ(target.constBits(), bits);  // updated in place
+    EXPECT_EQ(target, Renderer::render(doc));
+}
+
+TEST(RendererTest, DirtyRectIsClippedToDocument)
+{
+    Document doc(8, 8);
+    addSolidLayer(doc, 0, 8, 8, 0x000000FFu);
+
+    Renderer renderer;
+    QImage target;
+    renderer.update(doc, std::nullopt, target);
+
+    const common::Rect r = renderer.update(doc, common::Rect{6, -3, 10, 5}, target);
+    EXPECT_EQ(r.x, 6);
+    EXPECT_EQ(r.y, 0);
+    EXPECT_EQ(r.w, 2);
+    EXPECT_EQ(r.h, 2);
+
+    const common::Rect outside = renderer.update(doc, common::Rect{20, 20, 4, 4}, target);
+    EXPECT_TRUE(common::isEmpty(outside));
+}
+
+TEST(RendererTest, ActiveLayerUpdatesUseLayerStack)
+{
+    Document doc(40, 30);
+    addSolidLayer(doc, 0, 40, 30, 0x336699FFu);
+    auto active = addSolidLayer(doc, 1, 10, 10, 0xFF000080u);
+    auto above = addSolidLayer(doc, 2, 40, 8, 0x00FF0060u);
+    above->setOffset(0, 10);
+
+    Renderer renderer;
+    QImage target;
+    renderer.update(doc, std::nullopt, target, 1);
+
+    // two edits of the active layer in a row: the second one builds the cache
+    for (const int x : {5, 20})
+    {
+        active->setOffset(x, 12);
+        renderer.update(doc, common::Rect{0, 0, 40, 30}, target, 1);
+    }
+    EXPECT_TRUE(renderer.layerStack().isValid(doc, 1));
+
+    const QImage full = Renderer::render(doc);
+    for (int y = 0; y < 30; ++y)
+        for (int x = 0; x < 40; ++x)
+        {
+            const QRgb a = target.pixel(x, y);
+            const QRgb b = full.pixel(x, y);
+            EXPECT_LE(std::abs(qRed(a) - qRed(b)), 2);
+            EXPECT_LE(std::abs(qGreen(a) - qGreen(b)), 2);
+            EXPECT_LE(std::abs(qBlue(a) - qBlue(b)), 2);
+            EXPECT_LE(std::abs(qAlpha(a) - qAlpha(b)), 2);
+        }
+}